@@ -0,0 +1,125 @@
+#!/bin/sh
+
+# This script creates a synthetic test suite to measure the performance of 
+# the T2C code generator (see run_bench.sh).
+#
+# Usage:
+#   gen_corpus.sh <dir> [groups] [files] [blocks] [purposes] [lines] [interval]
+#
+# <dir>      - the directory to create the suite in. <dir>/bench-t2c/src/ will
+#              contain the .t2c files, <dir>/bench.cfg - the configuration file.
+# groups     - number of the test groups (subdirectories of src/). Default: 4.
+# files      - number of the .t2c files in each group. Default: 25.
+# blocks     - number of the BLOCK sections in each file. Default: 5.
+# purposes   - number of the PURPOSE sections in each block. Default: 4.
+# lines      - number of the parameter lines in each PURPOSE section. Default: 2.
+# interval   - number of the values in each parameter line. Default: 3.
+#
+# Each PURPOSE section expands to interval^lines test purposes: the values 
+# are alternately an interval of integers and a list of string literals.
+
+if [ -z "$1" ]; then
+    echo "Usage: $0 <dir> [groups] [files] [blocks] [purposes] [lines] [interval]"
+    exit 1
+fi
+
+DIR=$1
+NGROUPS=${2:-4}
+FILES=${3:-25}
+BLOCKS=${4:-5}
+PURPOSES=${5:-4}
+LINES=${6:-2}
+INTERVAL=${7:-3}
+
+SRC_DIR=${DIR}/bench-t2c/src
+
+g=1
+while [ $g -le $NGROUPS ]; do
+    mkdir -p ${SRC_DIR}/group$g || exit 1
+    g=`expr $g + 1`
+done
+
+cat > ${DIR}/bench.cfg <<EOT
+COMPILER = gcc
+COMPILER_FLAGS = 
+LINKER_FLAGS = 
+WAIT_TIME = 30
+EOT
+
+# All the files are written by a single awk process, this is much faster
+# than running a command for each of them.
+awk -v src_dir="${SRC_DIR}" -v ngroups=$NGROUPS -v nfiles=$FILES \
+    -v nblocks=$BLOCKS -v npurposes=$PURPOSES -v nlines=$LINES \
+    -v ninterval=$INTERVAL '
+function param_line(k,    i, s) {
+    if (k % 2 == 0) {
+        return "    SET(1.." ninterval ")";
+    }
+    s = "    SET(";
+    for (i = 1; i <= ninterval; ++i) {
+        s = s (i > 1 ? "; " : "") "\"value" i "\"";
+    }
+    return s ")";
+}
+BEGIN {
+    for (g = 1; g <= ngroups; ++g) {
+        for (f = 1; f <= nfiles; ++f) {
+            path = src_dir "/group" g "/bench" g "_" f ".t2c";
+            
+            print "#library libbench" > path;
+            print "#libsection Group " g > path;
+            print "" > path;
+            print "<GLOBAL>" > path;
+            print "#include <stdio.h>" > path;
+            print "#include <string.h>" > path;
+            print "static int counter_ = 0;" > path;
+            print "</GLOBAL>" > path;
+            print "" > path;
+            print "<STARTUP>" > path;
+            print "    counter_ = 1;" > path;
+            print "</STARTUP>" > path;
+            print "" > path;
+            print "<CLEANUP>" > path;
+            print "    counter_ = 0;" > path;
+            print "</CLEANUP>" > path;
+            
+            for (b = 1; b <= nblocks; ++b) {
+                print "" > path;
+                print "##############################################################" > path;
+                print "<BLOCK>" > path;
+                print "<TARGETS>" > path;
+                print "    bench_func" b > path;
+                print "</TARGETS>" > path;
+                print "<DEFINE>" > path;
+                for (k = 0; k < nlines; ++k) {
+                    print "#define P" k " <%" k "%>" > path;
+                }
+                print "</DEFINE>" > path;
+                print "<CODE>" > path;
+                print "    int res = counter_ + " b ";" > path;
+                for (k = 0; k < nlines; ++k) {
+                    if (k % 2 == 0) {
+                        print "    res += P" k ";" > path;
+                    } else {
+                        print "    res += (int)strlen(P" k ");" > path;
+                    }
+                }
+                print "    REQ(\"bench_func" b ".01\", \"The result is positive\", res > 0);" > path;
+                print "</CODE>" > path;
+                print "<FINALLY>" > path;
+                print "    counter_++;" > path;
+                print "</FINALLY>" > path;
+                
+                for (p = 1; p <= npurposes; ++p) {
+                    print "<PURPOSE>" > path;
+                    for (k = 0; k < nlines; ++k) {
+                        print param_line(k) > path;
+                    }
+                    print "</PURPOSE>" > path;
+                }
+                print "</BLOCK>" > path;
+            }
+            close(path);
+        }
+    }
+}'
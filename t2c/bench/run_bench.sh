@@ -0,0 +1,66 @@
+#!/bin/sh
+
+# This script measures the throughput of the T2C code generator: it creates
+# a synthetic test suite (see gen_corpus.sh), generates the tests with 
+# "t2c -t -f" and prints the statistics.
+#
+# Usage:
+#   run_bench.sh [-j N] [groups] [files] [blocks] [purposes] [lines] [interval]
+#
+# -j N - the number of threads for the code generator (see t2c -j). Default: 1.
+# The rest of the arguments are passed to gen_corpus.sh.
+#
+# The suite is created in a temporary directory that is removed afterwards
+# unless BENCH_KEEP is set. Set BENCH_DIR to use another directory.
+# If BENCH_STATS is set, the statistics for each file are also written there
+# (see t2c --stats).
+
+# Get the directory where this script resides and set T2C_ROOT if needed.
+BENCH_SRC_DIR=$(cd `dirname $0` && pwd)
+if [ -z "${T2C_ROOT}" ]; then
+    T2C_ROOT=$(cd ${BENCH_SRC_DIR}/../.. && pwd)
+    export T2C_ROOT
+fi
+
+T2C=${T2C_ROOT}/t2c/bin/t2c
+if [ ! -x ${T2C} ]; then
+    echo "ERROR: ${T2C} is not found, build the code generator first."
+    exit 1
+fi
+
+STATS_OPT=""
+if [ -n "${BENCH_STATS}" ]; then
+    STATS_OPT="--stats ${BENCH_STATS}"
+fi
+
+JOBS=1
+if [ "$1" = "-j" ]; then
+    JOBS=$2
+    shift 2
+fi
+
+if [ -z "${BENCH_DIR}" ]; then
+    BENCH_DIR=`mktemp -d /tmp/t2c_bench.XXXXXX` || exit 1
+else
+    rm -rf ${BENCH_DIR}/bench-t2c
+    mkdir -p ${BENCH_DIR} || exit 1
+fi
+
+echo "Creating the benchmark suite in ${BENCH_DIR}"
+sh ${BENCH_SRC_DIR}/gen_corpus.sh ${BENCH_DIR} "$@" || exit 1
+echo "Corpus: `ls ${BENCH_DIR}/bench-t2c/src/*/*.t2c | wc -l` file(s), `du -sk ${BENCH_DIR}/bench-t2c/src | cut -f1` KB"
+
+# The cache is ignored (-f), so all the tests are generated each time.
+cd ${BENCH_DIR} && T2C_SUITE_ROOT=${BENCH_DIR} ${T2C} -t -f -j ${JOBS} ${STATS_OPT} . bench-t2c bench.cfg > bench.log 2>&1
+RES=$?
+
+# Print the statistics only, not the names of the files processed.
+sed -n '/^Generation statistics:/,$p' ${BENCH_DIR}/bench.log
+if [ $RES -ne 0 ]; then
+    echo "ERROR: the code generator failed, see ${BENCH_DIR}/bench.log"
+    exit 1
+fi
+
+if [ -z "${BENCH_KEEP}" ]; then
+    rm -rf ${BENCH_DIR}
+fi
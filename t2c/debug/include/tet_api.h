@@ -25,6 +25,11 @@ tet_delete(int testno, char* reason);
 char* 
 tet_getvar(char* name);
 
+// Returns the reason to cancel the test purpose (see tet_delete()), NULL if
+// it has not been deleted.
+char* 
+tet_reason(int testno);
+
 // Outputs a line to stdout.
 //void tet_infoline(char* line);
 #define tet_infoline(line) printf("%s\n", line)
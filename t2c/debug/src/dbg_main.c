@@ -267,6 +267,18 @@ tet_delete(int testno, char* reason)
     return;
 }
 
+char* 
+tet_reason(int testno)
+{
+    size_t num = (size_t)testno - 1;
+    if (num >= tp_count)
+    {
+        return NULL;
+    }
+
+    return comment[num];
+}
+
 char* 
 tet_getvar(char* name)
 {
@@ -0,0 +1,58 @@
+#ifndef GEN_CACHE_H
+#define GEN_CACHE_H
+
+#include <stddef.h>
+
+// Name of the cache file (in the output directory of the test suite).
+#define GEN_CACHE_FILE      ".t2c_cache"
+
+// Format version of the cache file. Must be increased each time the format
+// of the file changes (see also T2CGEN_VERSION in t2cgen.h).
+#define GEN_CACHE_VERSION   2
+
+// Initial value for hash_data() (FNV-1a, 64 bit).
+#define HASH_INIT           14695981039346656037ULL
+
+typedef unsigned long long THash;
+
+/* 
+ * A record of the cache: the data the test generated from the .t2c-file 
+ * 'path' was made of. 
+ */
+typedef struct
+{
+    char*           path;       // path to the .t2c-file
+    THash           src_hash;   // hash of the contents of the file
+    THash           env_hash;   // hash of the templates and settings used
+    long long       mtime;      // mtime of the file when it was hashed
+    long long       size;       // size of the file when it was hashed
+} TCacheEntry;
+
+typedef struct
+{
+    TCacheEntry*    entries;    // sorted by path
+    int             nEntries;
+    long long       stamp;      // the time the generator that wrote the cache started
+} TGenCache;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern THash hash_data (THash h, const void* data, size_t len);
+extern THash hash_string (THash h, const char* str);
+extern int hash_file (const char* path, THash* res);
+
+extern void gen_cache_load (TGenCache* cache, const char* path);
+extern const TCacheEntry* gen_cache_find (const TGenCache* cache, const char* path);
+extern int gen_cache_check (const TGenCache* cache, const char* path, THash env_hash,
+                            TCacheEntry* rec);
+extern int gen_cache_save (const TGenCache* cache, const char* path);
+extern void gen_cache_free (TGenCache* cache);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* GEN_CACHE_H */
@@ -0,0 +1,78 @@
+#ifndef GEN_STATS_H
+#define GEN_STATS_H
+
+#include <stdio.h>
+
+// Phases of the generation of a test (see TGenStats::phase_time).
+#define PHASE_HEADER        0   // reading the .t2c-file and parsing its header
+#define PHASE_SECTIONS      1   // parsing the sections
+#define PHASE_PURPOSES      2   // expanding the parameters of the purposes and
+                                // substituting them into the purpose template
+#define PHASE_TEMPLATES     3   // preparing the values for the test template
+#define PHASE_OUTPUT        4   // writing the test (the test template is
+                                // substituted as it is written) and its makefile
+#define PHASES_NUM          5
+
+/*
+ * Statistics of the code generator: what has been done and how long it took.
+ */
+typedef struct
+{
+    double          phase_time[PHASES_NUM];     // seconds, summed over the tests
+    long            nFiles;         // number of the tests generated
+    long            nCached;        // number of the tests that were up to date
+    long            nFailed;        // number of the tests that could not be generated
+    long            nBlocks;        // number of the BLOCK sections processed
+    long            nPurposes;      // number of the test purposes generated
+    long            nCombinations;  // how many of them were generated from the
+                                    // combinations of parameter values
+    long long       bytes_in;       // size of the .t2c-files processed
+    long long       bytes_out;      // size of the C-files generated
+} TGenStats;
+
+// The statistics of a single test (see stats_write()).
+typedef struct
+{
+    const char*         path;       // path to the .t2c-file
+    const char*         group;
+    const char*         test;
+    const char*         status;     // STATUS_* 
+    const TGenStats*    stats;
+} TFileStats;
+
+#define STATUS_GENERATED    "generated"
+#define STATUS_CACHED       "up-to-date"
+#define STATUS_FAILED       "failed"
+
+// The statistics of the heap allocator of the C library (in bytes).
+// All the fields are -1 if the statistics are not available.
+typedef struct
+{
+    long long       arena;          // allocated from the system with sbrk()
+    long long       mmapped;        // allocated from the system with mmap()
+    long long       in_use;         // used by the allocated blocks
+    long long       free_space;     // free space in the arena
+} THeapStats;
+
+// The format of the file with the statistics is chosen by its extension.
+#define STATS_CSV_EXT       ".csv"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern double stats_time (void);
+extern void stats_init (TGenStats* stats);
+extern void stats_add (TGenStats* to, const TGenStats* from);
+extern long stats_peak_rss (void);
+extern void stats_heap (THeapStats* hs);
+extern void stats_print (FILE* out, const TGenStats* stats, double wall_time, int nThreads);
+extern int stats_write (const char* path, const char* suite, const TFileStats* files, 
+                        int nFiles, const TGenStats* total, double wall_time, int nThreads);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* GEN_STATS_H */
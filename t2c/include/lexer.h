@@ -0,0 +1,56 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+
+#include "libfile.h"
+
+// Kinds of the tokens (see TToken).
+#define TOKEN_TEXT      0   // any other line
+#define TOKEN_OPEN      1   // <NAME attributes>
+#define TOKEN_CLOSE     2   // </NAME>
+
+/*
+ * A line of a .t2c-file as classified by lexer_next(). The tags are
+ * recognized only if they are on a line by themselves and their names are
+ * known to the lexer; the parser decides whether a tag is meaningful where
+ * it is found, otherwise the line is just text.
+ */
+typedef struct
+{
+    int         kind;       // TOKEN_*
+    int         tag;        // index of the name of the tag, -1 for the text
+    int         line;       // number of the line in the file (from 1)
+    char*       str;        // the line itself (in TSrcFile)
+
+    // The attributes of an open tag (not terminated with '\0'), NULL if
+    // there are none.
+    const char* attribs;
+    size_t      attribs_len;
+} TToken;
+
+/*
+ * Splits a .t2c-file into tokens in a single pass over its lines (see
+ * lexer_init()). The lines of the comments (those beginning with '#' that
+ * are not preprocessor directives) are skipped.
+ */
+typedef struct
+{
+    TSrcFile*       src;
+    char* const*    names;  // names of the known tags, NULL-terminated
+    int             line;   // number of the last line read
+} TLexer;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void lexer_init (TLexer* lex, TSrcFile* src, char* const* names);
+extern int lexer_next (TLexer* lex, TToken* tok);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* LEXER_H */
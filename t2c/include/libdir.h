@@ -0,0 +1,45 @@
+#ifndef LIBDIR_H
+#define LIBDIR_H
+
+#include <sys/stat.h>
+
+// Types of directory entries (see TDirEntry)
+#define FS_TYPE_OTHER   0
+#define FS_TYPE_FILE    1   // a regular file
+#define FS_TYPE_DIR     2   // a directory
+
+// The types are those of the files the symbolic links refer to.
+typedef struct
+{
+    char*   name;
+    int     type;   // FS_TYPE_*
+} TDirEntry;
+
+/*
+ * A directory read into memory (see dir_list_open()). The directory stays 
+ * open, so the files in it can be accessed relative to it.
+ */
+typedef struct
+{
+    int         fd;
+    TDirEntry*  entries;    // in the order they have been read
+    int         nEntries;
+    TDirEntry** sorted;     // the entries sorted by name
+} TDirList;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif 
+
+extern int dir_list_open (TDirList* dir, const TDirList* parent, const char* path);
+extern const TDirEntry* dir_list_find (const TDirList* dir, const char* name);
+extern int dir_list_stat (const TDirList* dir, const char* path, struct stat* st);
+extern int dir_list_mkdir (const TDirList* dir, const char* name);
+extern void dir_list_close (TDirList* dir);
+
+#ifdef	__cplusplus
+}
+#endif
+    
+#endif /* LIBDIR_H */
@@ -8,6 +8,59 @@
 #define EXIT_CODE_CANT_OPEN_DIR 105
 #define EXIT_CODE_INPUT_PARSE_ERROR 106
 
+#include <stddef.h>
+#include <stdio.h>
+
+#include "libstr.h"
+
+/*
+ * A text file that has been read into memory as a whole. Each line
+ * (including its '\n', if any) is followed by '\0', so the lines can be 
+ * used in place as ordinary strings. The lines may be modified by the user,
+ * but not made longer.
+ */
+typedef struct
+{
+    char*   data;   // the lines
+    char*   pos;    // the next line to return
+    char*   end;    // the end of the last line
+    size_t  size;   // size of the file
+    int     eof;    // nonzero if the end of the file has been reached
+} TSrcFile;
+
+/*
+ * Buffered output to a file. The data are appended to buf and written to
+ * the file by sink_flush(). If fl is NULL, the data are kept in buf.
+ */
+typedef struct
+{
+    TStrBuf buf;
+    FILE*   fl;
+    size_t  flush_size; // sink_flush() writes nothing while buf is smaller
+    int     error;      // nonzero if writing to fl has failed
+    long long written;  // number of bytes written to fl
+    
+    // The positions recorded by sink_mark() if bMarks is nonzero.
+    int         bMarks;
+    long long*  marks;
+    int         nMarks;
+    int         maxMarks;
+} TOutSink;
+
+/*
+ * A file written through a temporary file in the same directory (see 
+ * out_file_open()). out_file_commit() replaces the file with the temporary
+ * one only if their contents differ, so a file that has not changed keeps
+ * its modification time and the things built from it are not rebuilt.
+ */
+typedef struct
+{
+    FILE*   fl;         // the temporary file, NULL if it could not be created
+    char*   path;
+    char*   tmp_path;
+    int     bChanged;   // nonzero if out_file_commit() has replaced the file
+} TOutFile;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -26,6 +79,22 @@ extern int fsize(FILE* pFile);
 extern char* read_file_to_string (FILE* pFile);
 extern char* shorten_path (char* path_to_shorten);
 
+extern int src_open (TSrcFile* src, const char* filename);
+extern void src_open_mem (TSrcFile* src, const char* text, size_t size);
+extern char* src_next_line (TSrcFile* src);
+extern void src_rewind (TSrcFile* src);
+extern void src_close (TSrcFile* src);
+
+extern void sink_init (TOutSink* sink, FILE* fl, size_t flush_size);
+extern void sink_flush (TOutSink* sink, int force);
+extern void sink_mark (TOutSink* sink, int count);
+extern char* sink_read (TOutSink* sink, long long from, long long to);
+extern void sink_free (TOutSink* sink);
+
+extern FILE* out_file_open (TOutFile* of, const char* path);
+extern int out_file_commit (TOutFile* of);
+extern void out_file_discard (TOutFile* of);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -1,6 +1,22 @@
 #ifndef LIBSTR_H
 #define LIBSTR_H
 
+#include <stddef.h>
+
+/*
+ * A string that knows its length and the size of the memory allocated for it.
+ * The memory grows geometrically, so appending to the string takes
+ * amortized constant time per character.
+ * str is NULL for an empty buffer that has not allocated memory yet,
+ * otherwise it is always 0-terminated.
+ */
+typedef struct 
+{
+    char*   str;
+    size_t  len;
+    size_t  cap;
+} TStrBuf;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -18,6 +34,19 @@ extern char* do_indent (char* source, int spaces_num);
 extern char* convert_to_comment (const char* str);
 extern char* mark_symbol (int n);
 
+extern void strbuf_init (TStrBuf* sb);
+extern void strbuf_init_str (TStrBuf* sb, const char* str);
+extern void strbuf_attach (TStrBuf* sb, char* str);
+extern void strbuf_reserve (TStrBuf* sb, size_t len);
+extern void strbuf_append (TStrBuf* sb, const char* str);
+extern void strbuf_append_n (TStrBuf* sb, const char* str, size_t len);
+extern void strbuf_append_char (TStrBuf* sb, char c);
+extern void strbuf_replace_all (TStrBuf* sb, const char* what, const char* with);
+extern void strbuf_trim (TStrBuf* sb, const char* chars);
+extern const char* strbuf_str (const TStrBuf* sb);
+extern char* strbuf_detach (TStrBuf* sb);
+extern void strbuf_free (TStrBuf* sb);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -1,6 +1,9 @@
 #ifndef PARAM_H_
 #define PARAM_H_
 
+#include "libfile.h"
+#include "template.h"
+
 #ifndef TRUE
     #define TRUE                    1
 #endif
@@ -8,11 +11,8 @@
     #define FALSE                   0
 #endif
 
-#define MAX_COMPONENTS              1000
-#define MAX_LINES                   100
 #define MAX_INT_LENGTH_IN_STR_FORM  5
-#define MAX_LONGINT                 1000000
-#define MAX_STRING_LEGTH            100000
+#define PARAM_NUM_LEN               24  // enough for any long in decimal form
 
 #define EMPTY_STRING                ""
 #define SET                         "SET"
@@ -23,6 +23,12 @@
 #define PARAMS_TAG                  "<%params%>"
 #define FINALLY_TAG                 "<%finally%>"
 #define PARAMNUM_TAG                "<%%%d%%>"
+
+// IDs of the tags in the compiled purpose template 
+// (see expand_purpose())
+#define PTAG_PARAMS_POS             0
+#define PTAG_PURPNUM_POS            1
+#define PTAGS_NUM                   2
 #define COMMENT_NONE                "//    none\n"
 #define COMMENT_POS                 "//    "
 #define STRING_NL                   "\n"
@@ -48,20 +54,30 @@
 #define WARNING_MAX_INT             "Too big number (exceeds MAX_INT)"
 #define WARNING_NO_END              "Close bracket is missing"
 
-enum
+enum ComponentTypes
 {
     COMPONENT_TYPE_STRING = 0,
     COMPONENT_TYPE_INTERVAL
-} ComponentTypes;
+};
 
-enum
+enum LineTypes
 {
     LINE_TYPE_COMMON = 0,
     LINE_TYPE_SET,
     LINE_TYPE_RES
-} LineTypes;
+};
+
+// Types of the parameter values that can be stored in a table 
+// (see expand_purpose_table())
+enum ValueTypes
+{
+    VALUE_OTHER = 0,
+    VALUE_INT,
+    VALUE_DOUBLE,
+    VALUE_STRING
+};
 
-enum 
+enum States
 {
     STATE_INIT = 0,
     STATE_COMMON,
@@ -73,13 +89,13 @@ enum
     STATE_APOSTR,
     STATE_INTERVAL,
     STATE_COLON
-} States;
+};
 
 typedef struct 
 {
     int             Type;
-    char            *str;
-    int             a, b;
+    size_t          off;    // string value: offset in the string pool
+    int             a, b;   // interval: [a, b]
     int             n;
 } TComponent;
     
@@ -87,22 +103,42 @@ typedef struct
 {
     int             Type;
     int             nComponents;
-    TComponent      *Components[MAX_COMPONENTS];
+    int             first;  // index of the first component in the purpose
 } TLine;
 
+/*
+ * The parameters of a test purpose. The components of all lines are stored 
+ * in a single array, the string values - one after another in a single
+ * string pool, so a purpose needs only a few allocations however many 
+ * values it has.
+ */
 typedef struct
 {
     int             nLines;
-    TLine           *Lines[MAX_LINES];
+    int             maxLines;
+    TLine           *Lines;
+    
+    int             nComponents;
+    int             maxComponents;
+    TComponent      *Components;
+    
+    TStrBuf         pool;
 } TPurpose;
 
+// The component i of the line and the string value of a component.
+#define PURP_COMPONENT(purp, line, i)   (&(purp)->Components[(line)->first + (i)])
+#define PURP_STRING(purp, comp)         ((purp)->pool.str + (comp)->off)
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-extern void parse_purpose_line (const char *string, TLine *line, char **warning);
-extern void parameter_and_text_generator (TPurpose *purp, char **text, char *text_tpl, const char *finally_code, long *pa, const int purp_num_real, int k, int *purp_num);
+extern void purpose_init (TPurpose *purp);
+extern void purpose_free (TPurpose *purp);
+extern void parse_purpose_line (const char *string, TPurpose *purp, const char **warning);
+extern int expand_purpose (TPurpose *purp, TOutSink *out, const TTemplate *tpl, int first_num);
+extern int expand_purpose_table (TPurpose *purp, TOutSink *out, const TTemplate *tpl, int first_num);
 
 #ifdef  __cplusplus
 }
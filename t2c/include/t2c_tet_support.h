@@ -25,6 +25,19 @@ extern "C"
 
 // A replacement for tet_printf that takes 'const char*' instead of 'char*'
 int t2c_printf(const char* format, ...);
+
+// Replacements for tet_infoline and tet_result. Like t2c_printf, they write 
+// to the capture file of the test purpose instead of the journal if there 
+// is one (see t2c_concurrent_fork()).
+void t2c_infoline(const char* line);
+void t2c_result(int result);
+
+// The capture file of the journal output of the current process, -1 if 
+// the output goes to the journal directly.
+extern int t2c_capture_fd;
+
+// Pass the output captured in the file 'fd' to the journal.
+void t2c_capture_replay(int fd);
     
 //////////////////////////////////////////////////////////////////////////
 // REQ implementation
@@ -103,6 +116,20 @@ int
 t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
     TUserStartup ustartup, TUserCleanup ucleanup);
 
+// Same as t2c_fork() but the time limit is 'waittime_ms' milliseconds.
+// The parent does not use SIGALRM to wait for the child: it polls a pidfd
+// of the child (Linux 5.3 and newer) or, if there is none, waitpid() with 
+// WNOHANG, so the time limits less than a second are enforced precisely.
+int 
+t2c_fork_ms(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms,
+    TUserStartup ustartup, TUserCleanup ucleanup);
+
+// How long (in milliseconds) a child process that is being killed is given 
+// to exit after SIGTERM and then after SIGKILL. Default: 10 seconds. 
+// The generated tests set it to KILL_WAIT from the config file 
+// (-DT2C_KILL_WAIT_MS).
+extern int t2c_killwait_ms;
+
 // t2c_fork_dbg() is used instead of t2c_fork in the standalone tests
 // (those that do not use TET). This function actually does not fork(),
 // it just executes the test in the same process. This can be useful for 
@@ -117,6 +144,89 @@ int
 t2c_fork_dbg(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
     TUserStartup ustartup, TUserCleanup ucleanup);
 
+// t2c_fork_contained() is used instead of t2c_fork if all tests are executed
+// in the same process (SINGLE_PROCESS=yes in the config file, 
+// -DT2C_SINGLE_PROCESS). Like t2c_fork_dbg(), it does not fork() but it
+// contains the test purpose: if 'childfunc' causes SIGSEGV, SIGBUS, SIGFPE,
+// SIGILL or SIGABRT (the handlers run on an alternate signal stack, so stack 
+// overflows are caught as well) or does not return in 'waittime_ms' 
+// milliseconds (if it is positive; SIGALRM is used for that), the execution continues
+// from t2c_fork_contained(), the signal is reported and -1 is returned, so 
+// the result becomes UNRESOLVED and the remaining test purposes are executed. 
+// 
+// This cannot undo what the test purpose did to the process before it was 
+// interrupted (the memory it corrupted, the locks it held, etc.) and
+// does not help if it calls exit(). 'pcf' is ignored, 'ucleanup' is not 
+// called if the test purpose was interrupted. Like for t2c_fork_ms(), the 
+// time limit is in milliseconds here.
+int 
+t2c_fork_contained(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms,
+    TUserStartup ustartup, TUserCleanup ucleanup);
+
+// The batch mode (BATCH_PURPOSES=yes in the config file, -DT2C_BATCH).
+//
+// t2c_batch_fork() is the same as t2c_fork() without the startup and cleanup,
+// but the test purposes are executed one after another in a single child
+// process rather than each in a new one: the child is created by the first
+// call and then waits for the next test purpose when one has finished. 
+// If a test purpose terminates the child (crashes, calls exit(), stops or 
+// times out), the result is reported for it as t2c_fork() would do and the
+// next test purpose is executed in a new child. The test purposes that
+// complete normally are reported to 'pcf' as if their process had exited 
+// with status 0. Like t2c_fork_ms(), it waits for the child without SIGALRM
+// or SIGCHLD, the time limit is 'waittime_ms' milliseconds.
+// Note that the test purposes executed in the same process may affect each 
+// other, e.g. through the global variables. The ones that should not be 
+// executed this way should be launched with t2c_fork() instead 
+// (see <BLOCK isolated="yes"> in test.tpl).
+int 
+t2c_batch_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms);
+
+// t2c_batch_stop() makes the child created by t2c_batch_fork() exit and 
+// waits for it.
+void 
+t2c_batch_stop();
+
+// The concurrent mode (CONCURRENT_PURPOSES=N in the config file or 
+// "# concurrent_purposes N" in the .t2c-file, -DT2C_CONCURRENT_PURPOSES=N).
+//
+// t2c_concurrent_init() prepares to execute the test purposes 'funcs[0..num-1]'
+// (the test purposes 1..num) so that up to 'max_num' of them run at the same 
+// time, each in its own process (if 'max_num' is 0, as many as there are
+// processors). concurrent[i] is zero for the test purposes that should be 
+// executed alone (<BLOCK concurrent="no">): they are not started until all 
+// the previous ones have terminated, and the next ones are not started 
+// until they have terminated. 'waittime_ms' is the same as for t2c_fork_ms(),
+// the running test purposes are watched with poll() as well.
+// The startup and cleanup instructions are executed in the parent process,
+// as usual.
+//
+// t2c_concurrent_fork() is called for each test purpose instead of t2c_fork():
+// it starts the test purpose 'tet_thistest' and those following it (as many
+// as allowed) if they are not running yet, waits for 'tet_thistest' and 
+// reports its results. The journal output of the test purposes goes to their
+// capture files (see t2c_capture_fd) and is passed to the journal in the 
+// order of the test purposes, so the journal looks the same as if the 
+// purposes were executed one by one. It is the output of tet_infoline, 
+// tet_printf and tet_result (the test code should call them via t2c_infoline, 
+// t2c_printf and t2c_result, see test.tpl) and of the T2C macros. 
+// The return value and 'pcf' are the same as for t2c_fork().
+// Note that the test purposes may be started before TET calls them, so 
+// if only some of them are selected in the scenario, the ones that follow
+// them may be started as well (their results are discarded).
+//
+// t2c_concurrent_stop() kills the test purposes that are still running 
+// (those TET has not called) and frees the resources.
+void 
+t2c_concurrent_init(TChildFunc funcs[], const int concurrent[], int num,
+    int waittime_ms, int max_num);
+
+int 
+t2c_concurrent_fork(TParentControlFunc pcf);
+
+void 
+t2c_concurrent_stop();
+
 // A special pipe for transfering parent-child control data. 
 // [!!!] The pipe must be created BEFORE t2c_fork is called.
 // Usually it will be created in the global TET startup function.
@@ -0,0 +1,203 @@
+#ifndef T2CGEN_H
+#define T2CGEN_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "libfile.h"
+#include "lexer.h"
+#include "template.h"
+#include "gen_stats.h"
+#include "gen_cache.h"
+
+/*
+ * The T2C code generator as a library (t2cgen.a): the code of a test, its
+ * makefile and its record for the scenario file are generated from the text
+ * of a .t2c-file and the texts of the templates, all in memory (see
+ * t2cgen_generate()). No files are read or written, so the library can be
+ * used by other tools, e.g. editors and build systems, as well as by the t2c
+ * program, which reads the sources and the config file and writes the files 
+ * (it uses the lower-level functions below, up to t2cgen_write_files(), to
+ * write large tests without keeping them in memory). The library also 
+ * keeps track of the tests that are up to date (see gen_cache.h and 
+ * t2cgen_settings_hash()). It should be linked with t2c_util.a as well.
+ */
+
+// Kinds of the templates (see t2cgen_tpl_tags()).
+#define T2CGEN_TPL_TEST         0   // test.tpl, part.tpl
+#define T2CGEN_TPL_PURPOSE      1   // purpose.tpl
+#define T2CGEN_TPL_MAKEFILE     2   // default.tmk, flat.tmk, <test>.tmk, ...
+
+// Number of the tags in the templates of the tests (T2CGEN_TPL_TEST).
+#define T2CGEN_TEST_TAGS_NUM    20
+
+// Position of <%test_parts%> among the tags of the makefile templates:
+// a test is split between several files only if its makefile lists them.
+#define T2CGEN_MK_PARTS_POS     4
+
+// Number of the parameters read from the header of a .t2c-file.
+#define T2CGEN_HDR_PARAMS_NUM   5
+
+// Version of the generator. Must be increased each time the code generated
+// for the same .t2c-file, templates and settings changes: the tests cached
+// by the t2c program are regenerated then.
+#define T2CGEN_VERSION          3
+
+/*
+ * The settings of the generator that are the same for all the tests
+ * (see t2cgen_settings_init() for the defaults). The strings are not copied.
+ */
+typedef struct
+{
+    int         bGenCpp;        // 1 - generate C++ code, 0 - plain C (LANGUAGE)
+    int         bParamTables;   // see PARAM_TABLES in the config file
+    int         nSplitPurposes; // see SPLIT_PURPOSES in the config file
+    const char* wait_time;      // <%wait_time%>, <%wait_time_ms%>, see WAIT_TIME
+    const char* year;           // <%year%>
+    const char* test_dir;       // <%suite_subdir%>: the test suite directory
+                                // relative to $T2C_SUITE_ROOT
+
+    // Called before a .t2c-file is parsed, e.g. to report the progress
+    // (may be called from several threads at once), NULL if not needed.
+    // The library itself writes nothing to stdout.
+    void (*on_parse) (const char* input_path);
+} TGenSettings;
+
+/* The state of the generator that belongs to a single .t2c-file. Each file
+ * is processed with its own context, so several files can be parsed and
+ * generated at the same time (see t2cgen_context_init()).
+ */
+typedef struct
+{
+    const TGenSettings* cfg;
+
+    // Values of the parameters from the header of the .t2c-file
+    // (see t2cgen_parse_header()).
+    char* hdr_param_value[T2CGEN_HDR_PARAMS_NUM];
+
+    // The .t2c-file being processed
+    TSrcFile* src;
+
+    // Number of current line in the .t2c-file
+    int ln_count;
+
+    // The tokens of the .t2c-file (see lexer.h)
+    TLexer lex;
+
+    // If nonzero, the code of the test purposes is kept in memory rather
+    // than written to a temporary file.
+    int bInMemory;
+
+    // Test purposes implemented by a single function (see PARAM_TABLES):
+    // shared_tp[2*i] is the number of the first of them, shared_tp[2*i+1] -
+    // how many there are.
+    int* shared_tp;
+    int nShared;
+    int maxShared;
+
+    // The statistics of the generation of this test.
+    TGenStats* stats;
+} TGenContext;
+
+// The generated code of a test before it is written to the output file.
+typedef struct
+{
+    // Values of the tags of the test template except the code of the test
+    // purposes.
+    char* tag_values[T2CGEN_TEST_TAGS_NUM];
+
+    // The code of the test purposes. It is written to a temporary file
+    // as it is generated, so the memory needed does not grow with
+    // the number of the purposes.
+    TOutSink purposes;
+
+    // The test purposes may be split between several files (see
+    // split_test()): the code of part i ends at part_off[i] in 'purposes',
+    // part_funcs[i] is added after it. Part 0 goes to the main file.
+    int nParts;
+    long long* part_off;
+    char** part_funcs;
+
+    // The header with the GLOBAL section for the other parts, 
+    // <test>_globals.h (NULL if the test is not split).
+    char* globals_hdr;
+} TGenTest;
+
+// A test to be generated by t2cgen_generate().
+typedef struct
+{
+    const char* src;            // the contents of the .t2c-file
+    size_t      src_size;
+    const char* input_path;     // the path to the .t2c-file, for the messages
+                                // and <%ftemplate%>
+    const char* group_nme;
+    const char* test_nme;
+
+    // The texts of the templates. part_tpl may be NULL if the test should
+    // not be split, mk_tpl - if no makefile is needed.
+    const char* test_tpl;
+    const char* purpose_tpl;
+    const char* part_tpl;
+    const char* mk_tpl;
+
+    // The directory of the test suite and the directory where the directory
+    // of the test will be, for the makefile and the scenario record.
+    const char* suite_root;
+    const char* output_dir;
+} TGenInput;
+
+// The results of t2cgen_generate(), see t2cgen_output_free().
+typedef struct
+{
+    int         nFiles;
+    char**      file_names;     // <test>.c, <test>_part1.c, ..., 
+                                // <test>_globals.h
+    char**      files;          // the code in these files
+    char*       makefile;       // NULL if there is no makefile template
+    char*       scen_record;    // the line for the scenario file
+    TGenStats   stats;
+} TGenOutput;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void t2cgen_settings_init (TGenSettings* cfg);
+extern THash t2cgen_settings_hash (const TGenSettings* cfg);
+extern char** t2cgen_tpl_tags (int kind, int* nTags);
+extern TTemplate* t2cgen_compile_template (int kind, const char* text);
+
+extern int t2cgen_generate (const TGenSettings* cfg, const TGenInput* in, TGenOutput* out);
+extern void t2cgen_output_free (TGenOutput* out);
+
+extern void t2cgen_context_init (TGenContext* ctx, const TGenSettings* cfg,
+                                 TSrcFile* src, TGenStats* stats);
+extern void t2cgen_context_free (TGenContext* ctx);
+extern void t2cgen_parse_header (TGenContext* ctx);
+extern int t2cgen_concurrency (const char* value);
+extern int t2cgen_wait_time_ms (const char* value);
+extern int t2cgen_prepare (TGenContext* ctx, const TTemplate* purpose_tpl,
+                           const char* input_path, const char* group_nme,
+                           const char* test_nme, int split, TGenTest* test);
+extern int t2cgen_write_test (FILE* out, const TTemplate* test_tpl, TGenTest* test, int part);
+extern char* t2cgen_render_test (const TTemplate* test_tpl, TGenTest* test, int part);
+extern int t2cgen_write_files (const TGenSettings* cfg, TGenTest* test, 
+                               const TTemplate* test_tpl, const TTemplate* part_tpl,
+                               const char* dir_path, const char* ftest_nme, 
+                               TGenStats* stats);
+extern void t2cgen_free_test (TGenTest* test);
+extern char* t2cgen_render_makefile (const TGenContext* ctx, const char* suite_root,
+                                     const char* dir_path, const char* ftest_nme,
+                                     const TTemplate* makefile_tpl, int nParts);
+extern char* t2cgen_scen_record (const char* suite_root, const char* output_dir,
+                                 const char* ftest_nme);
+extern char* t2cgen_test_dir_path (const char* output_dir, const char* ftest_nme);
+extern char* t2cgen_file_name (const TGenSettings* cfg, const char* ftest_nme, int part);
+extern char* t2cgen_globals_hdr_name (const char* ftest_nme);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* T2CGEN_H */
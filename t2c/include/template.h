@@ -0,0 +1,82 @@
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "libstr.h"
+
+// Flags for tpl_compile()
+#define TPL_NUMERIC_TAGS    1   // recognize <%N%> tags (N is a decimal number)
+
+#define TPL_TAG_OPEN        "<%"
+#define TPL_TAG_CLOSE       "%>"
+
+/* 
+ * A part of the template: either a piece of text (tag < 0) or a tag.
+ * For a tag, off and len specify the tag itself in the template text. 
+ * It is left as is if no value is provided for it.
+ */
+typedef struct
+{
+    size_t          off;
+    size_t          len;
+    int             tag;
+} TTplSegment;
+
+/*
+ * A compiled template. Tag IDs are the indices in the array of tag names
+ * passed to tpl_compile(). <%N%> has ID (nTags + N).
+ */
+typedef struct
+{
+    char*           text;
+    TTplSegment*    segs;
+    int             nSegs;
+    int             nTags;
+} TTemplate;
+
+/*
+ * The templates loaded from the files, each compiled once. A template is
+ * identified by the path to its file and the tags it was compiled with.
+ */
+typedef struct
+{
+    char*           path;
+    char* const*    tag_names;
+    int             flags;
+    TTemplate*      tpl;        // NULL if the file could not be read
+} TTplEntry;
+
+typedef struct
+{
+    TTplEntry*      entries;
+    int             nEntries;
+} TTplRegistry;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern TTemplate* tpl_compile (const char* text, char* const tag_names[], int nTags, int flags);
+extern void tpl_free (TTemplate* tpl);
+
+extern void tpl_render_to (TStrBuf* out, const TTemplate* tpl, char* const values[], 
+                           char* const params[], int nParams);
+extern char* tpl_render (const TTemplate* tpl, char* const values[], 
+                         char* const params[], int nParams);
+extern int tpl_write (FILE* out, const TTemplate* tpl, char* const values[], 
+                      FILE* const streams[], char* const params[], int nParams);
+extern int tpl_has_tag (const TTemplate* tpl, int tag);
+
+extern void tpl_registry_init (TTplRegistry* reg);
+extern const TTemplate* tpl_registry_get (TTplRegistry* reg, const char* path, 
+                                          char* const tag_names[], int nTags, int flags);
+extern void tpl_registry_free (TTplRegistry* reg);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* TEMPLATE_H */
@@ -0,0 +1,49 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+// The tag passed to the callback of watcher_wait() if some events have been
+// lost (the queue of the events has overflowed): anything may have changed.
+#define WATCH_TAG_ALL   (-1)
+
+// A directory being watched, see watcher_add().
+typedef struct
+{
+    int     wd;         // inotify watch descriptor
+    int     tag;        // set by the caller
+    char*   path;
+} TWatch;
+
+/*
+ * A set of directories watched for the changes of the files in them
+ * (see watcher_init()).
+ */
+typedef struct
+{
+    int         fd;         // inotify instance
+    TWatch*     watches;
+    int         nWatches;
+} TWatcher;
+
+/*
+ * Called by watcher_wait() for each change: 'name' is the name of the file
+ * or subdirectory that has been changed (created, written, moved, deleted)
+ * in the directory with the given tag, "" if the directory itself has been
+ * removed or moved. bDir is nonzero if it is a directory.
+ */
+typedef void (*TWatchFunc) (void* data, int tag, const char* name, int bDir);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern int watcher_init (TWatcher* w);
+extern int watcher_add (TWatcher* w, const char* path, int tag);
+extern int watcher_wait (TWatcher* w, int quiet_ms, TWatchFunc func, void* data);
+extern void watcher_close (TWatcher* w);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* WATCH_H */
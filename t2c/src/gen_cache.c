@@ -0,0 +1,300 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../include/libmem.h"
+#include "../include/libstr.h"
+#include "../include/libfile.h"
+#include "../include/gen_cache.h"
+
+#define HASH_PRIME          1099511628211ULL
+#define CACHE_SIGNATURE     "T2C-CACHE"
+#define HASH_BUF_SIZE       65536
+
+/*
+ * Incremental generation cache. 
+ *
+ * For each test generated successfully, the cache file stores the hash of 
+ * the .t2c-file, the hash of everything else the generated code depends on 
+ * (templates, configuration) and the size and mtime of the .t2c-file. The 
+ * latter two allow to skip reading the file if it has not been touched 
+ * since the previous run.
+ *
+ * The format of the file is:
+ *   T2C-CACHE <version> <stamp>
+ *   <src_hash> <env_hash> <mtime> <size> <path>
+ *   ...
+ */
+
+THash
+hash_data (THash h, const void* data, size_t len)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    size_t i;
+    
+    for (i = 0; i < len; ++i)
+    {
+        h ^= p[i];
+        h *= HASH_PRIME;
+    }
+    return h;
+}
+
+/*
+ * The terminating 0 is hashed too, so that ("ab", "c") and ("a", "bc")
+ * give different results.
+ */
+THash
+hash_string (THash h, const char* str)
+{
+    if (str == NULL)
+    {
+        str = "";
+    }
+    return hash_data (h, str, strlen (str) + 1);
+}
+
+/*
+ * Calculate the hash of the contents of the file. Returns 1 on success, 
+ * 0 if the file can not be read.
+ */
+int
+hash_file (const char* path, THash* res)
+{
+    FILE* fd;
+    char* buf = NULL;
+    size_t n;
+    THash h = HASH_INIT;
+    
+    fd = fopen (path, "rb");
+    if (fd == NULL)
+    {
+        return 0;
+    }
+    
+    buf = (char*)alloc_mem (buf, HASH_BUF_SIZE, sizeof (char));
+    while ((n = fread (buf, 1, HASH_BUF_SIZE, fd)) > 0)
+    {
+        h = hash_data (h, buf, n);
+    }
+    
+    n = ferror (fd);
+    fclose (fd);
+    free (buf);
+    
+    if (n)
+    {
+        return 0;
+    }
+    *res = h;
+    return 1;
+}
+
+static int 
+cmp_entries (const void* a, const void* b)
+{
+    return strcmp (((const TCacheEntry*)a)->path, ((const TCacheEntry*)b)->path);
+}
+
+/*
+ * Load the cache from the specified file. If the file does not exist 
+ * or is invalid, the cache will be empty.
+ */
+void 
+gen_cache_load (TGenCache* cache, const char* path)
+{
+    FILE* fd;
+    char* data = NULL;
+    char* line = NULL;
+    char* next = NULL;
+    int ver = 0;
+    
+    cache->entries = NULL;
+    cache->nEntries = 0;
+    cache->stamp = 0;
+    
+    fd = fopen (path, "r");
+    if (fd == NULL)
+    {
+        return;
+    }
+    data = read_file_to_string (fd);
+    fclose (fd);
+    
+    if ((data == NULL) || 
+        (sscanf (data, CACHE_SIGNATURE " %d %lld", &ver, &cache->stamp) != 2) ||
+        (ver != GEN_CACHE_VERSION))
+    {
+        cache->stamp = 0;
+        free (data);
+        return;
+    }
+    
+    next = strchr (data, '\n');
+    while (next != NULL)
+    {
+        TCacheEntry e;
+        int pos = 0;
+        
+        line = next + 1;
+        next = strchr (line, '\n');
+        if (next != NULL)
+        {
+            *next = 0;
+        }
+        
+        if ((sscanf (line, "%llx %llx %lld %lld %n", &e.src_hash, &e.env_hash, 
+                     &e.mtime, &e.size, &pos) < 4) || (pos == 0) || (line[pos] == 0))
+        {
+            continue;
+        }
+        
+        e.path = strdup (line + pos);
+        cache->entries = (TCacheEntry*)alloc_mem (cache->entries, cache->nEntries + 1, 
+                                                  sizeof (TCacheEntry));
+        cache->entries[cache->nEntries++] = e;
+    }
+    free (data);
+    
+    if (cache->nEntries > 1)
+    {
+        qsort (cache->entries, cache->nEntries, sizeof (TCacheEntry), cmp_entries);
+    }
+}
+
+/*
+ * Find the record for the specified .t2c-file. Returns NULL if there is none.
+ */
+const TCacheEntry* 
+gen_cache_find (const TGenCache* cache, const char* path)
+{
+    TCacheEntry key;
+    
+    if (cache->nEntries == 0)
+    {
+        return NULL;
+    }
+    
+    key.path = (char*)path;
+    return (const TCacheEntry*)bsearch (&key, cache->entries, cache->nEntries, 
+                                        sizeof (TCacheEntry), cmp_entries);
+}
+
+/*
+ * Fill *rec for the .t2c-file 'path' generated with the templates and 
+ * settings whose hash is 'env_hash' (rec->path is not copied). Returns 1 
+ * if 'cache' (may be NULL) has the same record, i.e. the test generated from
+ * the file is up to date if its files are still there, 0 otherwise.
+ */
+int
+gen_cache_check (const TGenCache* cache, const char* path, THash env_hash,
+                 TCacheEntry* rec)
+{
+    struct stat st;
+    const TCacheEntry* e = NULL;
+    
+    rec->path = (char*)path;
+    rec->env_hash = env_hash;
+    rec->src_hash = 0;
+    rec->mtime = -1;
+    rec->size = -1;
+    
+    if (stat (path, &st) == 0)
+    {
+        rec->mtime = (long long)st.st_mtime;
+        rec->size = (long long)st.st_size;
+    }
+    
+    if (cache != NULL)
+    {
+        e = gen_cache_find (cache, path);
+    }
+    
+    if ((e != NULL) && (e->env_hash == rec->env_hash) &&
+        (e->mtime == rec->mtime) && (e->size == rec->size) &&
+        (e->mtime < cache->stamp))
+    {   
+        // The file has not been touched since the previous run (if it had 
+        // been modified during that run, its mtime would not be less than 
+        // the stamp), so there is no need to read it.
+        rec->src_hash = e->src_hash;
+    }
+    else if (!hash_file (path, &rec->src_hash))
+    {
+        return 0;
+    }
+    
+    return ((e != NULL) && (e->env_hash == rec->env_hash) && 
+            (e->src_hash == rec->src_hash));
+}
+
+/*
+ * Write the cache to the specified file. The data are written to a temporary 
+ * file first, so the cache file is never left half-written.
+ * Returns 1 on success, 0 otherwise.
+ */
+int 
+gen_cache_save (const TGenCache* cache, const char* path)
+{
+    FILE* fd;
+    char* tmp_path = NULL;
+    int i;
+    int bOK = 1;
+    
+    tmp_path = str_sum (path, ".tmp");
+    fd = fopen (tmp_path, "w");
+    if (fd == NULL)
+    {
+        free (tmp_path);
+        return 0;
+    }
+    
+    fprintf (fd, "%s %d %lld\n", CACHE_SIGNATURE, GEN_CACHE_VERSION, cache->stamp);
+    for (i = 0; i < cache->nEntries; ++i)
+    {
+        const TCacheEntry* e = &cache->entries[i];
+        fprintf (fd, "%016llx %016llx %lld %lld %s\n", e->src_hash, e->env_hash, 
+                 e->mtime, e->size, e->path);
+    }
+    
+    if (ferror (fd))
+    {
+        bOK = 0;
+    }
+    if (fclose (fd) != 0)
+    {
+        bOK = 0;
+    }
+    
+    if (bOK && (rename (tmp_path, path) != 0))
+    {
+        bOK = 0;
+    }
+    if (!bOK)
+    {
+        remove (tmp_path);
+    }
+    
+    free (tmp_path);
+    return bOK;
+}
+
+void 
+gen_cache_free (TGenCache* cache)
+{
+    int i;
+    
+    for (i = 0; i < cache->nEntries; ++i)
+    {
+        free (cache->entries[i].path);
+    }
+    free (cache->entries);
+    
+    cache->entries = NULL;
+    cache->nEntries = 0;
+}
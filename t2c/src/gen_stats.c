@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "../include/gen_stats.h"
+
+#define BYTES_IN_MB         (1024.0 * 1024.0)
+
+/*
+ * Statistics of the code generator ("t2c -t ...").
+ *
+ * Each job collects the statistics for its test, so no locking is needed;
+ * they are summed up when all the jobs are done. The time of the phases is
+ * therefore the total time spent by all the threads, which can be greater
+ * than the wall-clock time of the generation if several threads are used.
+ *
+ * "t2c --stats <file> ..." writes the statistics for each test and the 
+ * totals to a file, in CSV format if the name of the file ends with ".csv",
+ * in JSON format otherwise.
+ */
+
+static const char* phase_names[PHASES_NUM] = {
+    "header",
+    "sections",
+    "purposes",
+    "templates",
+    "output"
+};
+
+// Current time (in seconds) from a monotonic clock.
+double
+stats_time (void)
+{
+    struct timespec ts;
+
+    if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0)
+    {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void
+stats_init (TGenStats* stats)
+{
+    memset (stats, 0, sizeof (TGenStats));
+}
+
+void
+stats_add (TGenStats* to, const TGenStats* from)
+{
+    int i;
+
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        to->phase_time[i] += from->phase_time[i];
+    }
+    to->nFiles += from->nFiles;
+    to->nCached += from->nCached;
+    to->nFailed += from->nFailed;
+    to->nBlocks += from->nBlocks;
+    to->nPurposes += from->nPurposes;
+    to->nCombinations += from->nCombinations;
+    to->bytes_in += from->bytes_in;
+    to->bytes_out += from->bytes_out;
+}
+
+// Peak resident set size of the process (in kilobytes), 0 if unknown.
+long
+stats_peak_rss (void)
+{
+    struct rusage ru;
+
+    if (getrusage (RUSAGE_SELF, &ru) != 0)
+    {
+        return 0;
+    }
+    return ru.ru_maxrss;
+}
+
+void
+stats_heap (THeapStats* hs)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 mi = mallinfo2 ();
+#elif defined(__GLIBC__)
+    struct mallinfo mi = mallinfo ();
+#endif
+
+#ifdef __GLIBC__
+    hs->arena = (long long)mi.arena;
+    hs->mmapped = (long long)mi.hblkhd;
+    hs->in_use = (long long)mi.uordblks;
+    hs->free_space = (long long)mi.fordblks;
+#else
+    hs->arena = -1;
+    hs->mmapped = -1;
+    hs->in_use = -1;
+    hs->free_space = -1;
+#endif
+}
+
+// Rate of 'amount' per second, 0 if the time is too small to measure.
+static double
+per_second (double amount, double time)
+{
+    return (time > 0.0) ? amount / time : 0.0;
+}
+
+void
+stats_print (FILE* out, const TGenStats* stats, double wall_time, int nThreads)
+{
+    double total = 0.0;
+    int i;
+
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        total += stats->phase_time[i];
+    }
+
+    fprintf (out, "\nGeneration statistics:\n");
+    fprintf (out, "    tests generated:   %ld (%ld up to date)\n",
+             stats->nFiles, stats->nCached);
+    if (stats->nFailed > 0)
+    {
+        fprintf (out, "    tests failed:      %ld\n", stats->nFailed);
+    }
+    fprintf (out, "    blocks:            %ld\n", stats->nBlocks);
+    fprintf (out, "    test purposes:     %ld (%ld from parameter combinations)\n", 
+             stats->nPurposes, stats->nCombinations);
+    fprintf (out, "    input:             %.2f MB\n", stats->bytes_in / BYTES_IN_MB);
+    fprintf (out, "    output:            %.2f MB\n", stats->bytes_out / BYTES_IN_MB);
+    fprintf (out, "    time:              %.3f s (%d thread(s))\n", wall_time, nThreads);
+
+    fprintf (out, "    phases (summed over the threads):\n");
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        fprintf (out, "        %-13s  %.3f s (%.1f%%)\n", phase_names[i],
+                 stats->phase_time[i],
+                 (total > 0.0) ? 100.0 * stats->phase_time[i] / total : 0.0);
+    }
+
+    fprintf (out, "    files/s:           %.1f\n",
+             per_second ((double)stats->nFiles, wall_time));
+    fprintf (out, "    purposes/s:        %.1f\n",
+             per_second ((double)stats->nPurposes, wall_time));
+    fprintf (out, "    MB/s (input):      %.2f\n",
+             per_second (stats->bytes_in / BYTES_IN_MB, wall_time));
+    fprintf (out, "    MB/s (output):     %.2f\n",
+             per_second (stats->bytes_out / BYTES_IN_MB, wall_time));
+    fprintf (out, "    peak RSS:          %ld KB\n", stats_peak_rss ());
+}
+
+// Write a string as a JSON string literal.
+static void
+json_string (FILE* out, const char* str)
+{
+    const unsigned char* p;
+    
+    fputc ('"', out);
+    for (p = (const unsigned char*)(str ? str : ""); *p; ++p)
+    {
+        if ((*p == '"') || (*p == '\\'))
+        {
+            fputc ('\\', out);
+            fputc (*p, out);
+        }
+        else if (*p < 0x20)
+        {
+            fprintf (out, "\\u%04x", *p);
+        }
+        else
+        {
+            fputc (*p, out);
+        }
+    }
+    fputc ('"', out);
+}
+
+// Write the fields of TGenStats as the members of a JSON object.
+static void
+json_stats (FILE* out, const TGenStats* stats, const char* indent)
+{
+    int i;
+    
+    fprintf (out, "%s\"blocks\": %ld,\n", indent, stats->nBlocks);
+    fprintf (out, "%s\"purposes\": %ld,\n", indent, stats->nPurposes);
+    fprintf (out, "%s\"combinations\": %ld,\n", indent, stats->nCombinations);
+    fprintf (out, "%s\"bytes_in\": %lld,\n", indent, stats->bytes_in);
+    fprintf (out, "%s\"bytes_out\": %lld,\n", indent, stats->bytes_out);
+    fprintf (out, "%s\"time\": {", indent);
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        fprintf (out, "%s\"%s\": %.6f", (i > 0) ? ", " : "", 
+                 phase_names[i], stats->phase_time[i]);
+    }
+    fprintf (out, "}");
+}
+
+static void
+write_json (FILE* out, const char* suite, const TFileStats* files, int nFiles, 
+            const TGenStats* total, double wall_time, int nThreads)
+{
+    THeapStats hs;
+    int i;
+    
+    stats_heap (&hs);
+    
+    fprintf (out, "{\n    \"suite\": ");
+    json_string (out, suite);
+    fprintf (out, ",\n    \"threads\": %d,\n", nThreads);
+    fprintf (out, "    \"wall_time\": %.6f,\n", wall_time);
+    fprintf (out, "    \"peak_rss_kb\": %ld,\n", stats_peak_rss ());
+    fprintf (out, "    \"heap\": {\"arena\": %lld, \"mmapped\": %lld, "
+                  "\"in_use\": %lld, \"free\": %lld},\n",
+             hs.arena, hs.mmapped, hs.in_use, hs.free_space);
+    
+    fprintf (out, "    \"total\": {\n");
+    fprintf (out, "        \"generated\": %ld,\n", total->nFiles);
+    fprintf (out, "        \"up_to_date\": %ld,\n", total->nCached);
+    fprintf (out, "        \"failed\": %ld,\n", total->nFailed);
+    json_stats (out, total, "        ");
+    fprintf (out, "\n    },\n");
+    
+    fprintf (out, "    \"files\": [");
+    for (i = 0; i < nFiles; ++i)
+    {
+        fprintf (out, "%s\n        {\n            \"path\": ", (i > 0) ? "," : "");
+        json_string (out, files[i].path);
+        fprintf (out, ",\n            \"group\": ");
+        json_string (out, files[i].group);
+        fprintf (out, ",\n            \"test\": ");
+        json_string (out, files[i].test);
+        fprintf (out, ",\n            \"status\": ");
+        json_string (out, files[i].status);
+        fprintf (out, ",\n");
+        json_stats (out, files[i].stats, "            ");
+        fprintf (out, "\n        }");
+    }
+    fprintf (out, "\n    ]\n}\n");
+}
+
+// Write a field of a CSV record, quoted if needed.
+static void
+csv_string (FILE* out, const char* str)
+{
+    const char* p;
+    
+    str = str ? str : "";
+    if (strpbrk (str, ",\"\r\n") == NULL)
+    {
+        fputs (str, out);
+        return;
+    }
+    
+    fputc ('"', out);
+    for (p = str; *p; ++p)
+    {
+        if (*p == '"')
+        {
+            fputc ('"', out);
+        }
+        fputc (*p, out);
+    }
+    fputc ('"', out);
+}
+
+static void
+csv_record (FILE* out, const char* suite, const char* path, const char* group, 
+            const char* test, const char* status, const TGenStats* stats)
+{
+    int i;
+    
+    csv_string (out, suite);
+    fputc (',', out);
+    csv_string (out, path);
+    fputc (',', out);
+    csv_string (out, group);
+    fputc (',', out);
+    csv_string (out, test);
+    fputc (',', out);
+    csv_string (out, status);
+    fprintf (out, ",%ld,%ld,%ld,%lld,%lld", stats->nBlocks, stats->nPurposes, 
+             stats->nCombinations, stats->bytes_in, stats->bytes_out);
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        fprintf (out, ",%.6f", stats->phase_time[i]);
+    }
+}
+
+/*
+ * One record for each test and a record with the totals (its status is
+ * "total"). The columns that only make sense for the whole run are empty
+ * in the records for the tests.
+ */
+static void
+write_csv (FILE* out, const char* suite, const TFileStats* files, int nFiles, 
+           const TGenStats* total, double wall_time, int nThreads)
+{
+    THeapStats hs;
+    int i;
+    
+    stats_heap (&hs);
+    
+    fprintf (out, "suite,path,group,test,status,blocks,purposes,combinations,"
+                  "bytes_in,bytes_out");
+    for (i = 0; i < PHASES_NUM; ++i)
+    {
+        fprintf (out, ",time_%s", phase_names[i]);
+    }
+    fprintf (out, ",wall_time,threads,peak_rss_kb,heap_arena,heap_mmapped,"
+                  "heap_in_use,heap_free\n");
+    
+    for (i = 0; i < nFiles; ++i)
+    {
+        csv_record (out, suite, files[i].path, files[i].group, files[i].test, 
+                    files[i].status, files[i].stats);
+        fprintf (out, ",,,,,,,\n");
+    }
+    
+    csv_record (out, suite, "", "", "", "total", total);
+    fprintf (out, ",%.6f,%d,%ld,%lld,%lld,%lld,%lld\n", wall_time, nThreads, 
+             stats_peak_rss (), hs.arena, hs.mmapped, hs.in_use, hs.free_space);
+}
+
+/*
+ * Write the statistics to the file 'path'. Returns 1 on success, 0 otherwise.
+ */
+int
+stats_write (const char* path, const char* suite, const TFileStats* files, 
+             int nFiles, const TGenStats* total, double wall_time, int nThreads)
+{
+    size_t len = strlen (path);
+    size_t ext_len = strlen (STATS_CSV_EXT);
+    FILE* out = fopen (path, "w");
+    int bOK;
+    
+    if (out == NULL)
+    {
+        return 0;
+    }
+    
+    if ((len >= ext_len) && !strcmp (path + len - ext_len, STATS_CSV_EXT))
+    {
+        write_csv (out, suite, files, nFiles, total, wall_time, nThreads);
+    }
+    else
+    {
+        write_json (out, suite, files, nFiles, total, wall_time, nThreads);
+    }
+    
+    bOK = !ferror (out);
+    if (fclose (out) != 0)
+    {
+        bOK = 0;
+    }
+    return bOK;
+}
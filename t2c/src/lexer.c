@@ -0,0 +1,239 @@
+#include <string.h>
+
+#include "../include/lexer.h"
+
+#define TRUE 1
+#define FALSE 0
+
+/*
+ * The lexer of the .t2c-files. Each line is read once and classified by its
+ * first non-blank character: only the lines beginning with '<' may be tags
+ * and only those beginning with '#' may be comments, all the other lines are
+ * text and are not looked at any further.
+ */
+
+// Preprocessor directives (without '#'). The other lines beginning with '#'
+// are comments.
+static const char* directives[] = {
+    "define", "undef",
+    "include",
+    "if", "elif", "else", "endif",
+    "ifdef", "ifndef",
+    "error",
+    "import",
+    "pragma",
+    "line",
+    NULL
+};
+
+static int
+is_blank (char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static const char*
+skip_blanks (const char* p)
+{
+    while (is_blank (*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+// Nonzero if there is nothing but whitespace from p to the end of the line.
+static int
+is_rest_blank (const char* p)
+{
+    return *skip_blanks (p) == 0;
+}
+
+// Nonzero if the line (beginning with '#') is a preprocessor directive.
+static int
+is_directive (const char* str)
+{
+    const char* p = str + 1;
+    size_t len;
+    int i;
+
+    while ((*p >= 'a') && (*p <= 'z'))
+    {
+        ++p;
+    }
+    if (!is_blank (*p))
+    {
+        return FALSE;
+    }
+
+    len = (size_t)(p - str - 1);
+    for (i = 0; directives[i] != NULL; ++i)
+    {
+        if ((strlen (directives[i]) == len) && !strncmp (str + 1, directives[i], len))
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// Index of the name [name, name + len) in lex->names, -1 if it is unknown.
+static int
+find_name (const TLexer* lex, const char* name, size_t len)
+{
+    int i;
+
+    for (i = 0; lex->names[i] != NULL; ++i)
+    {
+        if ((strlen (lex->names[i]) == len) && !strncmp (name, lex->names[i], len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Recognize "</NAME>" at p (the first non-blank character of the line).
+ * The same syntax as t2c_parse_close_tag() accepts.
+ */
+static int
+lex_close_tag (const TLexer* lex, const char* p, TToken* tok)
+{
+    const char* fin;
+    int tag;
+
+    if (p[2] == '>')
+    {
+        return FALSE;
+    }
+
+    fin = strchr (p + 2, '>');
+    if ((fin == NULL) || !is_rest_blank (fin + 1))
+    {
+        return FALSE;
+    }
+
+    tag = find_name (lex, p + 2, (size_t)(fin - p - 2));
+    if (tag < 0)
+    {
+        return FALSE;
+    }
+
+    tok->kind = TOKEN_CLOSE;
+    tok->tag = tag;
+    return TRUE;
+}
+
+/*
+ * Recognize "<NAME attributes>" at p (the first non-blank character of the
+ * line). The same syntax as t2c_parse_open_tag() accepts.
+ */
+static int
+lex_open_tag (const TLexer* lex, const char* p, TToken* tok)
+{
+    const char* name = skip_blanks (p + 1);
+    const char* fin = name;
+    const char* attr;
+    int tag;
+
+    while ((*fin != 0) && (*fin != '>') && !is_blank (*fin))
+    {
+        ++fin;
+    }
+    if ((*fin == 0) || (fin == name))
+    {
+        return FALSE;
+    }
+
+    tag = find_name (lex, name, (size_t)(fin - name));
+    if (tag < 0)
+    {
+        return FALSE;
+    }
+
+    tok->attribs = NULL;
+    tok->attribs_len = 0;
+    if (*fin == '>')
+    {
+        if (!is_rest_blank (fin + 1))
+        {
+            return FALSE;
+        }
+    }
+    else
+    {
+        attr = skip_blanks (fin + 1);
+        if (*attr != '>')
+        {
+            fin = strchr (attr, '>');
+            if ((fin == NULL) || !is_rest_blank (fin + 1))
+            {
+                return FALSE;
+            }
+            tok->attribs = attr;
+            tok->attribs_len = (size_t)(fin - attr);
+        }
+    }
+
+    tok->kind = TOKEN_OPEN;
+    tok->tag = tag;
+    return TRUE;
+}
+
+/*
+ * Prepare to read the tokens of 'src' from its current line. 'names' are
+ * the names of the tags to recognize.
+ */
+void
+lexer_init (TLexer* lex, TSrcFile* src, char* const* names)
+{
+    lex->src = src;
+    lex->names = names;
+    lex->line = 0;
+}
+
+/*
+ * Read the next token. Returns 0 if the end of the file is reached
+ * (lex->line is then the number of the lines + 1), 1 otherwise.
+ */
+int
+lexer_next (TLexer* lex, TToken* tok)
+{
+    char* str;
+    const char* p;
+
+    if (lex->src->eof)
+    {
+        return FALSE;
+    }
+
+    do
+    {
+        str = src_next_line (lex->src);
+        ++lex->line;
+        if (str == NULL)
+        {
+            return FALSE;
+        }
+    }
+    while ((str[0] == '#') && !is_directive (str));
+
+    tok->kind = TOKEN_TEXT;
+    tok->tag = -1;
+    tok->line = lex->line;
+    tok->str = str;
+    tok->attribs = NULL;
+    tok->attribs_len = 0;
+
+    p = skip_blanks (str);
+    if (p[0] == '<')
+    {
+        if ((p[1] != '/') || !lex_close_tag (lex, p, tok))
+        {
+            lex_open_tag (lex, p, tok);
+        }
+    }
+
+    return TRUE;
+}
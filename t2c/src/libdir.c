@@ -0,0 +1,215 @@
+// openat(), fstatat(), mkdirat(), fdopendir() are from POSIX.1-2008, 
+// d_type of the directory entries is a BSD extension.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#ifndef _BSD_SOURCE
+#define _BSD_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../include/libdir.h"
+#include "../include/libmem.h"
+
+#define TRUE 1
+#define FALSE 0
+
+/*
+ * Directory listings.
+ *
+ * A directory is read only once, the names and the types of its entries 
+ * are kept in memory, so checking whether a file or a subdirectory exists
+ * needs no system calls. The types are mostly known from readdir() 
+ * (d_type), stat() is only needed for the symbolic links and if the file 
+ * system does not provide the types. The directory is kept open and the 
+ * files in it are accessed relative to it rather than by their full paths.
+ */
+
+static int
+entry_type (int dir_fd, const struct dirent* ep)
+{
+    struct stat st;
+    
+#ifdef _DIRENT_HAVE_D_TYPE
+    if (ep->d_type == DT_DIR)
+    {
+        return FS_TYPE_DIR;
+    }
+    if (ep->d_type == DT_REG)
+    {
+        return FS_TYPE_FILE;
+    }
+    if ((ep->d_type != DT_UNKNOWN) && (ep->d_type != DT_LNK))
+    {
+        return FS_TYPE_OTHER;
+    }
+#endif
+    
+    // The type is not known or it is a symbolic link: check the file itself.
+    if (fstatat (dir_fd, ep->d_name, &st, 0) != 0)
+    {
+        return FS_TYPE_OTHER;
+    }
+    if (S_ISDIR (st.st_mode))
+    {
+        return FS_TYPE_DIR;
+    }
+    return S_ISREG (st.st_mode) ? FS_TYPE_FILE : FS_TYPE_OTHER;
+}
+
+static int
+compare_entries (const void* a, const void* b)
+{
+    return strcmp ((*(TDirEntry* const*)a)->name, (*(TDirEntry* const*)b)->name);
+}
+
+/*
+ * Read the directory 'path' (relative to the directory 'parent' or to the
+ * current directory if 'parent' is NULL). "." and ".." are skipped.
+ * Returns 1 on success, 0 if the directory cannot be read.
+ * dir_list_close() should be called in any case.
+ */
+int
+dir_list_open (TDirList* dir, const TDirList* parent, const char* path)
+{
+    DIR* pDir = NULL;
+    struct dirent* ep;
+    int fd;
+    int i;
+    
+    dir->fd = -1;
+    dir->entries = NULL;
+    dir->nEntries = 0;
+    dir->sorted = NULL;
+    
+    dir->fd = openat ((parent != NULL) ? parent->fd : AT_FDCWD, path, 
+                      O_RDONLY | O_DIRECTORY);
+    if (dir->fd < 0)
+    {
+        return FALSE;
+    }
+    
+    // closedir() closes the descriptor passed to fdopendir(), the directory
+    // should stay open.
+    fd = dup (dir->fd);
+    if (fd >= 0)
+    {
+        pDir = fdopendir (fd);
+        if (pDir == NULL)
+        {
+            close (fd);
+        }
+    }
+    if (pDir == NULL)
+    {
+        return FALSE;
+    }
+    
+    for (ep = readdir (pDir); ep != NULL; ep = readdir (pDir))
+    {
+        TDirEntry* e;
+        
+        if (!strcmp (ep->d_name, ".") || !strcmp (ep->d_name, ".."))
+        {
+            continue;
+        }
+        
+        dir->entries = (TDirEntry*)alloc_mem (dir->entries, dir->nEntries + 1, 
+                                              sizeof (TDirEntry));
+        e = &dir->entries[dir->nEntries++];
+        e->name = strdup (ep->d_name);
+        e->type = entry_type (dir->fd, ep);
+    }
+    closedir (pDir);
+    
+    dir->sorted = (TDirEntry**)alloc_mem (dir->sorted, dir->nEntries + 1, 
+                                          sizeof (TDirEntry*));
+    for (i = 0; i < dir->nEntries; ++i)
+    {
+        dir->sorted[i] = &dir->entries[i];
+    }
+    qsort (dir->sorted, dir->nEntries, sizeof (TDirEntry*), compare_entries);
+    
+    return TRUE;
+}
+
+/*
+ * Find the entry with the given name, NULL if there is none. 
+ */
+const TDirEntry*
+dir_list_find (const TDirList* dir, const char* name)
+{
+    TDirEntry key;
+    TDirEntry* pkey = &key;
+    TDirEntry** res;
+    
+    if (dir->nEntries == 0)
+    {
+        return NULL;
+    }
+    
+    key.name = (char*)name;
+    res = (TDirEntry**)bsearch (&pkey, dir->sorted, dir->nEntries, 
+                                sizeof (TDirEntry*), compare_entries);
+    return (res != NULL) ? *res : NULL;
+}
+
+/*
+ * stat() for the file 'path' relative to the directory.
+ * Returns 1 on success, 0 otherwise.
+ */
+int
+dir_list_stat (const TDirList* dir, const char* path, struct stat* st)
+{
+    return (fstatat (dir->fd, path, st, 0) == 0) ? TRUE : FALSE;
+}
+
+/*
+ * Create the subdirectory 'name' of the directory. The listing is not 
+ * changed. Returns 1 if the subdirectory has been created or already 
+ * exists, 0 otherwise.
+ */
+int
+dir_list_mkdir (const TDirList* dir, const char* name)
+{
+    struct stat st;
+    
+    if (mkdirat (dir->fd, name, S_IRWXU | S_IRWXG | S_IRWXO) == 0)
+    {
+        return TRUE;
+    }
+    // it may have been created after the directory was read
+    return ((errno == EEXIST) && (fstatat (dir->fd, name, &st, 0) == 0) && 
+            S_ISDIR (st.st_mode)) ? TRUE : FALSE;
+}
+
+void
+dir_list_close (TDirList* dir)
+{
+    int i;
+    
+    if (dir->fd >= 0)
+    {
+        close (dir->fd);
+    }
+    for (i = 0; i < dir->nEntries; ++i)
+    {
+        free (dir->entries[i].name);
+    }
+    free (dir->entries);
+    free (dir->sorted);
+    
+    dir->fd = -1;
+    dir->entries = NULL;
+    dir->nEntries = 0;
+    dir->sorted = NULL;
+}
@@ -1,8 +1,14 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "../include/libfile.h"
@@ -116,26 +122,16 @@ get_app_name ()
 unsigned
 is_directory_exists (char *dir_name)
 {
-    int err;
+    struct stat st;
     unsigned res = FALSE;
-    char* dir = NULL;
-
 
-    dir = alloc_mem_for_string (dir,1024);
-    dir = getcwd(dir,1024);
-
-    err = chdir (dir_name);
-
-    if (err)
+    // stat() rather than chdir() here: the generator may call this 
+    // from several threads at once.
+    if ((stat (dir_name, &st) == 0) && S_ISDIR (st.st_mode))
     {
-        res = FALSE;
-    } else {
-        err = chdir(dir);
         res = TRUE;
     }
 
-    free (dir);
-
     return res;
 }
 
@@ -145,19 +141,9 @@ is_directory_exists (char *dir_name)
 unsigned
 is_file_exists (const char* file_name)
 {
-    FILE* pfile;
-
-    pfile = fopen (file_name, "r");
-
-    if (!pfile)
-    {
-        return FALSE;
-    }
-    else
-    {
-        fclose (pfile);
-        return TRUE;
-    }
+    // The same as checking if the file can be opened for reading, 
+    // without actually opening it.
+    return (access (file_name, R_OK) == 0) ? TRUE : FALSE;
 }
 
 /* 
@@ -283,6 +269,443 @@ read_file_to_string (FILE* pFile)
     return (buffer);
 }
 
+// Copy the text to src->data, each line being terminated with '\0'.
+static void
+src_load (TSrcFile* src, const char* text, size_t size)
+{
+    char* out;
+    size_t nlines = 0;
+    size_t i;
+    
+    for (i = 0; i < size; ++i)
+    {
+        if (text[i] == '\n')
+        {
+            ++nlines;
+        }
+    }
+    
+    src->data = alloc_mem_for_string (src->data, size + nlines + 2);
+    out = src->data;
+    for (i = 0; i < size; ++i)
+    {
+        *out++ = text[i];
+        if (text[i] == '\n')
+        {
+            *out++ = '\0';
+        }
+    }
+    if ((size > 0) && (text[size - 1] != '\n'))
+    {   // the last line has no '\n' at the end
+        *out++ = '\0';
+    }
+    
+    src->end = out;
+    src->size = size;
+    src_rewind (src);
+}
+
+/*
+ * Read the file into memory for line-by-line processing (see TSrcFile). 
+ * The file is mapped and copied to src->data in a single pass, each line 
+ * being terminated with '\0'.
+ * Returns 0 if the file cannot be read, 1 otherwise.
+ */
+int
+src_open (TSrcFile* src, const char* filename)
+{
+    struct stat st;
+    char* map = NULL;
+    char* buf = NULL;
+    size_t size;
+    size_t i;
+    int fd;
+    
+    src->data = src->pos = src->end = NULL;
+    src->size = 0;
+    src->eof = 1;
+    
+    fd = open (filename, O_RDONLY);
+    if (fd == -1)
+    {
+        return 0;
+    }
+    
+    if ((fstat (fd, &st) != 0) || !S_ISREG (st.st_mode))
+    {
+        close (fd);
+        return 0;
+    }
+    size = (size_t) st.st_size;
+    
+    if (size > 0)
+    {
+        map = (char*) mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {   // fall back to reading the file
+            ssize_t nread = 0;
+            
+            map = NULL;
+            buf = alloc_mem_for_string (buf, size + 1);
+            for (i = 0; i < size; i += (size_t) nread)
+            {
+                nread = read (fd, buf + i, size - i);
+                if (nread <= 0)
+                {
+                    break;
+                }
+            }
+            size = i;
+        }
+    }
+    close (fd);
+    
+    src_load (src, (map != NULL) ? map : buf, size);
+    
+    if (map != NULL)
+    {
+        munmap (map, size);
+    }
+    free (buf);
+    return 1;
+}
+
+/*
+ * Same as src_open() for the text in memory ('size' bytes).
+ */
+void
+src_open_mem (TSrcFile* src, const char* text, size_t size)
+{
+    src->data = src->pos = src->end = NULL;
+    src_load (src, text, size);
+}
+
+/*
+ * Return the next line of the file or NULL if there are no lines left.
+ * The line belongs to src and remains valid until src_close() is called.
+ */
+char*
+src_next_line (TSrcFile* src)
+{
+    char* line = src->pos;
+    
+    if (line >= src->end)
+    {
+        src->eof = 1;
+        return NULL;
+    }
+    
+    src->pos = line + strlen (line) + 1;
+    return line;
+}
+
+/*
+ * Start reading the file from the first line again.
+ */
+void
+src_rewind (TSrcFile* src)
+{
+    src->pos = src->data;
+    src->eof = (src->data == NULL);
+}
+
+void
+src_close (TSrcFile* src)
+{
+    free (src->data);
+    src->data = src->pos = src->end = NULL;
+    src->size = 0;
+    src->eof = 1;
+}
+
+/*
+ * Prepare the sink for writing to fl. The data will be written 
+ * in chunks of at least flush_size bytes.
+ */
+void
+sink_init (TOutSink* sink, FILE* fl, size_t flush_size)
+{
+    strbuf_init (&sink->buf);
+    sink->fl = fl;
+    sink->flush_size = flush_size;
+    sink->error = 0;
+    sink->written = 0;
+    sink->bMarks = 0;
+    sink->marks = NULL;
+    sink->nMarks = 0;
+    sink->maxMarks = 0;
+}
+
+/*
+ * Write the collected data to the file if there are enough of them 
+ * (or if force is nonzero).
+ */
+void
+sink_flush (TOutSink* sink, int force)
+{
+    if ((sink->fl == NULL) || (sink->buf.len == 0))
+    {
+        return;
+    }
+    
+    if (!force && (sink->buf.len < sink->flush_size))
+    {
+        return;
+    }
+    
+    if (fwrite (sink->buf.str, 1, sink->buf.len, sink->fl) != sink->buf.len)
+    {
+        sink->error = 1;
+    }
+    sink->written += (long long)sink->buf.len;
+    sink->buf.len = 0;
+    sink->buf.str[0] = '\0';
+    
+    if (force && (fflush (sink->fl) != 0))
+    {
+        sink->error = 1;
+    }
+}
+
+/*
+ * Free the buffer. The file is not closed.
+ */
+void
+sink_free (TOutSink* sink)
+{
+    strbuf_free (&sink->buf);
+    free (sink->marks);
+    sink->marks = NULL;
+    sink->nMarks = 0;
+    sink->maxMarks = 0;
+    sink->fl = NULL;
+}
+
+/*
+ * Record that 'count' more items (e.g. test purposes) of the output end
+ * at the current position: marks[i] is the position where item i ends.
+ * Does nothing unless sink->bMarks is nonzero.
+ */
+void
+sink_mark (TOutSink* sink, int count)
+{
+    long long pos = sink->written + (long long)sink->buf.len;
+    
+    if (!sink->bMarks)
+    {
+        return;
+    }
+    
+    for (; count > 0; --count)
+    {
+        if (sink->nMarks == sink->maxMarks)
+        {
+            sink->maxMarks = (sink->maxMarks > 0) ? 2 * sink->maxMarks : 64;
+            sink->marks = (long long*)alloc_mem(sink->marks, sink->maxMarks, 
+                                                sizeof(long long));
+        }
+        sink->marks[sink->nMarks++] = pos;
+    }
+}
+
+/*
+ * Return a copy of the data written to the sink from position 'from' up to
+ * (but not including) position 'to', NULL if it cannot be read. The sink 
+ * should be flushed before this.
+ */
+char*
+sink_read (TOutSink* sink, long long from, long long to)
+{
+    char* res = NULL;
+    size_t len = (size_t)(to - from);
+    
+    if (sink->fl == NULL)
+    {
+        if (to > (long long)sink->buf.len)
+        {
+            return NULL;
+        }
+        res = alloc_mem_for_string (res, len);
+        memcpy (res, sink->buf.str + from, len);
+        res[len] = '\0';
+        return res;
+    }
+    
+    if (fseeko (sink->fl, (off_t)from, SEEK_SET) != 0)
+    {
+        return NULL;
+    }
+    res = alloc_mem_for_string (res, len);
+    if (fread (res, 1, len, sink->fl) != len)
+    {
+        free (res);
+        return NULL;
+    }
+    res[len] = '\0';
+    return res;
+}
+
+/*
+ * Start writing the file 'path': the data are written to a temporary file
+ * until out_file_commit() or out_file_discard() is called. Returns the 
+ * temporary file, NULL if it cannot be created.
+ */
+FILE*
+out_file_open (TOutFile* of, const char* path)
+{
+    char suffix[48];
+    int fd;
+    
+    of->fl = NULL;
+    of->bChanged = 0;
+    of->path = strdup (path);
+    
+    // The name is unique for the process, the files written by different
+    // threads have different paths.
+    sprintf (suffix, ".%ld.tmp", (long)getpid ());
+    of->tmp_path = str_sum (path, suffix);
+    
+    fd = open (of->tmp_path, O_RDWR | O_CREAT | O_TRUNC, 
+               S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    if (fd >= 0)
+    {
+        of->fl = fdopen (fd, "w+");
+        if (of->fl == NULL)
+        {
+            close (fd);
+            unlink (of->tmp_path);
+        }
+    }
+    return of->fl;
+}
+
+// Nonzero if the contents of the two files are the same.
+static int
+same_contents (FILE* f1, FILE* f2)
+{
+    char buf1[8192];
+    char buf2[8192];
+    size_t n1;
+    size_t n2;
+    
+    do
+    {
+        n1 = fread (buf1, 1, sizeof (buf1), f1);
+        n2 = fread (buf2, 1, sizeof (buf2), f2);
+        if ((n1 != n2) || memcmp (buf1, buf2, n1))
+        {
+            return FALSE;
+        }
+    }
+    while (n1 == sizeof (buf1));
+    
+    return !ferror (f1) && !ferror (f2);
+}
+
+// Nonzero if the file 'path' has the same contents as the file 'fl' 
+// (opened for writing).
+static int
+is_file_same (const char* path, FILE* fl)
+{
+    struct stat st_old;
+    struct stat st_new;
+    FILE* f_old;
+    FILE* f_new;
+    int bSame = FALSE;
+    
+    if ((stat (path, &st_old) != 0) || (fstat (fileno (fl), &st_new) != 0) ||
+        (st_old.st_size != st_new.st_size))
+    {
+        return FALSE;
+    }
+    
+    f_old = fopen (path, "r");
+    if (f_old == NULL)
+    {
+        return FALSE;
+    }
+    f_new = fdopen (dup (fileno (fl)), "r");
+    if (f_new != NULL)
+    {
+        if (fseek (f_new, 0, SEEK_SET) == 0)
+        {
+            bSame = same_contents (f_old, f_new);
+        }
+        fclose (f_new);
+    }
+    fclose (f_old);
+    
+    return bSame;
+}
+
+/*
+ * Finish writing the file: it is replaced with the data written since 
+ * out_file_open() if they differ from its current contents, otherwise it 
+ * is not touched. Returns 1 on success, 0 if the data could not be written 
+ * (the file is not changed then).
+ */
+int
+out_file_commit (TOutFile* of)
+{
+    int bOK;
+    
+    if (of->fl == NULL)
+    {
+        out_file_discard (of);
+        return FALSE;
+    }
+    
+    bOK = (fflush (of->fl) == 0) && !ferror (of->fl);
+    if (bOK && is_file_same (of->path, of->fl))
+    {
+        out_file_discard (of);
+        return TRUE;
+    }
+    
+    if (fclose (of->fl) != 0)
+    {
+        bOK = FALSE;
+    }
+    of->fl = NULL;
+    
+    if (bOK && (rename (of->tmp_path, of->path) == 0))
+    {
+        of->bChanged = 1;
+    }
+    else
+    {
+        bOK = FALSE;
+        unlink (of->tmp_path);
+    }
+    
+    free (of->path);
+    free (of->tmp_path);
+    of->path = NULL;
+    of->tmp_path = NULL;
+    return bOK;
+}
+
+/*
+ * Stop writing the file, it is left as it was.
+ */
+void
+out_file_discard (TOutFile* of)
+{
+    if (of->fl != NULL)
+    {
+        fclose (of->fl);
+        of->fl = NULL;
+    }
+    if (of->tmp_path != NULL)
+    {
+        unlink (of->tmp_path);
+    }
+    free (of->path);
+    free (of->tmp_path);
+    of->path = NULL;
+    of->tmp_path = NULL;
+}
+
 /*
  * Converts the given path to be as short as possible
  * (e.g. was '/dir1/../dir2/dir3', now '/dir2/dir3'
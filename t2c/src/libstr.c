@@ -80,8 +80,7 @@ replace_substr_in_string (char* destination, const char* str1, const char* str2)
 char*
 replace_all_substr_in_string(char* destination, const char* str1, const char* str2)
 {
-    char* pch = NULL;
-    size_t headLen, tailLen, newDestLen;
+    TStrBuf sb;
     
     if ((destination == NULL) || (str1 == NULL)) { return (NULL);};
 
@@ -91,92 +90,50 @@ replace_all_substr_in_string(char* destination, const char* str1, const char* st
         return (destination);
     }
 
-    pch = strstr(destination, str1);
-
-    while (pch != NULL)
-    {
-        char* tailSave = NULL;
-    
-        headLen = pch - destination;
-        tailLen =  strlen(pch) - strlen(str1);
-        newDestLen = strlen(destination) - strlen(str1) + strlen(str2);
-
-        if (tailLen != 0)
-        {
-            tailSave = (char*) calloc (tailLen, sizeof (char));
-        }
-
-        memcpy(tailSave, pch + strlen(str1), tailLen);
-        destination = (char*) realloc(destination, (newDestLen + 1) * sizeof (char));
-        memcpy (destination + headLen, str2, strlen (str2));
-        memcpy (destination + headLen + strlen (str2), tailSave, tailLen);
-        destination[newDestLen] = '\0';
-
-        pch = strstr(destination + headLen + strlen (str2), str1);
-        if (tailSave != NULL)
-        {
-            free (tailSave);
-        }
-    }
-
-    return destination;
+    strbuf_attach (&sb, destination);
+    strbuf_replace_all (&sb, str1, str2);
+    return strbuf_detach (&sb);
 }
                 
 /*
- * Removes white space from both ends of a string
- * Returns a string without spaces at the both ends
+ * Removes the characters from 'chars' from both ends of a string in place.
  */
-char*
-trim (char* str)
+static char*
+trim_chars (char* str, const char* chars)
 {
-    size_t new_start_pos;
-    size_t new_end_pos;
-    size_t i;
-
-    new_start_pos = 0;
-    new_end_pos = strlen (str) - 1;
-
+    size_t start = 0;
+    size_t end;
+    
     if (!str)
     {
         return NULL;
     }
-
-    if (!strlen (str))
-    {
-        return str;
-    }
-
-    for (i = 0; i < strlen (str); i++)
-    {
-        new_start_pos = i;
-        if ((str[i] != ' ') && (str[i] != '\t'))
-        {
-            break;
-        }
-    }
     
-    /* if a string containing spaces only is passed we should return "" */
-    if ((new_start_pos == new_end_pos) 
-        && ((str[new_start_pos] == ' ') || (str[new_start_pos] == '\t')))
+    end = strlen (str);
+    while ((start < end) && strchr (chars, str[start]))
     {
-        str[0] = '\0';
-        return str;
+        ++start;
     }
-
-    for (i = strlen (str) - 1; i > 0; i--)
+    while ((end > start) && strchr (chars, str[end - 1]))
     {
-        new_end_pos = i;
-        if ((str[i] != ' ') && (str[i] != '\t'))
-        {
-            break;
-        }
+        --end;
     }
-
-    memmove (str, str + new_start_pos, new_end_pos - new_start_pos + 1);
-    *(str + new_end_pos - new_start_pos + 1) = '\0';
+    
+    memmove (str, str + start, end - start);
+    str[end - start] = '\0';
     
     return str;
 }
+
+/*
+ * Removes white space from both ends of a string
+ * Returns a string without spaces at the both ends
+ */
+char*
+trim (char* str)
+{
+    return trim_chars (str, " \t");
+}
        
 /*
  * Removes white spaces and newlines from both ends of a string
@@ -185,55 +142,7 @@ trim (char* str)
 char*
 trim_with_nl (char* str)
 {
-    size_t new_start_pos;
-    size_t new_end_pos;
-    size_t i;
-
-    new_start_pos = 0;
-    new_end_pos = strlen (str) - 1;
-
-    if (!str)
-    {
-        return NULL;
-    }
-
-    if (!strlen (str))
-    {
-        return str;
-    }
-
-    for (i = 0; i < strlen (str); i++)
-    {
-        new_start_pos = i;
-        if (str[i] != ' ' && str[i] != '\n' && str[i] != '\t')
-        {
-            break;
-        }
-    }
-    
-    /* if a string containing spaces and '\n's only is passed we should return "" */
-    if ((new_start_pos == new_end_pos) 
-        && ((str[new_start_pos] == ' ' ) 
-            || (str[new_start_pos] == '\n')
-            || (str[new_start_pos] == '\t')))
-    {
-        str[0] = '\0';
-        return str;
-    }
-
-    for (i = strlen (str) - 1; i > 0; i--)
-    {
-        new_end_pos = i;
-        if (str[i] != ' ' && str[i] != '\n' && str[i] != '\t')
-        {
-            break;
-        }
-    }
-
-    memmove (str, str + new_start_pos, new_end_pos - new_start_pos + 1);
-    *(str + new_end_pos - new_start_pos + 1) = '\0';
-    
-    return str;
+    return trim_chars (str, " \n\t");
 }
 
 /*
@@ -243,9 +152,11 @@ trim_with_nl (char* str)
 char* 
 str_append (char* str1, const char* str2)
 {
-    str1 = (char*) realloc (str1,
-                           (strlen(str1) + strlen(str2) + 1) * sizeof(char));
-    strcat(str1, str2);
+    size_t len1 = strlen (str1);
+    size_t len2 = strlen (str2);
+    
+    str1 = (char*) alloc_mem (str1, len1 + len2 + 1, sizeof (char));
+    memcpy (str1 + len1, str2, len2 + 1);
     return str1;
 }
 
@@ -355,3 +266,183 @@ convert_to_comment (const char* str)
 
     return (result);
 }
+
+/************************************************************************/
+/* String buffer                                                        */
+/************************************************************************/
+
+#define STRBUF_MIN_CAP 64
+
+void
+strbuf_init (TStrBuf* sb)
+{
+    sb->str = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+}
+
+/*
+ * Initializes the buffer with a copy of str.
+ */
+void
+strbuf_init_str (TStrBuf* sb, const char* str)
+{
+    strbuf_init (sb);
+    strbuf_append (sb, str);
+}
+
+/*
+ * Initializes the buffer with str. The buffer takes ownership of str, 
+ * which must have been allocated with malloc().
+ */
+void
+strbuf_attach (TStrBuf* sb, char* str)
+{
+    strbuf_init (sb);
+    if (str != NULL)
+    {
+        sb->str = str;
+        sb->len = strlen (str);
+        sb->cap = sb->len + 1;
+    }
+}
+
+/*
+ * Makes sure the buffer can hold a string len characters long 
+ * without reallocation.
+ */
+void
+strbuf_reserve (TStrBuf* sb, size_t len)
+{
+    size_t cap;
+    
+    if (len + 1 <= sb->cap)
+    {
+        return;
+    }
+    
+    cap = (sb->cap < STRBUF_MIN_CAP) ? STRBUF_MIN_CAP : sb->cap;
+    while (cap < len + 1)
+    {
+        cap *= 2;
+    }
+    
+    sb->str = (char*) alloc_mem (sb->str, cap, sizeof (char));
+    if (sb->cap == 0)
+    {
+        sb->str[0] = '\0';
+    }
+    sb->cap = cap;
+}
+
+void
+strbuf_append_n (TStrBuf* sb, const char* str, size_t len)
+{
+    strbuf_reserve (sb, sb->len + len);
+    memcpy (sb->str + sb->len, str, len);
+    sb->len += len;
+    sb->str[sb->len] = '\0';
+}
+
+void
+strbuf_append (TStrBuf* sb, const char* str)
+{
+    if (str != NULL)
+    {
+        strbuf_append_n (sb, str, strlen (str));
+    }
+}
+
+void
+strbuf_append_char (TStrBuf* sb, char c)
+{
+    strbuf_append_n (sb, &c, 1);
+}
+
+/*
+ * Replaces all occurences of 'what' with 'with' in a single pass.
+ */
+void
+strbuf_replace_all (TStrBuf* sb, const char* what, const char* with)
+{
+    TStrBuf res;
+    const char* pos;
+    const char* next;
+    size_t what_len;
+    size_t with_len;
+    
+    if ((sb->str == NULL) || (what == NULL) || (what[0] == '\0') || (with == NULL))
+    {
+        return;
+    }
+    
+    next = strstr (sb->str, what);
+    if (next == NULL)
+    {
+        return;
+    }
+    
+    what_len = strlen (what);
+    with_len = strlen (with);
+    
+    strbuf_init (&res);
+    strbuf_reserve (&res, sb->len);
+    
+    pos = sb->str;
+    while (next != NULL)
+    {
+        strbuf_append_n (&res, pos, next - pos);
+        strbuf_append_n (&res, with, with_len);
+        pos = next + what_len;
+        next = strstr (pos, what);
+    }
+    strbuf_append_n (&res, pos, sb->str + sb->len - pos);
+    
+    strbuf_free (sb);
+    *sb = res;
+}
+
+/*
+ * Removes the characters from 'chars' from both ends of the string.
+ */
+void
+strbuf_trim (TStrBuf* sb, const char* chars)
+{
+    if (sb->str != NULL)
+    {
+        trim_chars (sb->str, chars);
+        sb->len = strlen (sb->str);
+    }
+}
+
+/*
+ * Returns the string in the buffer ("" if the buffer is empty).
+ */
+const char*
+strbuf_str (const TStrBuf* sb)
+{
+    return (sb->str != NULL) ? sb->str : "";
+}
+
+/*
+ * Returns the string (the caller should free it) and makes the buffer empty.
+ */
+char*
+strbuf_detach (TStrBuf* sb)
+{
+    char* str = sb->str;
+    
+    if (str == NULL)
+    {
+        str = (char*) alloc_mem (NULL, 1, sizeof (char));
+    }
+    strbuf_init (sb);
+    return str;
+}
+
+void
+strbuf_free (TStrBuf* sb)
+{
+    free (sb->str);
+    strbuf_init (sb);
+}
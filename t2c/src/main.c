@@ -32,19 +32,50 @@ argv[2] - path to the directory of a test suite to generate (<test_dir>),
 argv[3] - [optional] path to the configuration file that contains additional 
     options of the generator (see the documentation for a more detailed description).
 
+The positional parameters may be preceded by the following options:
+-j N - process the .t2c files using N worker threads (N == 0 means 
+    "one thread per online CPU"). The generated files are the same 
+    for any N. Default: 1.
+-f - regenerate all the tests. By default, a test is not regenerated if 
+    neither its .t2c-file nor the templates and settings used to generate 
+    it have changed since the previous run (see <test_dir>/tests/.t2c_cache).
+-t - print the statistics of the generation when it is done: the number of 
+    the tests and test purposes generated, the time taken by each phase of 
+    the generation, the throughput and the peak memory usage.
+--stats <file> - write the statistics for each .t2c-file (the number of 
+    blocks, test purposes and parameter combinations, the size of the input 
+    and output, the time taken by each phase) and the totals for the whole 
+    run to <file>: in CSV format if its name ends with ".csv", in JSON 
+    format otherwise.
+--watch - after the tests have been generated, keep running and regenerate
+    the tests as soon as their .t2c-files or the templates are changed 
+    (see watch_suite()). Stop the generator with Ctrl-C.
+
 Example: 
     t2c my_suites my_suites/myfirst-t2c my_suites/conf/myfirst.cfg
 ******************************************************************************/
  
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
 #include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "../include/t2c_util.h"
 #include "../include/param.h"
+#include "../include/gen_cache.h"
+#include "../include/gen_stats.h"
+#include "../include/template.h"
+#include "../include/t2cgen.h"
+#include "../include/libdir.h"
+#include "../include/watch.h"
 
 /*******************************************************************************/
 #define NCMD_PARAMS 3       // Number of mandatory command line parameters to be specified
@@ -56,39 +87,6 @@ Example:
 #define INPUT_EXT          ".t2c"       // input file extention
 #define MAKEFILE_TPL_EXT   ".tmk"       // extension of template makefiles
 
-/************************************************************************/
-// Known top-level tags.
-static char* top_tag[] = {
-    "GLOBAL",
-    "STARTUP",
-    "CLEANUP",    
-    "BLOCK",
-    NULL
-};
-
-// Top-level tag IDs:
-#define ITOP_GLOBAL     0
-#define ITOP_STARTUP    1
-#define ITOP_CLEANUP    2
-#define ITOP_BLOCK      3
-    
-// Know sub-tags in the <BLOCK> tag:
-static char* bl_tag[] = {
-    "TARGETS",
-    "DEFINE",
-    "FINALLY",    
-    "CODE",
-    "PURPOSE",
-    NULL
-};
-
-// Block-level tag IDs:
-#define IBL_TARGETS     0
-#define IBL_DEFINE      1
-#define IBL_FINALLY     2
-#define IBL_CODE        3
-#define IBL_PURPOSE     4
-
 /************************************************************************/
 #define CFG_COMPILER_POS    0
 #define CFG_COMP_FLAGS_POS  1
@@ -98,6 +96,15 @@ static char* bl_tag[] = {
 #define CFG_LANGUAGE_POS    5
 #define CFG_SINGLE_POS      6
 #define CFG_MK_TPL_POS      7
+#define CFG_PARAM_TABLES_POS 8
+#define CFG_FLAT_MK_POS     9
+#define CFG_SPLIT_POS       10
+#define CFG_PCH_POS         11
+#define CFG_PCH_HEADERS_POS 12
+#define CFG_YEAR_POS        13
+#define CFG_CONCURRENT_POS  14
+#define CFG_BATCH_POS       15
+#define CFG_KILL_WAIT_POS   16
 
 // Number of parameters that can be specified in a .cfg-file.
 #define CFG_PARAMS (sizeof(cfg_parm_names)/sizeof(cfg_parm_names[0]))        
@@ -109,21 +116,74 @@ static char* cfg_parm_names[] = {
     "LINKER_FLAGS",
     "TET_SCEN_RECORD",
     
-    "WAIT_TIME",        // Maximum time for a test to run (in seconds). Default: "30"
+    "WAIT_TIME",        // Maximum time for a test to run (in seconds, or in milliseconds
+                        // with "ms" suffix, e.g. "200ms"). Default: "30"
     
     "LANGUAGE",         // "CPP" for C++-code, any other value for plain C. Default: "C"
     
     "SINGLE_PROCESS",   // If "YES" or "yes", all tests are executed in the same process, 
                         // otherwise - in separate process each. Ignored in standalone (debug) mode.
+                        // The crashes and timeouts of the test purposes are contained
+                        // in the process (see t2c_fork_contained()).
                         // Default: "no".
     
-    "MAKEFILE_TEMPLATE" // Template makefile for the tests in the subsuite. Default: ""
+    "MAKEFILE_TEMPLATE", // Template makefile for the tests in the subsuite. Default: ""
+    
+    "PARAM_TABLES",     // If "YES" or "yes", the test purposes generated from a PURPOSE
+                        // section share the code, the parameter values are stored in 
+                        // a table (if all of them are literals). Default: "no".
+                        // The parameters are no longer constant expressions then, so
+                        // they cannot be used as array sizes, case labels, in string
+                        // literal concatenation or in #if, and sizeof gives the size 
+                        // of the table field rather than of the literal (e.g. of a 
+                        // pointer for a string). Use <BLOCK paramTables="no"> for the
+                        // blocks where this matters.
+    
+    "FLAT_MAKEFILE",    // If "YES" or "yes", <test_dir>/tests/Makefile builds the tests
+                        // itself rather than running make in the directory of each test
+                        // (except the tests with their own makefile templates). Default: "no".
+    
+    "SPLIT_PURPOSES",   // If N > 0, the test purposes of a test that has more than N of them
+                        // are split between several C-files, see split_test(). Default: "0".
+    
+    "PRECOMPILED_HEADER", // If "YES" or "yes", the tests are compiled with a precompiled
+                        // header, see gen_pch_header(). Default: "no".
+    
+    "PCH_HEADERS",      // The headers to be added to the precompiled header, e.g. 
+                        // "<gtk/gtk.h> mylib.h" (<...> may be omitted). Default: "".
+    
+    "YEAR",             // The year substituted for <%year%> in the tests, see 
+                        // init_gen_year(). Default: "" (the current year).
+    
+    "CONCURRENT_PURPOSES", // If N > 0, up to N test purposes of a test are executed
+                        // at the same time, "auto" - as many as there are processors.
+                        // Can be changed for a test with "# concurrent_purposes N" 
+                        // in its .t2c-file. Ignored if SINGLE_PROCESS is "yes". 
+                        // Default: "0".
+    
+    "BATCH_PURPOSES",   // If "YES" or "yes", the test purposes of each test are executed
+                        // one after another in a single child process, a new one is
+                        // created only if a test purpose crashes. Ignored if SINGLE_PROCESS
+                        // is "yes" or CONCURRENT_PURPOSES is used. Default: "no".
+    
+    "KILL_WAIT"         // How long a child process that timed out is given to exit after
+                        // SIGTERM (and then after SIGKILL), in seconds or in milliseconds
+                        // with "ms" suffix. Default: "10".
 };
 
 /* Values of the parameters from .cfg-file. Use set_defaults() to reset these to their
  * default values.
  */
 static char* cfg_parm_values[CFG_PARAMS] = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
     NULL,
     NULL,
     NULL,
@@ -138,96 +198,51 @@ static char* cfg_parm_values[CFG_PARAMS] = {
 // opposite case.
 int bAddTetScenRecord = 1;
 
-// 1 if C++ code is to be generated, 0 otherwise (i.e. plain C)
-// See "LANGUAGE" option in the config file.
-int bGenCpp = 0;
-
 // 1 if all the tests should be executed in a single process, 0 otherwise.
 // See "SINGLE_PROCESS" option in the config file.
 int bSingleProcess = 0;
 
+// -DT2C_CONCURRENT_PURPOSES=N if the test purposes should be executed 
+// concurrently, "" otherwise. See "CONCURRENT_PURPOSES" option in the config file.
+static char concurrent_flag[64] = "";
+
+// -DT2C_KILL_WAIT_MS=N if KILL_WAIT is not the default one.
+static char kill_wait_flag[64] = "";
+
+// 1 if the test purposes should be executed in a single child process, 0 otherwise.
+// See "BATCH_PURPOSES" option in the config file.
+int bBatch = 0;
+
+// 1 if a non-recursive makefile should be generated for the tests, 0 otherwise.
+// See "FLAT_MAKEFILE" option in the config file.
+int bFlatMakefile = 0;
+
+// 1 if the tests should be compiled with a precompiled header, 0 otherwise.
+// See "PRECOMPILED_HEADER" option in the config file.
+int bPrecompiledHeader = 0;
+
+// The year substituted for <%year%> in the tests, see init_gen_year().
+static char gen_year[16] = "2007";
+
+// The settings passed to the generator (see t2cgen.h): the language, 
+// PARAM_TABLES, SPLIT_PURPOSES, WAIT_TIME, the year and the test suite.
+TGenSettings gen_cfg;
+
 /************************************************************************/
 #define COMMON_TEST_TPL      "test.tpl"    /* common test case template*/
 #define COMMON_PURPOSE_TPL   "purpose.tpl" /* common test purpose template*/
+#define COMMON_PART_TPL      "part.tpl"    /* template of a part of a test */
 #define DEFAULT_MAKEFILE_TPL "default.tmk" /* default makefile template */
 #define COMMON_MAKEFILE_TPL  "common.tmk"  /* template of a common makefile */
+#define FLAT_MAKEFILE_TPL    "flat.tmk"    /* template of the rules for a test in
+                                              the non-recursive makefile */
+#define FLAT_MAKEFILE_RULES  "rules.mk"    /* the rules for a test (in its directory) */
 #define COMMON_TPL_DIR       "t2c/src/templates/"
+#define PCH_DIR              "t2c_pch"     /* <test_dir>/tests/t2c_pch/ contains the
+                                              precompiled headers */
+#define PCH_HEADER           "t2c_pch.h"   /* the header to be precompiled, one copy
+                                              for release and one for debug builds */
 
-#define COMMON_TAGS_NUM     (sizeof(common_tags)/sizeof(common_tags[0]))
-#define GROUP_NAME_POS      0
-#define OBJECT_NAME_POS     1
-#define TEST_PURPOSES_POS   2
-#define TET_HOOKS_POS       3
-#define YEAR_POS            4
-#define LIBRARY_POS         5
-#define LIBSECTION_POS      6
-#define GLOBALS_POS         7
-#define STARTUP_POS         8
-#define CLEANUP_POS         9
-#define FTEMPLATE_POS       10
-#define TP_FUNCS_POS        11
-#define PCF_FUNCS_POS       12
-#define WAIT_TIME_POS       13
-#define RCAT_NAMES_POS      14
-
-static char* common_tags[] = { 
-    "<%group_name%>",
-    "<%object_name%>",
-    "<%test_purposes%>",
-    "<%tet_hooks%>",
-    "<%year%>",
-    "<%library%>",
-    "<%libsection%>",
-    "<%globals%>",
-    "<%startup%>",
-    "<%cleanup%>",
-    "<%ftemplate%>",
-    "<%tp_funcs%>",
-    "<%pcf_funcs%>",
-    "<%wait_time%>",
-    "<%rcat_names%>"
-};
-    
-#define MAX_PARAMS_NUM  256
-#define MAX_TARGETS_NUM 256
-    
-#define TAGS_NUM 8
-#define COMMENT_TAG_POS  0
-#define DEFINE_TAG_POS   1
-#define CODE_TAG_POS     2
-#define PURPNUM_TAG_POS  3
-#define UNDEF_TAG_POS    4
-#define TARGETS_TAG_POS  5
-#define	LSB_MIN_VER_POS	 6
-#define	LSB_MAX_VER_POS  7
-    
-static char* tags[] = { 
-    "<%comment%>",
-    "<%define%>",
-    "<%code%>",
-    "<%purpose_number%>",
-    "<%undef%>",
-    "<%targets%>",
-    "<%lsb_min_ver%>",
-    "<%lsb_max_ver%>"
-};
-
-#define TAG_FINALLY_NAME "<%finally%>"
-#define TAG_SUITE_SUBDIR_NAME "<%suite_subdir%>"
-    
-// Placeholders for makefile parameters
-static char* mk_params[] = {
-    "<%test_name%>",
-    "<%test_dir_path%>",
-    "<%test_suite_root%>",
-    "<%test_tmp_basename%>"
-};
-// Positions of makefile parameter placeholders in mk_params[]
-#define MK_PARAM_NUM    (sizeof(mk_params)/sizeof(mk_params[0]))
-#define MK_NAME_POS         0
-#define MK_DIR_PATH_POS     1
-#define MK_SUITE_ROOT_POS   2
-#define MK_TMP_BASENAME_POS 3
 
 // Placeholders for parameters in common.mk
 static char* common_mk_params[] = {
@@ -237,7 +252,11 @@ static char* common_mk_params[] = {
     "<%add_lflags%>",
     "<%test_std_cflags%>",
     "<%test_file_ext%>",
-    "<%single_process_flag%>"
+    "<%single_process_flag%>",
+    "<%use_pch%>",
+    "<%concurrent_flag%>",
+    "<%batch_flag%>",
+    "<%kill_wait_flag%>"
 };
 // Positions of makefile parameter placeholders in common_mk_params[]
 #define CMK_PARAM_NUM    (sizeof(common_mk_params)/sizeof(common_mk_params[0]))
@@ -248,30 +267,14 @@ static char* common_mk_params[] = {
 #define CMK_TEST_STD_FLAGS_POS  4
 #define CMK_TEST_FILE_EXT_POS   5
 #define CMK_SP_FLAG_POS         6
+#define CMK_PCH_POS             7
+#define CMK_CONCURRENT_FLAG_POS 8
+#define CMK_BATCH_FLAG_POS      9
+#define CMK_KILL_WAIT_FLAG_POS  10
 
 // func_scen
 char* func_tests_scenario_file_name = "func_scen";
 
-// Number of params to be extracted from the header of a .t2c-file
-#define HEADER_PARAMS_NUM    (sizeof(hdr_param_name)/sizeof(hdr_param_name[0]))     
-#define PARAM_LIB_POS        0
-#define PARAM_SECTION_POS    1
-#define PARAM_RCAT_POS       2
-#define PARAM_T2C_BASENAME_POS   3
-
-char* hdr_param_value[] = { 
-    NULL, 
-    NULL,
-    NULL,
-    NULL
-};
-    
-char* hdr_param_name[] = { 
-    "library", 
-    "libsection",
-    "additional_req_catalogues",
-    "t2c_basename"
-};
 
 // The values of $T2C_ROOT and $T2C_SUITE_ROOT.
 char* t2c_root = NULL;
@@ -281,127 +284,197 @@ char* t2c_suite_root = NULL;
 // (e.g. "desktop-t2c/glib-t2c")
 char* test_dir = NULL;
 
+// The templates loaded from the files (see load_template()).
+TTplRegistry tpl_registry = {NULL, 0};
+
 // Default makefile template
-char* def_mk_tpl = NULL;
+const TTemplate* def_mk_tpl = NULL;
+
+// Used instead of the default makefile template if it cannot be read.
+TTemplate* empty_mk_tpl = NULL;
 
 // Makefile template for a subsuite
-char* subsuite_mk_tpl = NULL;
+const TTemplate* subsuite_mk_tpl = NULL;
 
-// Number of current line in a T2C file
-int ln_count = 0;
+// Template of the rules for a test in the non-recursive makefile, NULL if 
+// the makefile is not to be generated (see "FLAT_MAKEFILE" option).
+const TTemplate* flat_mk_tpl = NULL;
 
-/***********************************************************************/
+// Number of worker threads used to generate the tests (see "-j" option).
+int nJobs = 1;
 
-static void  
-run_generator(const char* suite_root, const char* input_dir, 
-              const char* output_dir, const char* scen_dir);
-static char*  
-gen_tests_group(const char* suite_root, const char* output_dir, 
-                const char* group_path, const char* group_nme, 
-                const char* scen_file);
-static char*  
-gen_test(const char* test_tpl, const char* purpose_tpl, 
-         const char* input_path, const char* group_nme, const char* test_nme);
+// If 0, the tests are regenerated even if they are up to date (see "-f" option).
+int bUseCache = 1;
 
-static void
-gen_tp_arrays(int number, char** pTetHooks, char** pTpFuncs);
+// If 1, the statistics of the generation are printed (see "-t" option).
+int bTiming = 0;
 
-static void   
-add_test_in_scen(const char* suite_root, const char* scen_file, 
-                 const char* output_dir, const char* ftest_nme);
+// The statistics of the generation, summed over all the tests.
+TGenStats gen_stats;
 
-static void 
-gen_makefile(const char* suite_root, const char* dir_path, 
-             const char* ftest_nme,  const char* makefile_tpl);
+// Path to the file where the statistics should be written (see "--stats" option).
+const char* stats_path = NULL;
 
-static void 
-gen_common_makefile(const char* suite_root_path, const char* output_dir_path);
+// If 1, the generator watches the sources of the tests and regenerates them
+// when they change (see "--watch" option).
+int bWatch = 0;
 
-static char* 
-fgets_and_skip_comments(char* str, int num, FILE* stream, int* str_counter);
+// The generation cache loaded from the previous run.
+TGenCache gen_cache = {NULL, 0, 0};
 
-static void 
-usage();
+// Hash of the configuration parameters and other settings that affect 
+// every generated test.
+THash cfg_hash = HASH_INIT;
 
-/* 
-Extract data from the T2C-file header (library, libsection etc.) and
-store in hdr_data. hdr_param_names contains parameter names.
-Returns 0 if the specified file cannot be opened, 1 otherwise. If some 
-parameter is not found in the file, an empty string is returned as its value.
-*/
-static int 
-parse_header(const char* input_path);
+// A group of tests (a subdirectory of <test_dir>/src) and the templates 
+// used to generate its tests.
+typedef struct
+{
+    char* group_path;
+    char* group_nme;
+    const TTemplate* test_tpl;      // these belong to tpl_registry
+    const TTemplate* purpose_tpl;
+    const TTemplate* part_tpl;      // NULL if the tests are not split
+    THash tpl_hash;         // hash of the texts of the templates above
+} TGenGroup;
+
+// A single .t2c-file to be processed.
+typedef struct
+{
+    const TGenGroup* group;
+    char* input_path;
+    char* ftest_nme;
+    
+    // The makefile template for this test only (<ftest_nme>.tmk in the 
+    // group directory), NULL if there is none.
+    const TTemplate* mk_tpl;
+    
+    // 1 if the test has been generated successfully, 0 otherwise.
+    int bOK;
+    
+    // 1 if the test was up to date and has not been regenerated.
+    int bCached;
+    
+    // The cache record for the test (valid if bOK is 1).
+    TCacheEntry rec;
+    
+    // The statistics of the generation of the test.
+    TGenStats stats;
+} TGenJob;
 
-/*
-Parse the specified file and save the extracted data in the strings (memory for those
-will be allocated if necessary). Returns 1 on success, 0 in case of failure.
-*/
-static int
-parse_file(const char* input_path, const char* purpose_tpl, int* purposes_number, const char* test_nme,
-           char** pstrGlobals, char** pstrStartup,
-           char** pstrCleanup, char** pstrPurposes,
-           char** pcf_funcs);
+// The list of the .t2c-files to be processed, in the order the tests 
+// should appear in the scenario file.
+typedef struct
+{
+    TGenJob*    jobs;
+    int         nJobs;
+    int         nNext;      // index of the next job to be taken by a worker
+    
+    const char* suite_root;
+    const char* output_dir;
+    const TDirList* out_list;   // the output directory, read before the
+                                // tests are generated
+    
+    pthread_mutex_t lock;
+} TGenJobList;
 
-/*
-Return the contents of the global block. Returns NULL in case of error, the contents of
-the block (as a string) otherwise.
-size - max line size.
-*/
-static char*
-parse_global(FILE* fl, int size);
+/***********************************************************************/
 
+static void  
+run_generator(const char* suite_root, const char* input_dir, 
+              const char* output_dir, const char* scen_dir);
+static TGenGroup*  
+add_tests_group(TGenJobList* jl, const TDirList* in_list, 
+                const char* group_path, const char* group_nme);
+static void
+report_stats(const TGenJobList* jl, double wall_time);
+static void
+watch_suite(const char* suite_root, const char* input_dir, 
+            const char* output_dir, const char* scen_dir);
 static char*
-parse_startup(FILE* fl, int size);
+default_tpl_path(const char* name);
+static const TTemplate*
+get_template(const char* path, int kind);
+static const TTemplate*
+load_template(const char* path, int kind);
 
-static char*
-parse_cleanup(FILE* fl, int size);
+/*
+ * Generate the test and the makefile for a single .t2c-file.
+ * Sets job->bOK to 1 on success, to 0 otherwise.
+ */
+static void
+gen_test_job(TGenJob* job, const char* suite_root, const char* output_dir,
+             const TDirList* out_list);
 
 /*
-Return code for all purposes in the block, or NULL in case of error.
-size - max line size.
-*/
-static char*
-parse_block(FILE* fl, int size, const char* purpose_tpl, int* purposes_number,
-            char** pcf_funcs, const char* pcf_name, const char *lsb_min_ver, const char *lsb_max_ver);
+ * Process all the jobs from the list using nworkers threads. 
+ * If nworkers is 1, the jobs are processed in the calling thread.
+ */
+static void
+run_jobs(TGenJobList* jl, int nworkers);
+
+static void*
+gen_worker(void* arg);
 
 /*
-Matches <TARGETS> section. On success, 1 is returned. If the section
-is not found or is invalid (no closing tag, for example), 0 is returned.
-*pstrTargets will be filled with target names, *pnTargets - with their
-quantity.
-*/
-static int 
-parse_targets(FILE* fl, int size, char** pstrTargets, int* pnTargets);
+ * Report that a .t2c-file is being parsed (see TGenSettings::on_parse).
+ */
+static void
+report_parse(const char* input_path);
 
 /*
-Matches <DEFINES> section. On success, 1 is returned. If the section
-is not found or is invalid (no closing tag, for example), 0 is returned.
-On success, the contents of the section (as a string) are returned in *pstrDefines,
-appropriate #undefs - in *pstrUndefs.
-*pstrDefineNames will be filled with target names, *pnDefines - with their
-quantity.
-*/
+ * Check if the test for the job is up to date according to the cache.
+ * Fills job->rec in any case.
+ */
 static int
-parse_defines(FILE* fl, int size, char** pstrDefines, char** pstrUndefs);
+is_test_up_to_date(TGenJob* job, const TTemplate* makefile_tpl, 
+                   const TDirList* out_list, const char* ftest_src);
 
-/* Reads the <CODE> section and returns its contents as a string. NULL is 
- * returned in case of error (if the section is invalid).
+/*
+ * Calculate cfg_hash. 
  */
-static char*
-parse_code(FILE* fl, int size);
+static void
+calc_cfg_hash(const char* suite_root, const char* output_dir);
 
-/* Reads the <FINALLY> section and returns its contents as a string. NULL is 
- * returned in case of error (if the section is invalid).
+/*
+ * Set gen_year.
  */
-static char*
-parse_finally(FILE* fl, int size);
+static void
+init_gen_year();
+
+static void   
+add_test_in_scen(const char* suite_root, FILE* sf, 
+                 const char* output_dir, const char* ftest_nme);
+
+static int
+is_scen_included(FILE* sf, const char* scen_path);
 
-/* Read a <PURPOSE> section and fill in the gaps of the template with
- * purpose number and parameter values. Returns the code of the purpose as
- * a string (on success), NULL in case of error.
+static void 
+gen_makefile(TGenContext* ctx, const char* suite_root, const char* dir_path, 
+             const char* ftest_nme,  const TTemplate* makefile_tpl, 
+             const char* makefile_nme, int nParts);
+
+/*
+ * Check if the rules for the test are in the non-recursive makefile, i.e. 
+ * the makefile is generated and the test uses the default makefile template.
  */
-static char*
-parse_purpose(FILE* fl, int size, const char* templ, const char* finally_code, int* purposes_number);
+static int
+has_flat_rules(const TGenJob* job);
+
+static void 
+gen_common_makefile(const char* suite_root_path, const char* output_dir_path,
+                    const TGenJobList* jl);
+
+static void
+write_flat_makefile(FILE* mf, const TGenJobList* jl);
+
+static void
+gen_pch_header(const char* output_dir_path);
+
+
+static void 
+usage();
+
 
 /*
  * Reset the parameters read from the configuration file 
@@ -426,18 +499,13 @@ load_config(const char* fpath);
 static void
 load_parameter(const char* line);
 
-static char*
-replace_char(char* where, char from, char to)
-{
-    char* prval = strchr(where, from);
-    while (prval)
-    {
-        *(prval) = to;
-        prval = strchr(prval + 1, from);
-    }
-    
-    return where;
-}
+/*
+ * Process the command line options (see the description at the top of 
+ * this file).
+ */
+static int
+parse_options(int argc, char* argv[]);
+
 
 /************************************************************************/
 /* Main                                                                     */
@@ -446,10 +514,24 @@ int
 main (int argc, char* argv[])
 {
     int i;
+    int nopts;
     char* src_dir_end  = "src";
     char* out_dir_end  = "tests";
     char* scen_dir_end = "scenarios";   
 
+    nopts = parse_options(argc, argv);
+    if (nopts < 0)
+    {
+        usage();
+        return 1;
+    }
+    
+    // Skip the options, so that the positional parameters have
+    // the same indices as before.
+    argv[nopts] = argv[0];
+    argv += nopts;
+    argc -= nopts;
+
     if (argc < NCMD_PARAMS)
     {
         usage();
@@ -471,12 +553,17 @@ main (int argc, char* argv[])
         {
             /* process the specified config. file here */
             load_config(argv[ARGV_PARAM_INDEX]);
-            printf("Language is %s.\n", (bGenCpp ? "CPP" : "C"));
+            printf("Language is %s.\n", (gen_cfg.bGenCpp ? "CPP" : "C"));
         }
     }
     
     test_dir = strdup(argv[ARGV_TSDIR_INDEX]);
     
+    gen_cfg.wait_time = cfg_parm_values[CFG_WAIT_TIME_POS];
+    gen_cfg.year = gen_year;
+    gen_cfg.test_dir = test_dir;
+    gen_cfg.on_parse = report_parse;
+    
     char* src_dir  = concat_paths(test_dir, src_dir_end);
     char* out_dir  = concat_paths(test_dir, out_dir_end);
     char* scen_dir = concat_paths(test_dir, scen_dir_end);
@@ -494,11 +581,16 @@ main (int argc, char* argv[])
     
     run_generator(argv[1], src_dir, out_dir, scen_dir);
     
+    if (bWatch)
+    {
+        watch_suite(argv[1], src_dir, out_dir, scen_dir);
+    }
+    
     free(src_dir);
     free(out_dir);
     free(scen_dir);
-    free(def_mk_tpl);
-    free(subsuite_mk_tpl);
+    tpl_registry_free(&tpl_registry);
+    tpl_free(empty_mk_tpl);
 
     for (i = 0; i < CFG_PARAMS; ++i)
     {
@@ -513,6 +605,86 @@ main (int argc, char* argv[])
 
 /*******************************************************************************/
 
+// Process the options that precede the positional parameters.
+// Returns the number of argv elements consumed (not counting argv[0]) 
+// or -1 if the options are invalid.
+static int
+parse_options(int argc, char* argv[])
+{
+    int i = 1;
+    
+    while ((i < argc) && (argv[i][0] == '-'))
+    {
+        if (!strncmp(argv[i], "-j", 2))
+        {
+            const char* val = argv[i] + 2;
+            char* end = NULL;
+            long n;
+            
+            if (*val == 0)
+            {
+                if (++i >= argc)
+                {
+                    fprintf(stderr, "Option -j requires an argument.\n");
+                    return -1;
+                }
+                val = argv[i];
+            }
+            
+            n = strtol(val, &end, 10);
+            if ((end == val) || (*end != 0) || (n < 0))
+            {
+                fprintf(stderr, "Invalid number of jobs: %s\n", val);
+                return -1;
+            }
+            
+            if (n == 0)
+            {   // as many jobs as there are CPUs online
+                n = sysconf(_SC_NPROCESSORS_ONLN);
+                if (n < 1)
+                {
+                    n = 1;
+                }
+            }
+            nJobs = (int)n;
+        }
+        else if (!strcmp(argv[i], "-f"))
+        {
+            bUseCache = 0;
+        }
+        else if (!strcmp(argv[i], "-t"))
+        {
+            bTiming = 1;
+        }
+        else if (!strcmp(argv[i], "--stats"))
+        {
+            if (++i >= argc)
+            {
+                fprintf(stderr, "Option --stats requires an argument.\n");
+                return -1;
+            }
+            stats_path = argv[i];
+        }
+        else if (!strcmp(argv[i], "--watch"))
+        {
+            bWatch = 1;
+        }
+        else if (!strcmp(argv[i], "--"))
+        {
+            ++i;
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return -1;
+        }
+        ++i;
+    }
+    
+    return i - 1;
+}
+
 // Display a message on how to use this program.
 static void
 usage()
@@ -520,7 +692,14 @@ usage()
     fprintf(stderr, "\nThe T2C system generates C-sources for the tests from T2C templates.\n");
     fprintf(stderr, "T2C_ROOT environment variable should be defined before this program is executed.\n");
     fprintf(stderr, "\nUsage:\n");
-    fprintf(stderr, "t2c <main_suite_dir> <test_dir> [cfg_path]\n");
+    fprintf(stderr, "t2c [-j N] [-f] [-t] [--stats <file>] [--watch] <main_suite_dir> <test_dir> [cfg_path]\n");
+    fprintf(stderr, "\n-j N - generate the tests using N threads (0 - one thread per CPU).\n");
+    fprintf(stderr, "   The output does not depend on N. Default: 1.\n");
+    fprintf(stderr, "-f - regenerate all the tests, even those that are up to date.\n");
+    fprintf(stderr, "-t - print the time taken by the generation and other statistics.\n");
+    fprintf(stderr, "--stats <file> - write the statistics for each .t2c-file to <file>\n");
+    fprintf(stderr, "   (CSV if the name ends with \".csv\", JSON otherwise).\n");
+    fprintf(stderr, "--watch - keep running and regenerate the tests when their sources change.\n");
     fprintf(stderr, "\n<main_suite_dir> - here the 'tet_scen' file resides\n");
     fprintf(stderr, "<test_dir> - path to the directory of a test suite to be processed,\n");
     fprintf(stderr, "   e.g. \"TestSuites/my_suites/myfirst-t2c\"\n");
@@ -535,17 +714,19 @@ usage()
 }
 
 /*
- * Run gen_tests_group() for every tests group directory 
- * from inputdir_nme directory
+ * Run add_tests_group() for every tests group directory 
+ * from inputdir_nme directory, generate the tests and then write 
+ * the scenario files in the order the tests have been found.
  */
 static void 
 run_generator (const char* suite_root_in, const char* input_dir,
                const char* output_dir_in, const char* scen_dir_in)
 {
-    DIR*  pDir;
+    TDirList in_list;
+    TDirList out_list;
     FILE* ftet_scen = NULL;
     FILE* ffunc_scen = NULL;
-    struct dirent* ep;
+    TOutFile func_scen_out;
     char* output_dir = NULL;
     //char* makefile_dir = NULL;
     char* output_dir1 = NULL;
@@ -556,7 +737,6 @@ run_generator (const char* suite_root_in, const char* input_dir,
     char* ftet_scen_path1 = NULL;
     char* ftet_scen_path2 = NULL;
     unsigned ftet_scen_exists = 0;
-    char* pSave = NULL;
     char* scenario_file = NULL;
     char* path1 = NULL;
     char* suite_root = NULL;
@@ -564,6 +744,21 @@ run_generator (const char* suite_root_in, const char* input_dir,
     char* scen_dir = NULL;
     char* func_scen_path = NULL;
     char* output_dir_path = NULL;
+    
+    TGenJobList jl;
+    TGenGroup** groups = NULL;
+    int nGroups = 0;
+    int i;
+    
+    TGenCache new_cache;
+    char* cache_path = NULL;
+    int nCached = 0;
+    
+    double t_start = stats_time();
+    
+    // Any .t2c-file modified after this moment will be read again 
+    // the next time the generator is run.
+    new_cache.stamp = (long long)time(NULL);
      
     suite_root1 = concat_paths(t2c_suite_root, (char*)suite_root_in);
     suite_root = shorten_path(suite_root1);
@@ -583,16 +778,6 @@ run_generator (const char* suite_root_in, const char* input_dir,
     scenario_file = str_append(scenario_file, "/");
     scenario_file = str_append(scenario_file, func_tests_scenario_file_name);
 
-    /*
-    Clear the func_scen file.
-    */
-    ffunc_scen = fopen(scenario_file, "w");
-    if (!ffunc_scen)
-    {
-        fprintf (stderr, "Unable to open local scenario file: \n %s\n", scenario_file);
-    }
-    fclose(ffunc_scen);
-
     output_dir1 = concat_paths(suite_root, (char*) output_dir_in);
     output_dir = shorten_path(output_dir1);
     
@@ -606,74 +791,27 @@ run_generator (const char* suite_root_in, const char* input_dir,
     {
         input_path = str_append (input_path, "/");
     }
-
-    if (bAddTetScenRecord)
-    {
-        ftet_scen_path1 = alloc_mem_for_string(ftet_scen_path1, 
-            strlen(suite_root));
-        ftet_scen_path1 = str_append(ftet_scen_path1, suite_root);
-
-        ftet_scen_path = concat_paths(ftet_scen_path1, "/tet_scen");
-
-        ftet_scen_exists = is_file_exists(ftet_scen_path);
-        ftet_scen = open_file(ftet_scen_path, "a+", NULL);
-        if (!ftet_scen_exists)
-        {
-            fprintf(ftet_scen, "all\n");
-        }
-
-        ftet_scen_path2 = alloc_mem_for_string(ftet_scen_path2, 
-            strlen(scen_dir_in) + 1);
-
-        if (scen_dir_in[0] != '/')
-        {
-            ftet_scen_path2 = str_append(ftet_scen_path2, "/");
-        }
-        ftet_scen_path2 = str_append(ftet_scen_path2, scen_dir_in);
-
-
-        func_scen_path = concat_paths(ftet_scen_path2, "/func_scen");
-        fprintf(ftet_scen, "\t:include:%s\n", func_scen_path);
-        fclose(ftet_scen);
-        
-        free(func_scen_path);
-        func_scen_path = NULL;
-    }
     
     // load the default makefile template
-    FILE *ftmk = NULL;
-    char* tmk_path  = NULL;
-    char* tpl_path1 = NULL;
-    char* tpl_path2 = NULL;
-
-    tpl_path1 = alloc_mem_for_string(tpl_path1, strlen(t2c_root)); 
-    tpl_path1 = str_append(tpl_path1, t2c_root);
-    tpl_path2 = concat_paths(tpl_path1, 
-                             COMMON_TPL_DIR);
-    tmk_path = concat_paths(tpl_path2, DEFAULT_MAKEFILE_TPL);
-    
-    ftmk = open_file(tmk_path, "r", NULL);
-    if (ftmk != NULL)
-    {
-        def_mk_tpl = read_file_to_string(ftmk);
-        fclose(ftmk);
-    }
+    char* tmk_path = default_tpl_path(DEFAULT_MAKEFILE_TPL);
     
-    free(tpl_path1);
-    free(tpl_path2);
+    def_mk_tpl = get_template(tmk_path, T2CGEN_TPL_MAKEFILE);
     free(tmk_path);
     
     if (def_mk_tpl == NULL)
     {
         fprintf(stderr, "Unable to read default makefile template.\n");
-        def_mk_tpl = strdup("");
+        if (empty_mk_tpl == NULL)
+        {
+            empty_mk_tpl = t2cgen_compile_template(T2CGEN_TPL_MAKEFILE, "");
+        }
+        def_mk_tpl = empty_mk_tpl;
     }
     
     // load custom makefile template for this test suite (if specified)
     if ((cfg_parm_values[CFG_MK_TPL_POS] != NULL) && 
         (strlen(cfg_parm_values[CFG_MK_TPL_POS]) != 0))
     {
-        FILE* fsmk = NULL;
         char* tmp = NULL;
         char* smk_path = NULL;
         
@@ -681,1691 +819,1255 @@ run_generator (const char* suite_root_in, const char* input_dir,
         smk_path = (char*)shorten_path(tmp);
         free(tmp);
         
-        fsmk = open_file(smk_path, "r", NULL);
-        if (fsmk != NULL)
+        subsuite_mk_tpl = load_template(smk_path, T2CGEN_TPL_MAKEFILE);
+        free(smk_path);
+    }
+    
+    // load the template of the rules for the non-recursive makefile
+    if (bFlatMakefile)
+    {
+        tmk_path = default_tpl_path(FLAT_MAKEFILE_TPL);
+        flat_mk_tpl = get_template(tmk_path, T2CGEN_TPL_MAKEFILE);
+        free(tmk_path);
+        
+        if (flat_mk_tpl == NULL)
         {
-            subsuite_mk_tpl = read_file_to_string(fsmk);
-            fclose(fsmk);
+            fprintf(stderr, "Unable to read the template of the non-recursive makefile, "
+                            "the tests will be built by recursive make.\n");
         }
-       
-        free(smk_path);
     }
     
-    // read directory names from input_dir directory 
-    pDir = opendir (input_path);
-    if (pDir == NULL)
+    jl.jobs = NULL;
+    jl.nJobs = 0;
+    jl.nNext = 0;
+    jl.suite_root = suite_root;
+    jl.output_dir = output_dir;
+    pthread_mutex_init(&jl.lock, NULL);
+    
+    // read directory names from input_dir directory; the types of the
+    // entries are known from the listing, no need to stat() each of them
+    if (!dir_list_open (&in_list, NULL, input_path))
     {
         error_with_exit_code (EXIT_CODE_CANT_OPEN_DIR,
                               "%s: can't open directory %s", "test generator", 
                               input_path);
     } 
     
-    ep = readdir (pDir);
-    while (ep != NULL)
+    for (i = 0; i < in_list.nEntries; ++i)
     {
+        const char* name = in_list.sorted[i]->name;
         char* group_path = NULL;
-        group_path = str_sum (input_path, ep->d_name);
 
-        if (is_directory_exists (group_path) && strcmp (ep->d_name, ".") 
-            && strcmp (ep->d_name, "..") && strcmp (ep->d_name, "CVS")
-            && strcmp (ep->d_name, ".bzr"))
+        if ((in_list.sorted[i]->type != FS_TYPE_DIR) || !strcmp (name, "CVS")
+            || !strcmp (name, ".bzr"))
         {
-            pSave = group_path;
-            if (group_path[strlen (group_path) - 1] != '/')  
-            {
-                group_path = str_append (group_path, "/");
-            }
-            pSave = NULL;
-            gen_tests_group (suite_root, output_dir, /*makefile_dir,*/
-                             group_path, ep->d_name, 
-                             scenario_file);
+            continue;
+        }
+        
+        group_path = str_sum (input_path, name);
+        if (group_path[strlen (group_path) - 1] != '/')  
+        {
+            group_path = str_append (group_path, "/");
         }
-        ep = readdir (pDir);
+        
+        groups = (TGenGroup**)alloc_mem(groups, nGroups + 1, sizeof(TGenGroup*));
+        groups[nGroups++] = add_tests_group (&jl, &in_list, group_path, name);
         free (group_path);
     }
-
-    /* generate common and global makefiles */
-    /* form output dir path */
-    output_dir_path = alloc_mem_for_string (output_dir_path, 
-        strlen (output_dir));
-    output_dir_path = str_append (output_dir_path, output_dir);
-    if (output_dir_path[strlen (output_dir_path) - 1] != '/')
+    dir_list_close (&in_list);
+    
+    /* The output directory is read once, the workers look for the 
+     * directories of the tests in this list. */
+    if ((nGroups > 0) && !is_directory_exists (output_dir))
     {
-        output_dir_path = str_append (output_dir_path, "/");
+        create_dir (output_dir);
     }
-
-    gen_common_makefile(suite_root, output_dir_path);
-
-    free (scenario_file);
-    free (output_dir);
-    free (output_dir1);
-    free (output_dir_path);
-    free (input_path);
-    free (input_path1);
-    free (input_path2);
-    free (suite_root);
-    free (suite_root1);
-    free (ftet_scen_path);
-    free (ftet_scen_path1);
-    free (ftet_scen_path2);
-    free (pDir);
-    free (path1);
-    free (scen_dir);
-}
-
-/*
- * Read input files from input_dir, generates tests and makefiles, 
- * create directory where the tests and makefiles will be placed, 
- * add corresponding record in scen_file.
- *
- */
-static char* 
-gen_tests_group (const char* suite_root, const char* output_dir, 
-                 //const char* makefile_dir,
-                 const char* group_path, const char* group_nme, 
-                 const char* scen_file)
-{
-    DIR*  pDir;
-    struct dirent* ep;
-    FILE* pFile;
-
-    char* pSave = NULL;
-    char* tpl_path = NULL;
-    char* output_dir_path = NULL;
-
-    char* test = NULL;
-    char* test_tpl = NULL;
-    char* purpose_tpl = NULL;
-    
-    /* common test template*/
-    tpl_path = str_sum (group_path, COMMON_TEST_TPL);
-    
-    if (is_file_exists (tpl_path))
+    out_list.fd = -1;
+    out_list.entries = NULL;
+    out_list.nEntries = 0;
+    out_list.sorted = NULL;
+    if ((nGroups > 0) && !dir_list_open (&out_list, NULL, output_dir))
     {
-        pFile = open_file (tpl_path, "r", NULL);
-    } else {
-        char* tpl_path1 = NULL;
-        char* tpl_path2 = NULL;
-
-        free (tpl_path);
-        tpl_path1 = alloc_mem_for_string(tpl_path1, strlen(t2c_root)); 
-        tpl_path1 = str_append(tpl_path1, t2c_root);
-        tpl_path2 = concat_paths(tpl_path1, 
-                                 COMMON_TPL_DIR);
-        tpl_path = concat_paths(tpl_path2, COMMON_TEST_TPL);
-        
-        pFile = open_file(tpl_path, "r", NULL);
-
-        free(tpl_path1);
-        free(tpl_path2);
+        error_with_exit_code (EXIT_CODE_CANT_OPEN_DIR,
+                              "%s: can't open directory %s", "test generator", 
+                              output_dir);
     }
-    free(tpl_path);
-    test_tpl = read_file_to_string(pFile);
-    fclose (pFile);
+    jl.out_list = &out_list;
     
-    /* common purpose template */
-    tpl_path = concat_paths ((char*) group_path, COMMON_PURPOSE_TPL);
+    /* load the results of the previous run */
+    init_gen_year();
+    calc_cfg_hash(suite_root, output_dir);
+    cache_path = concat_paths(output_dir, GEN_CACHE_FILE);
+    gen_cache_load(&gen_cache, cache_path);
 
-    if (is_file_exists (tpl_path))
+    /* generate the tests */
+    run_jobs(&jl, nJobs);
+    dir_list_close(&out_list);
+    
+    stats_init(&gen_stats);
+    for (i = 0; i < jl.nJobs; ++i)
     {
-        pFile = open_file (tpl_path, "r", NULL);
-    } else {
-        char* tpl_path1 = NULL;
-        char* tpl_path2 = NULL;
-        
-        free (tpl_path);
-        tpl_path1 = alloc_mem_for_string(tpl_path1, strlen(t2c_root)); 
-        tpl_path1 = str_append(tpl_path1, t2c_root);
-        tpl_path2 = concat_paths(tpl_path1, 
-                                  COMMON_TPL_DIR);
-        tpl_path = concat_paths(tpl_path2, COMMON_PURPOSE_TPL);
-        pFile = open_file(tpl_path, "r", NULL);
-        
-        free(tpl_path1);
-        free(tpl_path2);
+        if (!jl.jobs[i].bOK)
+        {
+            ++jl.jobs[i].stats.nFailed;
+        }
+        stats_add(&gen_stats, &jl.jobs[i].stats);
     }
-    purpose_tpl = read_file_to_string (pFile);
-    free (tpl_path);
-    fclose (pFile);
-
-    /* form output dir path */
-    output_dir_path = alloc_mem_for_string (output_dir_path, 
-                                            strlen (output_dir));
-    output_dir_path = str_append (output_dir_path, output_dir);
-    if (output_dir_path[strlen (output_dir_path) - 1] != '/')
+    
+    /* save the cache records for the tests generated successfully */
+    new_cache.entries = (TCacheEntry*)alloc_mem(NULL, jl.nJobs + 1, sizeof(TCacheEntry));
+    new_cache.nEntries = 0;
+    for (i = 0; i < jl.nJobs; ++i)
     {
-        output_dir_path = str_append (output_dir_path, "/");
+        if (jl.jobs[i].bOK)
+        {
+            new_cache.entries[new_cache.nEntries++] = jl.jobs[i].rec;
+        }
+        if (jl.jobs[i].bCached)
+        {
+            ++nCached;
+        }
     }
     
-    if (!is_directory_exists (output_dir_path))
+    if (!gen_cache_save(&new_cache, cache_path))
     {
-        create_dir (output_dir_path);        
+        fprintf(stderr, "Unable to write generation cache file: \n %s\n", cache_path);
     }
+    free(new_cache.entries);    // the paths belong to the jobs
+    gen_cache_free(&gen_cache);
+    free(cache_path);
     
-    /* read file names from group_path directory */
-    pDir = opendir (group_path);
-    if (pDir == NULL)
+    if (nCached > 0)
     {
-        error_with_exit_code(EXIT_CODE_CANT_OPEN_DIR,
-                             "%s: can't open directory %s", "test generator", 
-                             group_path);
-    } 
+        printf("%d of %d test(s) are up to date.\n", nCached, jl.nJobs);
+    }
 
-    ep = readdir (pDir);
-    while (ep != NULL)
+    /*
+     * Write the scenario files. This is done here rather than by the workers,
+     * so the order of the records does not depend on the number of jobs.
+     */
+    ffunc_scen = out_file_open(&func_scen_out, scenario_file);
+    if (!ffunc_scen)
     {
-        char* ftest_src = NULL;
-        char* ftest_nme = NULL;
-        char* input_path = NULL;
-        char* output_path = NULL;
-        int bOK = 1;
-        char* makefile_tpl = NULL;
-        
-        ftest_nme = get_substr (ep->d_name, 0, 
-                                strstr (ep->d_name, INPUT_EXT) - (ep->d_name + 1));
-        if ((strcmp (ep->d_name + strlen (ep->d_name) - strlen (INPUT_EXT), INPUT_EXT)) 
-            || (ftest_nme == NULL)) 
+        out_file_discard(&func_scen_out);
+        fprintf (stderr, "Unable to open local scenario file: \n %s\n", scenario_file);
+    }
+    else
+    {
+        for (i = 0; i < jl.nJobs; ++i)
         {
-            ep = readdir (pDir);
-            if (ftest_nme)
+            if (jl.jobs[i].bOK)
             {
-                free (ftest_nme);
+                add_test_in_scen (suite_root, ffunc_scen, output_dir, 
+                                  jl.jobs[i].ftest_nme);
             }
-            free(makefile_tpl);
-            continue;
-        }
-        /* generate test string */
-        input_path = str_sum(group_path, ep->d_name);
-        
-        char* tpl_mk_path = str_sum(group_path, ftest_nme);
-        tpl_mk_path = str_append(tpl_mk_path, MAKEFILE_TPL_EXT);
-        
-        if (is_file_exists(tpl_mk_path))
-        {   // template makefile exists, so we use it
-            FILE* fd = open_file(tpl_mk_path, "r", NULL);
-            makefile_tpl = read_file_to_string(fd);
-            fclose(fd);
         }
-        else if (subsuite_mk_tpl != NULL)
+        if (!out_file_commit(&func_scen_out))
         {
-            makefile_tpl = strdup(subsuite_mk_tpl);
-        }
-        else
-        {   // template makefiles do not exist, so we use the default one
-            makefile_tpl = strdup(def_mk_tpl);
+            fprintf (stderr, "Unable to write local scenario file: \n %s\n", scenario_file);
         }
-        
-        free(tpl_mk_path);
-        
-        /* parse header of the .t2c-file here */
-        bOK = parse_header(input_path);
+    }
 
-        if (!bOK)        
-        {
-            fprintf (stderr, "warning: invalid header in %s\n", input_path);
-            free (input_path);
-            free (ftest_nme);
-            free(makefile_tpl);
-            continue;
-        }
-        
-        test = gen_test (test_tpl, purpose_tpl, input_path, group_nme, ftest_nme);
-                         
-        if (test == NULL)
+    if (bAddTetScenRecord)
+    {
+        ftet_scen_path1 = alloc_mem_for_string(ftet_scen_path1, 
+            strlen(suite_root));
+        ftet_scen_path1 = str_append(ftet_scen_path1, suite_root);
+
+        ftet_scen_path = concat_paths(ftet_scen_path1, "/tet_scen");
+
+        ftet_scen_path2 = alloc_mem_for_string(ftet_scen_path2, 
+            strlen(scen_dir_in) + 1);
+
+        if (scen_dir_in[0] != '/')
         {
-            ep = readdir (pDir);
-            fprintf (stderr, "Test generator is unable to generate test for %s\n", input_path);
-            free (input_path);
-            free (ftest_nme);
-            free(makefile_tpl);
-            continue;
+            ftet_scen_path2 = str_append(ftet_scen_path2, "/");
         }
+        ftet_scen_path2 = str_append(ftet_scen_path2, scen_dir_in);
 
-        output_path = str_sum(output_dir_path, ftest_nme);
-        if (output_path[strlen(output_path) - 1] != '/')
+
+        func_scen_path = concat_paths(ftet_scen_path2, "/func_scen");
+        
+        ftet_scen_exists = is_file_exists(ftet_scen_path);
+        ftet_scen = open_file(ftet_scen_path, "a+", NULL);
+        if (!ftet_scen_exists)
         {
-            output_path = str_append(output_path, "/");
+            fprintf(ftet_scen, "all\n");
         }
-        pSave = NULL;
         
-        if (!is_directory_exists (output_path))
+        // the record is added only once, so that the file is not changed
+        // each time the tests are generated
+        if (!is_scen_included(ftet_scen, func_scen_path))
         {
-            create_dir (output_path);        
+            fprintf(ftet_scen, "\t:include:%s\n", func_scen_path);
         }
-
-        gen_makefile(suite_root, output_path, ftest_nme, makefile_tpl);
-        ftest_src = str_sum (ftest_nme, (bGenCpp ? ".cpp" : ".c"));
-        output_path = str_append (output_path, ftest_src);
-        pFile = open_file (output_path, "w", NULL);
-
-        fputs (test, pFile);
-        add_test_in_scen (suite_root, scen_file, output_dir, ftest_nme);
+        fclose(ftet_scen);
         
-        free (test);
-        free (ftest_src);
-        free (ftest_nme);
-        free (input_path);
-        free (output_path);	
-        free(makefile_tpl);   
-
-        for (int i = 0; i < HEADER_PARAMS_NUM; ++i)
-	    {
-	        free(hdr_param_value[i]);
-	    }
-        fclose (pFile);
-
-        ep = readdir (pDir);
+        free(func_scen_path);
+        func_scen_path = NULL;
     }
 
-    (void) closedir (pDir);
-
-    free (test_tpl);
-    free (output_dir_path);
-    free (purpose_tpl);
-    return NULL;
-}
-
-/*
- *   Generates TET scen file
- */
-static void 
-add_test_in_scen (const char* suite_root, const char* scen_file, 
-                  const char* output_dir, const char* ftest_nme)
-{
-    FILE* sf = NULL;
-    char* scen_item = NULL;
-    char* short_output_dir = NULL;
-
-    if ( !scen_file || !output_dir || !ftest_nme)
+    /* generate common and global makefiles */
+    /* form output dir path */
+    output_dir_path = alloc_mem_for_string (output_dir_path, 
+        strlen (output_dir));
+    output_dir_path = str_append (output_dir_path, output_dir);
+    if (output_dir_path[strlen (output_dir_path) - 1] != '/')
     {
-        return;
+        output_dir_path = str_append (output_dir_path, "/");
     }
-    sf = open_file (scen_file, "a+", NULL);
 
-    short_output_dir = replace_substr_in_string ((char*) output_dir, 
-                                                 suite_root, "");
-    scen_item = str_sum(scen_item, short_output_dir);
-    if (short_output_dir[0] != '/')
+    gen_common_makefile(suite_root, output_dir_path, &jl);
+    
+    if (bTiming || (stats_path != NULL))
     {
-        char* p = scen_item;
-        scen_item = str_sum("/", scen_item);
-        free (p);
+        report_stats(&jl, stats_time() - t_start);
     }
-    if (short_output_dir[strlen (short_output_dir) - 1] != '/')
+
+    for (i = 0; i < jl.nJobs; ++i)
     {
-        scen_item = str_append (scen_item, "/");
+        free (jl.jobs[i].input_path);
+        free (jl.jobs[i].ftest_nme);
     }
-    scen_item = str_append (scen_item, ftest_nme);
-    scen_item = str_append (scen_item, "/");
-    scen_item = str_append (scen_item, ftest_nme);
-    fprintf (sf, "\t%s\n", scen_item);
+    free (jl.jobs);
+    pthread_mutex_destroy(&jl.lock);
     
-    free (scen_item);
-    free (short_output_dir);
-    fclose (sf);
+    for (i = 0; i < nGroups; ++i)
+    {
+        free (groups[i]->group_path);
+        free (groups[i]->group_nme);
+        free (groups[i]);
+    }
+    free (groups);
+
+    free (scenario_file);
+    free (output_dir);
+    free (output_dir1);
+    free (output_dir_path);
+    free (input_path);
+    free (input_path1);
+    free (input_path2);
+    free (suite_root);
+    free (suite_root1);
+    free (ftet_scen_path);
+    free (ftet_scen_path1);
+    free (ftet_scen_path2);
+    free (path1);
+    free (scen_dir);
 }
 
 /*
- * Generate a local makefile 
+ * Print the statistics of the generation (see "-t" option) and/or write 
+ * them to a file (see "--stats" option).
  */
-static void 
-gen_makefile(const char* suite_root, const char* dir_path, const char* ftest_nme, const char* makefile_tpl)
+static void
+report_stats(const TGenJobList* jl, double wall_time)
 {
-    FILE* mf;
-    char* makefile_path = NULL;
-
-    makefile_path = str_sum (dir_path, "/Makefile");
-    mf = open_file (makefile_path, "w+", NULL);
-
-    if (!mf)
+    TFileStats* files = NULL;
+    int i;
+    
+    if (bTiming)
     {
-        free (makefile_path);
-        fprintf(stderr, "Unable to create local makefile in %s\n", dir_path);
-        return;
+        stats_print(stdout, &gen_stats, wall_time, nJobs);
     }
     
-    char* mf_str = strdup(makefile_tpl);
-    mf_str = replace_all_substr_in_string(mf_str, mk_params[MK_NAME_POS], ftest_nme);
-    mf_str = replace_all_substr_in_string(mf_str, mk_params[MK_DIR_PATH_POS], dir_path);
-    mf_str = replace_all_substr_in_string(mf_str, mk_params[MK_SUITE_ROOT_POS], suite_root);
-    
-    //-- (begin) - to be deprecated later
-    char *t2c_basename = NULL;
-	if(hdr_param_value[PARAM_T2C_BASENAME_POS] != NULL && hdr_param_value[PARAM_T2C_BASENAME_POS][0] != 0 )
-    {
-		t2c_basename = strdup(hdr_param_value[PARAM_T2C_BASENAME_POS]);
-	}
-    else
+    if (stats_path == NULL)
     {
-		t2c_basename = strdup(ftest_nme);
-	}
-    mf_str = replace_all_substr_in_string(mf_str, mk_params[MK_TMP_BASENAME_POS], t2c_basename);
-    free(t2c_basename);
-    //-- (end)
+        return;
+    }
     
-    fputs(mf_str, mf);
-    free(mf_str);
+    files = (TFileStats*)alloc_mem(files, jl->nJobs + 1, sizeof(TFileStats));
+    for (i = 0; i < jl->nJobs; ++i)
+    {
+        const TGenJob* job = &jl->jobs[i];
+        
+        files[i].path = job->input_path;
+        files[i].group = job->group->group_nme;
+        files[i].test = job->ftest_nme;
+        files[i].status = job->bCached ? STATUS_CACHED : 
+            (job->bOK ? STATUS_GENERATED : STATUS_FAILED);
+        files[i].stats = &job->stats;
+    }
     
-    fclose (mf);
-    free (makefile_path);
+    if (!stats_write(stats_path, test_dir, files, jl->nJobs, &gen_stats, wall_time, nJobs))
+    {
+        fprintf(stderr, "Unable to write the statistics to %s\n", stats_path);
+    }
+    free(files);
 }
 
-static char* 
-gen_test (const char* test_tpl, const char* purpose_tpl, 
-          const char* input_path, const char* group_nme, const char* test_nme)
-{
-    int i;
-    int purposes_num = 0;
-
-    char* test = NULL;
-
-    char* common_tag_values[COMMON_TAGS_NUM];
-    
-    struct tm * ltime = NULL;
-    time_t tsec;
-    int year = 2007;
+// The directories watched in the "--watch" mode (the tags for watcher_add()).
+#define WATCH_INPUT_DIR     0   // <test_dir>/src, contains the groups
+#define WATCH_GROUP_DIR     1   // the directory of a group
+#define WATCH_TPL_DIR       2   // the directory of the default templates
+#define WATCH_SUITE_MK_DIR  3   // the directory of MAKEFILE_TEMPLATE
 
-    char strYear[8] = "YYYY";
+// After a change, the tests are regenerated when there have been no more 
+// changes for this time (in milliseconds).
+#define WATCH_QUIET_MS      50
 
-    int bOK = 1;
+// What has changed (see on_watch_event()).
+typedef struct
+{
+    const char* suite_mk_nme;   // the name of MAKEFILE_TEMPLATE, NULL if none
+    int bRegen;         // the tests should be regenerated
+    int bTemplates;     // some templates have changed
+    int bGroups;        // the groups have been added or removed
+} TWatchChanges;
 
-    for (i = 0; i < COMMON_TAGS_NUM; i++)
-    {
-        common_tag_values[i] = NULL;
-    }
+// Nonzero if the name ends with 'ext'.
+static int
+has_ext (const char* name, const char* ext)
+{
+    size_t len = strlen (name);
+    size_t ext_len = strlen (ext);
+    
+    return (len > ext_len) && !strcmp (name + len - ext_len, ext);
+}
 
-    bOK = parse_file(input_path, purpose_tpl, &purposes_num, test_nme, 
-        &(common_tag_values[GLOBALS_POS]), 
-        &(common_tag_values[STARTUP_POS]),
-        &(common_tag_values[CLEANUP_POS]),
-        &(common_tag_values[TEST_PURPOSES_POS]),
-        &(common_tag_values[PCF_FUNCS_POS]));
+// Classify the change reported by watcher_wait().
+static void
+on_watch_event (void* data, int tag, const char* name, int bDir)
+{
+    TWatchChanges* changes = (TWatchChanges*)data;
+    int bTemplate = !bDir && (has_ext (name, ".tpl") || has_ext (name, MAKEFILE_TPL_EXT));
     
-    if ((!bOK) || (test_nme == NULL)) 
-    { 
-        return NULL;
+    switch (tag)
+    {
+    case WATCH_INPUT_DIR:
+        if (bDir)
+        {
+            changes->bRegen = changes->bGroups = 1;
+        }
+        break;
+    case WATCH_GROUP_DIR:
+        if (bDir && (name[0] == '\0'))
+        {   // the group itself has been removed
+            changes->bRegen = changes->bGroups = 1;
+        }
+        else if (!bDir && has_ext (name, INPUT_EXT))
+        {
+            changes->bRegen = 1;
+        }
+        else if (bTemplate)
+        {
+            changes->bRegen = changes->bTemplates = 1;
+        }
+        break;
+    case WATCH_TPL_DIR:
+        if (bTemplate)
+        {
+            changes->bRegen = changes->bTemplates = 1;
+        }
+        break;
+    case WATCH_SUITE_MK_DIR:
+        if ((changes->suite_mk_nme != NULL) && !strcmp (name, changes->suite_mk_nme))
+        {
+            changes->bRegen = changes->bTemplates = 1;
+        }
+        break;
+    default:    // WATCH_TAG_ALL
+        changes->bRegen = changes->bTemplates = changes->bGroups = 1;
+        break;
     }
-    test = strdup(test_tpl);
+}
 
-    common_tag_values[GROUP_NAME_POS]   = (char*)strdup(group_nme); 
-    common_tag_values[OBJECT_NAME_POS]  = (char*)strdup(test_nme);
-    common_tag_values[FTEMPLATE_POS]    = (char*)strdup(input_path);
-    common_tag_values[WAIT_TIME_POS]    = (char*)strdup(cfg_parm_values[CFG_WAIT_TIME_POS]);
+// Watch the directories of the groups in 'input_path'.
+static void
+watch_groups (TWatcher* w, const char* input_path)
+{
+    TDirList in_list;
+    char* group_path = NULL;
+    int i;
     
-    gen_tp_arrays(purposes_num, &common_tag_values[TET_HOOKS_POS], &common_tag_values[TP_FUNCS_POS]);
-        
-   
-    tsec = time(NULL);
-    ltime = localtime(&tsec);
-    if (ltime)
+    if (!dir_list_open (&in_list, NULL, input_path))
     {
-        year = ltime->tm_year + 1900;
+        dir_list_close (&in_list);
+        return;
     }
-    
-    sprintf(strYear, "%d", year);
-    
-    common_tag_values[YEAR_POS] = strdup(strYear);
-    common_tag_values[LIBRARY_POS] = strdup(hdr_param_value[PARAM_LIB_POS]);
-    common_tag_values[LIBSECTION_POS] = strdup(hdr_param_value[PARAM_SECTION_POS]);
-    
-    replace_char(common_tag_values[LIBRARY_POS], '\n', ' ');
-    replace_char(common_tag_values[LIBRARY_POS], '\r', ' ');
-    replace_char(common_tag_values[LIBSECTION_POS], '\n', ' ');
-    replace_char(common_tag_values[LIBSECTION_POS], '\r', ' ');
-
-    // Prepare the list of additional req catalogues
-    common_tag_values[RCAT_NAMES_POS] = strdup("");
+    for (i = 0; i < in_list.nEntries; ++i)
     {
-        const char* delims = " ,;\t";
-        char* token = NULL;
+        const char* name = in_list.sorted[i]->name;
         
-        token = strtok(hdr_param_value[PARAM_RCAT_POS], delims);
-        while (token)
+        if ((in_list.sorted[i]->type != FS_TYPE_DIR) || !strcmp (name, "CVS")
+            || !strcmp (name, ".bzr"))
         {
-            common_tag_values[RCAT_NAMES_POS] = str_append(common_tag_values[RCAT_NAMES_POS], "    \"");
-            common_tag_values[RCAT_NAMES_POS] = str_append(common_tag_values[RCAT_NAMES_POS], token);
-            common_tag_values[RCAT_NAMES_POS] = str_append(common_tag_values[RCAT_NAMES_POS], "\",\n");
-            token = strtok(NULL, delims);
+            continue;
         }
-    }   
-    
-    /* do all substitutions and deallocate memory */
-    for (i = 0; i < COMMON_TAGS_NUM; i++)
-    {
-        test = replace_all_substr_in_string(test, common_tags[i], 
-                                            common_tag_values[i]);
-        free(common_tag_values[i]);
+        
+        group_path = str_sum (input_path, name);
+        if (!watcher_add (w, group_path, WATCH_GROUP_DIR))
+        {
+            fprintf (stderr, "Unable to watch directory %s\n", group_path);
+        }
+        free (group_path);
     }
-    
-
-
-    test = replace_all_substr_in_string(test, TAG_SUITE_SUBDIR_NAME, test_dir);
-    return test;
+    dir_list_close (&in_list);
 }
 
-static int 
-parse_header(const char* input_path)
+/*
+ * The "--watch" mode: wait for the changes of the .t2c-files, the templates 
+ * of the groups, the default templates and the makefile template of the 
+ * subsuite and run the generator again after each of them. The tests that 
+ * have not changed are not regenerated (the generation cache is used from 
+ * now on even if "-f" was specified) and the files that are the same are not
+ * rewritten, so only the tests affected by a change are regenerated and 
+ * rebuilt. The templates stay in the registry until some of them change.
+ * The config file is read only once, the generator should be restarted if
+ * it changes.
+ */
+static void
+watch_suite (const char* suite_root_in, const char* input_dir,
+             const char* output_dir, const char* scen_dir)
 {
-    int i;
-    int known = 0;
-    
-    int size = 0;
-    char* str = NULL;
-    
-    char* tstr = NULL;  // temporary
-    char* str_t = NULL; // temporary
-    
-    char* beg_ln = NULL;
-    
-    FILE* ft2c_file = NULL;
+    TWatcher w;
+    TWatchChanges changes;
+    char* suite_root = NULL;
+    char* input_path = NULL;
+    char* tpl_dir = NULL;
+    char* smk_path = NULL;
+    char* smk_dir = NULL;
+    char* tmp = NULL;
+    double t_start;
     
-    if (!is_file_exists(input_path))
+    if (!watcher_init (&w))
     {
-        return 0;
+        fprintf (stderr, "Unable to watch the sources of the tests for changes.\n");
+        watcher_close (&w);
+        return;
     }
     
-    ft2c_file = open_file(input_path, "r", NULL);
-    size = fsize(ft2c_file);
-    str = alloc_mem_for_string(str, size + 1);
+    tmp = concat_paths (t2c_suite_root, (char*)suite_root_in);
+    suite_root = shorten_path (tmp);
+    free (tmp);
     
-    for (i = 0; i < HEADER_PARAMS_NUM; ++i)
+    tmp = concat_paths (suite_root, (char*)input_dir);
+    input_path = shorten_path (tmp);
+    free (tmp);
+    if (input_path[strlen (input_path) - 1] != '/')
     {
-        hdr_param_value[i] = strdup("");
+        input_path = str_append (input_path, "/");
     }
     
-    do
+    changes.suite_mk_nme = NULL;
+    if ((cfg_parm_values[CFG_MK_TPL_POS] != NULL) && 
+        (strlen (cfg_parm_values[CFG_MK_TPL_POS]) != 0))
     {
-        fgets(str, size, ft2c_file);
-        ++ln_count;
-        tstr = trim_with_nl(str);
-       
-        for (i = 0; i < HEADER_PARAMS_NUM; ++i)
-        {   
-            if (tstr[0] == '#')
-            {
-                beg_ln = strstr(tstr + 1, hdr_param_name[i]);
-                if (beg_ln == tstr + 1)
-                {
-                    beg_ln = beg_ln + strlen(hdr_param_name[i]);
-                    if ((beg_ln[0] == ' ') || (beg_ln[0] == '\t'))
-                    {
-                        str_t = trim_with_nl(beg_ln);
-                        
-                        free(hdr_param_value[i]);
-                        hdr_param_value[i] = strdup(str_t);
-                    }
-                    break;
-                }
-            }
-        } /*end for*/
+        tmp = concat_paths (suite_root, cfg_parm_values[CFG_MK_TPL_POS]);
+        smk_path = shorten_path (tmp);
+        free (tmp);
         
-        if (feof(ft2c_file) || ferror(ft2c_file))
+        smk_dir = strdup (smk_path);
+        tmp = strrchr (smk_dir, '/');
+        if (tmp != NULL)
         {
-            break;
+            *tmp = '\0';
+            changes.suite_mk_nme = tmp + 1;
+        }
+        else
+        {
+            free (smk_dir);
+            smk_dir = NULL;
         }
     }
-    while ((tstr[0] == 0) || (tstr[0] == '#'));
     
-    free (str);
-    fclose (ft2c_file);
-    return 1;
-}
-
-/*
- * Reads strings from stream and stores them in str,
- * while not comment string is reached, and increases str_counter.
- */
-static char*
-fgets_and_skip_comments (char* str, int num, FILE* stream, int* str_counter)
-{
-    char* macros_str[] = { 
-        "#define", "#undef",
-        "#include",
-        "#if", "#elif", "#else", "#endif",
-        "#ifdef", "#ifndef",
-        "#error",
-        "#import",
-        "#pragma",
-        "#line",
-        NULL
-    };
-
-    int i;
-    int macro = 0;
-    /*char* tstr = NULL;*/
-
-    if ((feof(stream)) || (ferror(stream)))
-    {
-        return NULL;
-    }
-
-    do
-    {
-        fgets (str, num, stream);
-        (*str_counter)++;
-        i = 0;
-        while (macros_str[i] != NULL)
-        {
-            int len = strlen (macros_str[i]);
-            if ((!strncmp (str, macros_str[i], len)) && 
-                ((str[len] == ' ') || (str[len] == '\t') || (str[len] == '\n') || (str[len] == '\r')))
-            {
-                macro = 1;
-                break;
-            }
-            i++;
-        }
-    }
-    while ((str[0] == '#') && !macro && (!feof(stream)) && (!ferror(stream)));
-
-    if ((feof(stream)) || (ferror(stream)))
-    {
-        return NULL;
-    } else {
-        return (str);
-    }
-}
-
-static int
-parse_file(const char* input_path, const char* purpose_tpl, int* purposes_number, const char* test_nme,
-           char** pstrGlobals, char** pstrStartup,
-           char** pstrCleanup, char** pstrPurposes,
-           char** pcf_funcs)
-{
-    FILE* fl = NULL;
-    int size = 0;
-    char* str = NULL;
-    char* str_t = NULL;
-    char* text = NULL;
-    char* lsb_min_ver = NULL;
-    char* lsb_max_ver = NULL;
-    
-    int nBlocks = 0;
-    int isBad = 0;
-
-    // reset line count
-    ln_count = 0;
-    printf ("Parsing file %s\n", input_path);
+    tpl_dir = default_tpl_path ("");
     
-    *purposes_number = 0;
-
-    if (!is_file_exists(input_path))
+    if (!watcher_add (&w, input_path, WATCH_INPUT_DIR) || 
+        !watcher_add (&w, tpl_dir, WATCH_TPL_DIR) ||
+        ((smk_dir != NULL) && !watcher_add (&w, smk_dir, WATCH_SUITE_MK_DIR)))
     {
-        return 0;
+        fprintf (stderr, "Unable to watch the sources of the tests for changes.\n");
     }
-
-	
-    fl = open_file (input_path, "r", NULL);
-
-    size = fsize (fl);
-
-    if (size <= 2)
-    {
-        return 0;
-    }
-
-    str = alloc_mem_for_string (str, size + 1);
-
-    *pstrGlobals = strdup("");
-    *pstrStartup = strdup("");
-    *pstrCleanup = strdup("");
-    *pstrPurposes = strdup("");
-    *pcf_funcs = strdup("");
-    
-    char* attribs = NULL; 
-    char* bl_attr_name[] = {"parentControlFunction", "lsbMinVersion", "lsbMaxVersion", NULL};
-    char* bl_attr_val[]  = {NULL, NULL, NULL, NULL};
-    
-    char* pcf_name = NULL;
-    
-
-    do
+    else
     {
-        if (fgets_and_skip_comments (str, size, fl, &ln_count) == NULL)
-        {
-            break; /* EOF has been reached */
-        }
+        watch_groups (&w, input_path);
+        
+        // only the tests that have changed are regenerated from now on
+        bUseCache = 1;
         
-        int tag_num = t2c_parse_open_tag(str, top_tag, &attribs);
-        switch (tag_num)
+        printf ("Watching %s for changes, press Ctrl-C to stop.\n", input_path);
+        fflush (stdout);
+        
+        for (;;)
         {
-        case -1:    // not a tag
-            break;
-        case ITOP_GLOBAL:
-            /* found GLOBAL */
-            free(text);
-            text = parse_global(fl, size);
-            if (text == NULL) 
+            changes.bRegen = changes.bTemplates = changes.bGroups = 0;
+            if (!watcher_wait (&w, WATCH_QUIET_MS, on_watch_event, &changes))
             {
-                isBad = 1;
-                fprintf (stderr, "Line %d: Invalid GLOBAL section.\n", ln_count);
+                fprintf (stderr, "Unable to watch the sources of the tests for changes.\n");
                 break;
             }
-            
-            free(*pstrGlobals);
-            *pstrGlobals = strdup(text);
-           
-            break;
-        case ITOP_STARTUP:
-            /* found STARTUP */
-            free(text);
-            text = parse_startup(fl, size);
-            if (text == NULL) 
-            {
-                isBad = 1;
-                fprintf (stderr, "Line %d: Invalid STARTUP section.\n", ln_count);
-                break;
-            }
-            
-            free(*pstrStartup);
-            *pstrStartup = strdup(text);
-            
-            break;
-        case ITOP_CLEANUP:
-            /* found CLEANUP */
-            free(text);
-            text = parse_cleanup(fl, size);
-            if (text == NULL) 
-            {
-                isBad = 1;
-                fprintf (stderr, "Line %d: Invalid CLEANUP section.\n", ln_count);
-                break;
-            }
-            
-            free(*pstrCleanup);
-            *pstrCleanup = strdup(text);
-            
-            break;
-        case ITOP_BLOCK:
-            // Parse attributes, extract PCF name (if present).
-            if (!t2c_parse_attributes(attribs, bl_attr_name, bl_attr_val))
-            {
-                isBad = 1;
-                fprintf (stderr, "Line %d: Invalid attribute specification for <BLOCK> section.\n", ln_count);
-                break;
-            }
-            
-            if (bl_attr_val[0])
-            {
-                pcf_name = bl_attr_val[0];
-                bl_attr_val[0] = NULL;
-            }
-            else
-            {
-                pcf_name = strdup("NULL");
-            }
-            
-            if (bl_attr_val[1])
-            {
-                lsb_min_ver = bl_attr_val[1];
-                bl_attr_val[1] = NULL;
-            }
-            else
+            if (!changes.bRegen)
             {
-                lsb_min_ver = strdup("NULL");
+                continue;
             }
             
-            if (bl_attr_val[2])
-            {
-                lsb_max_ver = bl_attr_val[2];
-                bl_attr_val[2] = NULL;
+            t_start = stats_time ();
+            if (changes.bTemplates)
+            {   // they will be read again when needed
+                tpl_registry_free (&tpl_registry);
             }
-            else
+            if (changes.bGroups)
             {
-                lsb_max_ver = strdup("NULL");
+                watch_groups (&w, input_path);
             }
             
-            free(text);
-            
-            int ln_beg = ln_count;
-            text = parse_block(fl, size, purpose_tpl, purposes_number, pcf_funcs, pcf_name, lsb_min_ver, lsb_max_ver);
-    
-    		free (lsb_max_ver);
-    		free (lsb_min_ver);
-            free(pcf_name);
-            
-            if (text == NULL) 
-            {
-                isBad = 1;
-                fprintf (stderr, 
-                    "Line %d: The BLOCK section that begins at line %d is invalid.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
- 
-            *pstrPurposes = str_append(*pstrPurposes, text);
- 
-            ++nBlocks;
-            break;
-        default:
-            fprintf(stderr, "Line %d: parseFile(): t2c_parse_open_tag() returned invalid index: %d.\n", 
-                ln_count, tag_num);
-            isBad = 1;
-            break;
-        }
-        
-        if (isBad) 
-        {
-            break;
+            printf ("\nThe sources have changed, regenerating the tests.\n");
+            run_generator (suite_root_in, input_dir, output_dir, scen_dir);
+            printf ("Done in %.3f s.\n", stats_time () - t_start);
+            fflush (stdout);
         }
     }
-    while (!feof(fl) && !ferror(fl));
-
-    free(str);
-    fclose(fl);
-    free(text);
     
-    int i;
-    for (i = 0; i < sizeof(bl_attr_val)/sizeof(bl_attr_val[0]) - 1; ++i)
-    {
-        free(bl_attr_val[i]);
-    }
-
-    free(attribs);
-    return ((!isBad) && (nBlocks > 0));
+    watcher_close (&w);
+    free (suite_root);
+    free (input_path);
+    free (tpl_dir);
+    free (smk_path);
+    free (smk_dir);
 }
 
-static char*
-parse_global(FILE* fl, int size)
+/*
+ * Read the templates for the tests group, create the directory where 
+ * the tests and makefiles will be placed and add a job for each input 
+ * file from group_path to the list.
+ */
+static TGenGroup* 
+add_tests_group (TGenJobList* jl, const TDirList* in_list, 
+                 const char* group_path, const char* group_nme)
 {
-    char* str = NULL;
-    char* text = NULL;
-    int isBad = 0;
-
-    if (!fl)
-    {
-        return NULL;
-    }
-
-    if (feof(fl) || ferror(fl))
-    {
-        return NULL;
-    }
+    TDirList gl;
+    char* tpl_path = NULL;
+    int bOwnTestTpl = 0;
+    int bOwnPurposeTpl = 0;
+    size_t ext_len = strlen (INPUT_EXT);
+    int i;
 
-    text = strdup("");
-    str = alloc_mem_for_string (str, size + 1);
+    TGenGroup* group = NULL;
+    
+    group = (TGenGroup*)alloc_mem(group, 1, sizeof(TGenGroup));
+    group->group_path = strdup(group_path);
+    group->group_nme  = strdup(group_nme);
     
-    int close_tag_found = 0;
-    do
+    /* read the group directory. The templates of the group and the makefile
+     * templates of the tests are looked for in this list rather than on disk,
+     * one file at a time. */
+    if (!dir_list_open (&gl, in_list, group_nme))
     {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
+        error_with_exit_code(EXIT_CODE_CANT_OPEN_DIR,
+                             "%s: can't open directory %s", "test generator", 
+                             group_path);
+    } 
 
-        if (t2c_parse_close_tag(str, top_tag[ITOP_GLOBAL]))
-        {
-            close_tag_found = 1;
-            break;
-        }
-        else
-        {
-            text = str_append(text, str);
-        }
-    }
-    while (!feof(fl) && !ferror(fl));
+    bOwnTestTpl = (dir_list_find (&gl, COMMON_TEST_TPL) != NULL);
+    bOwnPurposeTpl = (dir_list_find (&gl, COMMON_PURPOSE_TPL) != NULL);
     
-    if (!close_tag_found)
-    {
-        fprintf (stderr, "Line %d: No close tag found for GLOBAL section.\n", ln_count);
-        isBad = 1;
-    }
+    /* the templates are shared by all the groups that use them, 
+     * each is read and compiled only once */
+    tpl_path = bOwnTestTpl ? str_sum (group_path, COMMON_TEST_TPL) : 
+                             default_tpl_path (COMMON_TEST_TPL);
+    group->test_tpl = load_template (tpl_path, T2CGEN_TPL_TEST);
+    free (tpl_path);
     
-    free(str);
-    if (isBad && text)
-    {
-        free(text);
-    }
-
-    return ((isBad) ? NULL : text);
-}
-
-static char*
-parse_startup(FILE* fl, int size)
-{
-    char* str = NULL;
-    char* text = NULL;
-    int isBad = 0;
-
-    if (!fl)
+    tpl_path = bOwnPurposeTpl ? concat_paths ((char*) group_path, COMMON_PURPOSE_TPL) : 
+                                default_tpl_path (COMMON_PURPOSE_TPL);
+    group->purpose_tpl = load_template (tpl_path, T2CGEN_TPL_PURPOSE);
+    free (tpl_path);
+    
+    group->part_tpl = NULL;
+    if (gen_cfg.nSplitPurposes > 0)
     {
-        return NULL;
+        tpl_path = (dir_list_find (&gl, COMMON_PART_TPL) != NULL) ? 
+                   str_sum (group_path, COMMON_PART_TPL) : 
+                   default_tpl_path (COMMON_PART_TPL);
+        group->part_tpl = load_template (tpl_path, T2CGEN_TPL_TEST);
+        free (tpl_path);
     }
-
-    if (feof(fl) || ferror(fl))
+    
+    group->tpl_hash = hash_string (hash_string (HASH_INIT, group->test_tpl->text), 
+                                   group->purpose_tpl->text);
+    if (group->part_tpl != NULL)
     {
-        return NULL;
+        group->tpl_hash = hash_string (group->tpl_hash, group->part_tpl->text);
     }
 
-    text = strdup("");
-    str = alloc_mem_for_string (str, size + 1);
-
-    int close_tag_found = 0;
-    do
+    for (i = 0; i < gl.nEntries; ++i)
     {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
-
-        if (t2c_parse_close_tag(str, top_tag[ITOP_STARTUP]))
+        const char* name = gl.sorted[i]->name;
+        char* ftest_nme = NULL;
+        char* tmk_nme = NULL;
+        TGenJob* job = NULL;
+        size_t len = strlen (name);
+        
+        if ((len < ext_len) || strcmp (name + len - ext_len, INPUT_EXT))
         {
-            close_tag_found = 1;
-            break;
+            continue;
         }
-        else
+        
+        ftest_nme = get_substr (name, 0, 
+                                strstr (name, INPUT_EXT) - (name + 1));
+        if (ftest_nme == NULL) 
         {
-            text = str_append(text, str);
+            continue;
         }
-    }
-    while (!feof(fl) && !ferror(fl));
-	
-	if (!close_tag_found)
-    {
-        fprintf (stderr, "Line %d: No close tag found for STARTUP section.\n", ln_count);
-        isBad = 1;
-    }    
-
-    free(str);
-    if (isBad && text)
-    {
-        free(text);
+        
+        jl->jobs = (TGenJob*)alloc_mem(jl->jobs, jl->nJobs + 1, sizeof(TGenJob));
+        job = &(jl->jobs[jl->nJobs++]);
+        
+        job->group = group;
+        job->input_path = str_sum(group_path, name);
+        job->ftest_nme = ftest_nme;
+        job->mk_tpl = NULL;
+        job->bOK = 0;
+        job->bCached = 0;
+        stats_init (&job->stats);
+        
+        // the makefile template for this test only, if there is one
+        tmk_nme = str_sum (ftest_nme, MAKEFILE_TPL_EXT);
+        if (dir_list_find (&gl, tmk_nme) != NULL)
+        {
+            char* tmk_path = str_sum (group_path, tmk_nme);
+            job->mk_tpl = load_template (tmk_path, T2CGEN_TPL_MAKEFILE);
+            free (tmk_path);
+        }
+        free (tmk_nme);
     }
 
-    return ((isBad) ? NULL : text);
+    dir_list_close (&gl);
+    return group;
 }
 
+/*
+ * Path to the default template 'name' ($T2C_ROOT/t2c/src/templates/name).
+ */
 static char*
-parse_cleanup(FILE* fl, int size)
+default_tpl_path (const char* name)
 {
-    char* str = NULL;
-    char* text = NULL;
-    int isBad = 0;
-
-    if (!fl)
-    {
-        return NULL;
-    }
-
-    if (feof(fl) || ferror(fl))
-    {
-        return NULL;
-    }
-
-    text = strdup("");
-    str = alloc_mem_for_string (str, size + 1);
+    char* tpl_path1 = NULL;
+    char* tpl_path2 = NULL;
+    char* tpl_path  = NULL;
 
-    int close_tag_found = 0;
-    do
-    {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
+    tpl_path1 = alloc_mem_for_string(tpl_path1, strlen(t2c_root)); 
+    tpl_path1 = str_append(tpl_path1, t2c_root);
+    tpl_path2 = concat_paths(tpl_path1, COMMON_TPL_DIR);
+    tpl_path = concat_paths(tpl_path2, (char*) name);
+    
+    free(tpl_path1);
+    free(tpl_path2);
+    return tpl_path;
+}
 
-        if (t2c_parse_close_tag(str, top_tag[ITOP_CLEANUP]))
-        {
-            close_tag_found = 1;
-            break;
-        }
-        else
-        {
-            text = str_append(text, str);
-        }
-    }
-    while (!feof(fl) && !ferror(fl));
+/*
+ * Get the template of the given kind (T2CGEN_TPL_*) from the registry 
+ * (see tpl_registry), NULL if the file cannot be read.
+ */
+static const TTemplate*
+get_template (const char* path, int kind)
+{
+    int nTags = 0;
+    char** tag_names = t2cgen_tpl_tags(kind, &nTags);
     
-    if (!close_tag_found)
-    {
-        fprintf (stderr, "Line %d: No close tag found for CLEANUP section.\n", ln_count);
-        isBad = 1;
-    }
+    return tpl_registry_get(&tpl_registry, path, tag_names, nTags, 0);
+}
 
-    free(str);
-    if (isBad && text)
+/*
+ * Same as get_template() but exit if the file cannot be read.
+ */
+static const TTemplate*
+load_template (const char* path, int kind)
+{
+    const TTemplate* tpl = get_template(path, kind);
+    
+    if (tpl == NULL)
     {
-        free(text);
+        error_with_exit_code(EXIT_CODE_CANT_OPEN_FILE,
+                             "%s: can't open file %s", "test generator", path);
     }
-
-    return ((isBad) ? NULL : text);
+    return tpl;
 }
 
-static char*
-parse_block(FILE* fl, int size, const char* purpose_tpl, int* purposes_number,
-            char** pcf_funcs, const char* pcf_name, const char *lsb_min_ver, const char *lsb_max_ver)
+static void
+gen_test_job (TGenJob* job, const char* suite_root, const char* output_dir,
+              const TDirList* out_list)
 {
-
-    char* str = NULL;
-    char* str_t = NULL;    
-    char* text = NULL;
-    int isBad = 0;
+    char* ftest_src = NULL;
+    char* output_path = NULL;
+    const TTemplate* makefile_tpl = NULL;
+    TGenTest test;
+    const char* input_path = job->input_path;
+    const char* ftest_nme = job->ftest_nme;
+    const TDirEntry* out_entry = NULL;
+    int split = 0;
     
-    char* targets[MAX_TARGETS_NUM];            
-
-    int nTargets = 0;    
-
-    int isCodeFound = 0;
-    int isEndFound = 0;
-    int isDefineFound = 0;
-    int isTargetFound = 0;
-    int isPurposeFound = 0;
-
-    char* templ = NULL;
-    char* finally_code = NULL;
-    char* tag_values[TAGS_NUM];
+    TGenContext ctx;
+    TSrcFile src;
+    double t_start;
+    int bOK;
     
-    int i = 0;
-    int ln_beg = ln_count;
-        
-    if (!fl)
-    {
-        return NULL;
+    t2cgen_context_init (&ctx, &gen_cfg, &src, &job->stats);
+    
+    job->bOK = 0;
+    
+    if (job->mk_tpl != NULL)
+    {   // template makefile exists, so we use it
+        makefile_tpl = job->mk_tpl;
     }
-
-    if (feof(fl) || ferror(fl))
+    else if (subsuite_mk_tpl != NULL)
     {
-        return NULL;
+        makefile_tpl = subsuite_mk_tpl;
     }
-    
-    for (i = 0; i < MAX_TARGETS_NUM; ++i)
-    {
-        targets[i] = NULL;
+    else
+    {   // template makefiles do not exist, so we use the default one
+        makefile_tpl = def_mk_tpl;
     }
     
-    for (i = 0; i < TAGS_NUM; ++i)
+    output_path = t2cgen_test_dir_path (output_dir, ftest_nme);
+    ftest_src = t2cgen_file_name (&gen_cfg, ftest_nme, 0);
+    
+    if (is_test_up_to_date(job, makefile_tpl, out_list, ftest_src))
     {
-        tag_values[i] = NULL;
+        job->bOK = 1;
+        job->bCached = 1;
+        ++job->stats.nCached;
+        free (ftest_src);
+        free (output_path);	
+        return;
     }
-    tag_values[PURPNUM_TAG_POS] = strdup("<%purpose_number%>"); /* to be replaced with itself */
-    tag_values[COMMENT_TAG_POS] = strdup("// Target interfaces:\n");
-    tag_values[TARGETS_TAG_POS] = strdup("Target interface(s):\\n");
     
-    if (strcmp (lsb_min_ver, STRING_NULL) == 0)
+    /* the .t2c-file is read only once, both the header and the rest 
+     * of the file are parsed from memory */
+    t_start = stats_time();
+    if (!src_open(&src, input_path))        
     {
-    	tag_values[LSB_MIN_VER_POS] = strdup (lsb_min_ver);
-		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_SEMICOLON);
+        fprintf (stderr, "warning: invalid header in %s\n", input_path);
+        free (ftest_src);
+        free (output_path);	
+        return;
     }
-	else
-	{
-    	tag_values[LSB_MIN_VER_POS] = strdup (STRING_APOSTR);
-		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], lsb_min_ver);
-		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_APOSTR);
-		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_SEMICOLON);
-	}
     
-    if (strcmp (lsb_max_ver, STRING_NULL) == 0)
+    /* parse header of the .t2c-file here */
+    t2cgen_parse_header(&ctx);
+    job->stats.bytes_in += (long long)src.size;
+    job->stats.phase_time[PHASE_HEADER] += stats_time() - t_start;
+    
+    /* the test is split only if its makefiles know about the parts */
+    if ((job->group->part_tpl != NULL) && 
+        tpl_has_tag(makefile_tpl, T2CGEN_MK_PARTS_POS) &&
+        (!has_flat_rules(job) || tpl_has_tag(flat_mk_tpl, T2CGEN_MK_PARTS_POS)))
     {
-    	tag_values[LSB_MAX_VER_POS] = strdup (lsb_max_ver);
-		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_SEMICOLON);
+        split = gen_cfg.nSplitPurposes;
     }
-	else
-	{
-    	tag_values[LSB_MAX_VER_POS] = strdup (STRING_APOSTR);
-		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], lsb_max_ver);
-		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_APOSTR);
-		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_SEMICOLON);
-	}
     
-    text = strdup("");
-    finally_code = strdup("");
-    str = alloc_mem_for_string(str, size + 1);
-
-    char * comment = NULL;
-    char* purp = NULL;
-
-    do
+    /* generate the test */
+    bOK = t2cgen_prepare (&ctx, job->group->purpose_tpl, input_path, 
+                          job->group->group_nme, ftest_nme, split, &test);
+    src_close(&src);
+                     
+    if (!bOK)
     {
-        int old_purp_num = 0;
-        fgets_and_skip_comments(str, size, fl, &ln_count);
-        
-        if (t2c_parse_close_tag(str, top_tag[ITOP_BLOCK]))
-        {
-        	
-            if (!isCodeFound)
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: No CODE section is specified in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            if (!isPurposeFound) // no purpose found => assume there is one with no parameters.
-            {
-                if (!templ)
-                {
-                    isBad = 1;
-                    fprintf(stderr, 
-                        "Line %d: Code template is invalid in the BLOCK beginning at line %d.\n",
-                        ln_count, ln_beg);
-                    break;
-                }
-                
-                char* purp = strdup (templ);
-                char strTmp[16] = "";
-                
-                ++(*purposes_number);
-                                        
-                isPurposeFound = 1;
-
-                purp = replace_all_substr_in_string (purp, "<%params%>", "//    none\n");
-                
-                sprintf (strTmp, "%d", *purposes_number);
-                purp = replace_all_substr_in_string (purp, tags[PURPNUM_TAG_POS], strTmp);
-                
-                purp = replace_all_substr_in_string (purp, TAG_FINALLY_NAME, finally_code);
-                
-                text = str_append (text, purp);
-                free (purp); 
-                
-                // add a proper item to the array of parent control func ptrs
-                *pcf_funcs = str_append(*pcf_funcs, "    ");
-                *pcf_funcs = str_append(*pcf_funcs, pcf_name);
-                *pcf_funcs = str_append(*pcf_funcs, ",\n"); 
-            }
-
-            /* End of the block */
-            isEndFound = 1;
-
-            break;            
-        }
-        
-        // Parse block-level tags.
-        int tag_num = t2c_parse_open_tag(str, bl_tag, NULL);
-        switch (tag_num)
-        {
-        case -1:    // not a tag
-            break;   
-        case IBL_TARGETS:
-            isTargetFound = 1;
-            
-            isBad = !parse_targets(fl, size, targets, &nTargets);
-            if (isBad)
-            {
-                fprintf(stderr, 
-                    "Line %d: Invalid TARGET section in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            for (i = 0; i < nTargets; ++i)
-            {
-                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "//    ");
-                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], targets[i]);
-                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "\n");
-                
-                replace_char(targets[i], '\n', ' ');
-                replace_char(targets[i], '\r', ' ');
-                replace_char(targets[i], '\"', ' ');
-    
-                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], "    ");
-                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], targets[i]);
-                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], "\\n");
-            }
-            tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "//");
-
-            tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], 
-                "\n// Parameters:\n<%params%>");
-
-            break;
-        case IBL_DEFINE:
-            if (isDefineFound)
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: Multiple DEFINE sections found in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            isDefineFound = 1;
-            
-            isBad = !parse_defines(fl, size, 
-                &(tag_values[DEFINE_TAG_POS]), &(tag_values[UNDEF_TAG_POS]));
-            if (isBad)
-            {
-                fprintf(stderr, 
-                    "Line %d: Invalid DEFINE section in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            break;
-        case IBL_FINALLY:
-            free (finally_code);
-            finally_code = parse_finally (fl, size);
-            
-            if (!finally_code)
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: Invalid FINALLY section found in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-            
-            break;
-        case IBL_CODE:
-            if (!isTargetFound || (nTargets == 0))
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: No target interfaces are specified in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            if (isCodeFound)
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: Multiple CODE sections found in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-            
-            isCodeFound = 1;
-
-            if (tag_values[DEFINE_TAG_POS] == NULL)
-            {
-                tag_values[DEFINE_TAG_POS] = strdup ("");
-            }
-
-            if (tag_values[UNDEF_TAG_POS] == NULL)
-            {
-                tag_values[UNDEF_TAG_POS] = strdup ("");
-            }
-
-            tag_values[CODE_TAG_POS] = parse_code (fl, size);
-
-            if (tag_values[CODE_TAG_POS] == NULL)
-            {
-                isBad = 1;
-                fprintf(stderr, 
-                    "Line %d: The CODE section is invalid in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            /************************************************************************/
-            /* Generate purpose template with comments, defines, undefs, code, and  */
-            /* a 'finally' section.                                                 */
-            /************************************************************************/
-            templ = strdup (purpose_tpl);
-            for (i = 0; i < TAGS_NUM; ++i)
-            {
-                templ = replace_all_substr_in_string (templ, tags[i], tag_values[i]);
-            }
-            break;
-        case IBL_PURPOSE:
-            if (!isCodeFound)
-            {
-                isBad = 1;
-                fprintf (stderr, 
-                    "Line %d: Found PURPOSE section before CODE section in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-            
-            isPurposeFound = 1;
-            
-            old_purp_num = *purposes_number;
-            purp = parse_purpose(fl, size, templ, finally_code, purposes_number);
-            
-            // add proper items to the array of parent control func ptrs
-            // (the same for all newly parsed test purposes)
-            for (i = old_purp_num; i < *purposes_number; ++i)
-            {
-                *pcf_funcs = str_append(*pcf_funcs, "    ");
-                *pcf_funcs = str_append(*pcf_funcs, pcf_name);
-                *pcf_funcs = str_append(*pcf_funcs, ",\n");
-            }
-
-            if (purp == NULL)
-            {
-                isBad = 1;
-                fprintf (stderr, 
-                    "Line %d: Invalid PURPOSE section found in the BLOCK beginning at line %d.\n", 
-                    ln_count, ln_beg);
-                break;
-            }
-
-            text = str_append(text, purp);
-            free(purp);
-            
-            break;
-        default:
-            fprintf(stderr, 
-                "Line %d: parseBlock(): t2c_parse_open_tag() returned invalid index: %d.\n",
-                ln_count, tag_num);
-            isBad = 1;
-            break;        
-        }
-        if (isBad) 
-        {
-            break;
-        }
+        fprintf (stderr, "Test generator is unable to generate test for %s\n", input_path);
+        t2cgen_free_test (&test);
+        t2cgen_context_free (&ctx);
+        free (ftest_src);
+        free (output_path);	
+        return;
     }
-    while (!feof(fl) && !ferror(fl));
 
-    if (!isEndFound)
+    t_start = stats_time();
+    out_entry = dir_list_find (out_list, ftest_nme);
+    if (((out_entry == NULL) || (out_entry->type != FS_TYPE_DIR)) &&
+        !dir_list_mkdir (out_list, ftest_nme))
     {
-        fprintf(stderr, "Line %d: End of the BLOCK that begins at line %d is not found.\n", 
-            ln_count, ln_beg);
-        isBad = 1;
+        error_with_exit_code (EXIT_CODE_CANT_MKDIR,
+                              "%s: can't create a directory: %s", 
+                              "test generator", output_path);
     }
 
-    free(str);
-    free(templ);
-    free(finally_code);
-    for (i = 0; i < TAGS_NUM; ++i)
+    gen_makefile(&ctx, suite_root, output_path, ftest_nme, makefile_tpl, 
+                 "Makefile", test.nParts);
+    if (has_flat_rules(job))
     {
-        free(tag_values[i]);
+        gen_makefile(&ctx, suite_root, output_path, ftest_nme, flat_mk_tpl, 
+                     FLAT_MAKEFILE_RULES, test.nParts);
     }
     
-    for (i = 0; i < nTargets; ++i)
-    {
-        free(targets[i]);
-    }
+    bOK = t2cgen_write_files (&gen_cfg, &test, job->group->test_tpl, 
+                              job->group->part_tpl, output_path, ftest_nme, &job->stats);
     
-    if (isBad)
+    if (bOK)
     {
-        free(text);
+        job->bOK = 1;
+        ++job->stats.nFiles;
     }
-
-    return ((isBad) ? NULL : text);
+    job->stats.phase_time[PHASE_OUTPUT] += stats_time() - t_start;
+    
+    t2cgen_free_test (&test);
+    t2cgen_context_free (&ctx);
+    free (ftest_src);
+    free (output_path);	
 }
 
 static int
-parse_targets(FILE* fl, int size, char** pstrTargets, int* pnTargets)
+is_test_up_to_date (TGenJob* job, const TTemplate* makefile_tpl, 
+                    const TDirList* out_list, const char* ftest_src)
 {
-    char* str = NULL;
-    char* str_t = NULL;
-    int isBad = 0;
-    int tmp = 0;
-
-    *pnTargets = 0;
-
-    if (!fl)
+    struct stat st;
+    const TDirEntry* out_entry = NULL;
+    char* path = NULL;
+    int bExists;
+    THash env_hash = hash_string (hash_string (hash_data (cfg_hash, 
+        &job->group->tpl_hash, sizeof (THash)), makefile_tpl->text), job->ftest_nme);
+    
+    if (!gen_cache_check ((bUseCache ? &gen_cache : NULL), job->input_path, 
+                          env_hash, &job->rec))
     {
         return 0;
     }
-
-    if (feof(fl) || ferror(fl))
+    
+    // The generated files must still be there. The output directory has
+    // been read already, so there is nothing to check if the directory of
+    // the test is not in it.
+    out_entry = dir_list_find (out_list, job->ftest_nme);
+    if ((out_entry == NULL) || (out_entry->type != FS_TYPE_DIR))
     {
         return 0;
     }
-
-    str = alloc_mem_for_string (str, size + 1);
-
-    int close_tag_found = 0;
-    do
+    
+    path = concat_paths ((char*) job->ftest_nme, (char*) ftest_src);
+    bExists = dir_list_stat (out_list, path, &st) && S_ISREG (st.st_mode);
+    free (path);
+    
+    if (bExists)
     {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
-        str_t = trim_with_nl (str);
+        path = concat_paths ((char*) job->ftest_nme, "Makefile");
+        bExists = dir_list_stat (out_list, path, &st) && S_ISREG (st.st_mode);
+        free (path);
+    }
+    
+    if (bExists && has_flat_rules(job))
+    {
+        path = concat_paths ((char*) job->ftest_nme, FLAT_MAKEFILE_RULES);
+        bExists = dir_list_stat (out_list, path, &st) && S_ISREG (st.st_mode);
+        free (path);
+    }
+    
+    return bExists;
+}
 
-        if (t2c_parse_close_tag(str, bl_tag[IBL_TARGETS]))
+/*
+ * The year written to the tests is the one specified in the config file 
+ * (YEAR) if any. Otherwise, it is the year of the time in SOURCE_DATE_EPOCH 
+ * environment variable (seconds since the Epoch, UTC) if it is set, so that 
+ * the generated files can be reproduced exactly, or the current year. 
+ */
+static void
+init_gen_year ()
+{
+    struct tm ltime;
+    time_t tsec;
+    const char* epoch = getenv("SOURCE_DATE_EPOCH");
+    char* end = NULL;
+    int year = 2007;
+    
+    if (atoi(cfg_parm_values[CFG_YEAR_POS]) > 0)
+    {
+        year = atoi(cfg_parm_values[CFG_YEAR_POS]);
+    }
+    else if ((epoch != NULL) && (epoch[0] != '\0'))
+    {
+        tsec = (time_t)strtoll(epoch, &end, 10);
+        if ((*end == '\0') && (gmtime_r(&tsec, &ltime) != NULL))
         {
-            close_tag_found = 1;
-            break;
+            year = ltime.tm_year + 1900;
         }
         else
         {
-            if (strlen(str_t) > 0)
-            {
-                
-                if (*pnTargets >= MAX_TARGETS_NUM-1)
-                {
-                    fprintf(stderr, "Line %d: Too many target interfaces in a single BLOCK.\n",
-                        ln_count);
-                    break;
-                }
-
-                pstrTargets[*pnTargets] = strdup(str_t);
-                ++(*pnTargets);
-            }
+            fprintf(stderr, "Invalid value of SOURCE_DATE_EPOCH: %s\n", epoch);
         }
     }
-    while (!feof(fl) && !ferror(fl));
-    if (!close_tag_found)
+    else
     {
-        fprintf (stderr, "Line %d: No close tag found for TARGETS section.\n", ln_count);
-        isBad = 1;
+        tsec = time(NULL);
+        if (localtime_r(&tsec, &ltime) != NULL)
+        {
+            year = ltime.tm_year + 1900;
+        }
     }
-    
-    free(str);
-
-    return (!isBad);
+    sprintf(gen_year, "%d", year);
 }
 
-static int
-parse_defines(FILE* fl, int size, char** pstrDefines, char** pstrUndefs)
+static void
+calc_cfg_hash (const char* suite_root, const char* output_dir)
 {
-    char* str = NULL;
-    char* str_t = NULL;
-    int isBad = 0;
-
-    if (!fl)
+    char str[32];
+    THash exe_hash;
+    int i;
+    
+    cfg_hash = t2cgen_settings_hash (&gen_cfg);
+    
+    sprintf (str, "%d", GEN_CACHE_VERSION);
+    cfg_hash = hash_string (cfg_hash, str);
+    
+    // A rebuilt generator regenerates the tests too even if T2CGEN_VERSION
+    // has not been increased. The templates are hashed with each group.
+    if (hash_file ("/proc/self/exe", &exe_hash))
     {
-        return 0;
+        cfg_hash = hash_data (cfg_hash, &exe_hash, sizeof (THash));
     }
-
-    if (feof(fl) || ferror(fl))
+    
+    for (i = 0; i < CFG_PARAMS; ++i)
     {
-        return 0;
+        cfg_hash = hash_string (cfg_hash, cfg_parm_values[i]);
+    }
+    
+    if (flat_mk_tpl != NULL)
+    {
+        cfg_hash = hash_string (cfg_hash, flat_mk_tpl->text);
     }
+    
+    cfg_hash = hash_string (cfg_hash, suite_root);
+    cfg_hash = hash_string (cfg_hash, output_dir);
+}
 
-    *pstrDefines = strdup("");
-    *pstrUndefs = strdup("");
-    str = alloc_mem_for_string(str, size + 1);
+static void
+report_parse (const char* input_path)
+{
+    printf ("Parsing file %s\n", input_path);
+}
 
-    int close_tag_found = 0;
-    do
+static void*
+gen_worker (void* arg)
+{
+    TGenJobList* jl = (TGenJobList*)arg;
+    
+    for (;;)
     {
-        fgets_and_skip_comments(str, size, fl, &ln_count);
-        if (t2c_parse_close_tag(str, bl_tag[IBL_DEFINE]))
+        TGenJob* job = NULL;
+        
+        pthread_mutex_lock(&jl->lock);
+        if (jl->nNext < jl->nJobs)
         {
-            close_tag_found = 1;
-            break;
+            job = &(jl->jobs[jl->nNext++]);
         }
-        else
+        pthread_mutex_unlock(&jl->lock);
+        
+        if (job == NULL)
         {
-            str_t = trim(str);
-            *pstrDefines = str_append(*pstrDefines, str_t);
-
-            if (strstr (str, "#define"))
-            {
-                char* delims = " \t\n\r";    
-                char* token = NULL;
-
-                token = strtok(str, delims); /* to #define */
-                token = strtok(NULL, delims); /* to NAME */
-
-                if (token == NULL)
-                {
-                    fprintf(stderr, "Line %d: Invalid #define directive.\n", ln_count);
-                    isBad = 1;
-                    break;
-                }
-                
-                char* bpos = strchr(token, '(');
-                if (bpos != NULL)
-                {
-                    *bpos = 0;
-                }
-                
-                *pstrUndefs = str_append(*pstrUndefs, "#undef ");
-                *pstrUndefs = str_append(*pstrUndefs, token);
-                *pstrUndefs = str_append(*pstrUndefs, "\n");
-            }
+            break;
         }
+        gen_test_job(job, jl->suite_root, jl->output_dir, jl->out_list);
     }
-    while (!feof(fl) && !ferror(fl));
-    
-    if (!close_tag_found)
-    {
-        fprintf (stderr, "Line %d: No close tag found for DEFINE section.\n", ln_count);
-        isBad = 1;
-    }
-    
-    free (str);
-
-    return (!isBad);
+    return NULL;
 }
 
-static char*
-parse_code(FILE* fl, int size)
+static void
+run_jobs (TGenJobList* jl, int nworkers)
 {
-    char* str = NULL;
-    int isBad = 0;
-    char* text = NULL;
-
-    if (!fl)
+    pthread_t* workers = NULL;
+    int nStarted = 0;
+    int i;
+    
+    if (nworkers > jl->nJobs)
     {
-        return NULL;
+        nworkers = jl->nJobs;
     }
-
-    if (feof(fl) || ferror(fl))
+    
+    if (nworkers <= 1)
     {
-        return NULL;
+        gen_worker(jl);
+        return;
     }
-
-    text = strdup ("");
-    str = alloc_mem_for_string (str, size + 1);
-
-    int close_tag_found = 0;
-    do
+    
+    workers = (pthread_t*)alloc_mem(workers, nworkers, sizeof(pthread_t));
+    for (i = 0; i < nworkers; ++i)
     {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
-
-        if (t2c_parse_close_tag(str, bl_tag[IBL_CODE]))
+        if (pthread_create(&workers[nStarted], NULL, gen_worker, jl) != 0)
         {
-            close_tag_found = 1;
+            fprintf(stderr, "Unable to start worker thread #%d, continuing with %d thread(s).\n", 
+                i + 1, nStarted);
             break;
         }
-        else
-        {
-            text = str_append (text, str);
-        }
+        ++nStarted;
+    }
+    
+    // If no threads could be started, do all the work here.
+    if (nStarted == 0)
+    {
+        gen_worker(jl);
     }
-    while (!feof(fl) && !ferror(fl));
     
-    if (!close_tag_found)
+    for (i = 0; i < nStarted; ++i)
     {
-        fprintf (stderr, "Line %d: No close tag found for CODE section.\n", ln_count);
-        isBad = 1;
+        pthread_join(workers[i], NULL);
     }
+    free(workers);
+}
 
-    free(str);
+/*
+ * Returns nonzero if the TET scen file (opened for reading) already has 
+ * the record including the scenario file 'scen_path'.
+ */
+static int
+is_scen_included (FILE* sf, const char* scen_path)
+{
+    char* data = read_file_to_string (sf);
+    char* record = str_sum ("\t:include:", scen_path);
+    char* p = NULL;
+    int res = 0;
     
-    if (isBad)
+    record = str_append (record, "\n");
+    if (data != NULL)
     {
-        free (text);
-        return NULL;
+        p = strstr (data, record);
+    }
+    for (; (p != NULL) && !res; p = strstr (p + 1, record))
+    {
+        res = (p == data) || (p[-1] == '\n');
     }
     
-    return text;
+    free (record);
+    free (data);
+    return res;
 }
 
-static char*
-parse_finally (FILE* fl, int size)
+/*
+ *   Adds a record for the test to the TET scen file
+ */
+static void 
+add_test_in_scen (const char* suite_root, FILE* sf, 
+                  const char* output_dir, const char* ftest_nme)
 {
-    char* str = NULL;
-    int isBad = 0;
-    char* text = NULL;
+    char* scen_item = NULL;
 
-    if (!fl)
+    if ( !sf || !output_dir || !ftest_nme)
     {
-        return NULL;
+        return;
     }
 
-    if (feof(fl) || ferror(fl))
-    {
-        return NULL;
-    }
+    scen_item = t2cgen_scen_record (suite_root, output_dir, ftest_nme);
+    fputs (scen_item, sf);
+    free (scen_item);
+}
+
+static int
+has_flat_rules (const TGenJob* job)
+{
+    return (flat_mk_tpl != NULL) && (job->mk_tpl == NULL) && 
+           (subsuite_mk_tpl == NULL);
+}
 
-    text = strdup ("");
-    str = alloc_mem_for_string (str, size + 1);
+/*
+ * Write the list of the tests that have been generated successfully as the
+ * value of a make variable. If bFlat is nonzero, only the tests with the 
+ * rules in the non-recursive makefile are listed, otherwise - the rest.
+ */
+static void
+write_test_list (FILE* mf, const char* var_nme, const TGenJobList* jl, int bFlat)
+{
+    int i;
     
-    int close_tag_found = 0;
-    do
+    fprintf (mf, "%s =", var_nme);
+    for (i = 0; i < jl->nJobs; ++i)
     {
-        fgets_and_skip_comments (str, size, fl, &ln_count);
-
-        if (t2c_parse_close_tag(str, bl_tag[IBL_FINALLY]))
-        {
-            close_tag_found = 1;
-            break;
-        }
-        else
+        if (jl->jobs[i].bOK && (!has_flat_rules(&jl->jobs[i]) == !bFlat))
         {
-            text = str_append (text, str);
+            fprintf (mf, " \\\n\t%s", jl->jobs[i].ftest_nme);
         }
     }
-    while (!feof(fl) && !ferror(fl));
-    if (!close_tag_found)
-    {
-        fprintf (stderr, "Line %d: No close tag found for FINALLY section.\n", ln_count);
-        isBad = 1;
-    }
+    fprintf (mf, "\n\n");
+}
 
-    free(str);
+/*
+ * Write the non-recursive makefile for the tests (see "FLAT_MAKEFILE" option). 
+ * The rules for each test are in its directory (FLAT_MAKEFILE_RULES), so
+ * "make -j N" can build any N tests at once. The tests with their own 
+ * makefile templates are still built by their makefiles.
+ */
+static void
+write_flat_makefile (FILE* mf, const TGenJobList* jl)
+{
+    int i;
     
-    if (isBad)
+    fprintf (mf, "# The tests are built by this makefile rather than by the makefiles\n");
+    fprintf (mf, "# in their directories (FLAT_MAKEFILE = yes).\n\n");
+    
+    fprintf (mf, "include common.mk\n\n");
+    
+    // the default target, its prerequisites are defined below
+    fprintf (mf, "all:\n\n");
+    
+    write_test_list (mf, "TESTS", jl, 1);
+    write_test_list (mf, "SUBDIRS", jl, 0);
+    
+    for (i = 0; i < jl->nJobs; ++i)
     {
-        free (text);
-        return NULL;
+        if (jl->jobs[i].bOK && has_flat_rules(&jl->jobs[i]))
+        {
+            fprintf (mf, "include %s/%s\n", jl->jobs[i].ftest_nme, 
+                     FLAT_MAKEFILE_RULES);
+        }
     }
-    return text;
-}
+    fprintf (mf, "\n");
+    
+    fprintf (mf, "BUILDDIRS = $(SUBDIRS)\n");
+    fprintf (mf, "CLEANDIRS = $(addprefix _clean_,$(SUBDIRS))\n");
+    fprintf (mf, "STB_DIRS = $(addprefix _stb_,$(SUBDIRS)) \n\n");
 
-static char*
-parse_purpose(FILE* fl, int size, const char* templ, const char* finally_code, int* purposes_number)
-{
-    char* str = NULL;
-    char* str_t = NULL;
-    int isBad = 0;
-    char* text = NULL;
-    int i = 0;
-    int	j;
-    char *warning_text = NULL;           
-	TPurpose *purpose = NULL;
+    fprintf (mf, "all:    $(join $(addsuffix /,$(TESTS)),$(TESTS)) $(BUILDDIRS)\n\n");
 
-	purpose = (TPurpose *)alloc_mem (purpose, 2, sizeof (TPurpose));
-	purpose->nLines = 0;
-	warning_text = alloc_mem_for_string (warning_text, MAX_STRING_LEGTH);
+    fprintf (mf, "$(BUILDDIRS):\n");
+    fprintf (mf, "\t$(MAKE) -C $@\n\n");
 
-    if (!fl)
+    fprintf (mf, "clean: $(addprefix _clean_,$(TESTS)) $(CLEANDIRS)\n");
+    if (bPrecompiledHeader)
     {
-        return NULL;
+        fprintf (mf, "\trm -f $(PCH) $(DBG_PCH)\n");
     }
+    fprintf (mf, "\n");
+    fprintf (mf, "$(CLEANDIRS):\n");
+    fprintf (mf, "\t$(MAKE) -C $(subst _clean_,,$@) clean\n\n");
+    
+    fprintf (mf, "standalone: $(addprefix _stb_,$(TESTS)) $(STB_DIRS)\n\n");    
+    fprintf (mf, "$(STB_DIRS):\n");
+    fprintf (mf, "\t$(MAKE) -C $(subst _stb_,,$@) debug\n\n");
+
+    fprintf (mf, ".PHONY:    all $(BUILDDIRS) $(CLEANDIRS) clean standalone $(STB_DIRS)\n\n");
+}
+
+/*
+ * Generate a local makefile ('makefile_nme' in the directory of the test)
+ */
+static void 
+gen_makefile(TGenContext* ctx, const char* suite_root, const char* dir_path, const char* ftest_nme, const TTemplate* makefile_tpl,
+             const char* makefile_nme, int nParts)
+{
+    FILE* mf;
+    TOutFile mf_out;
+    char* makefile_path = NULL;
+    char* mf_str = NULL;
 
-    if (feof(fl) || ferror(fl))
+    makefile_path = concat_paths ((char*) dir_path, (char*) makefile_nme);
+    mf = out_file_open (&mf_out, makefile_path);
+
+    if (!mf)
     {
-        return NULL;
+        out_file_discard (&mf_out);
+        free (makefile_path);
+        fprintf(stderr, "Unable to create local makefile in %s\n", dir_path);
+        return;
     }
-
-    str = alloc_mem_for_string(str, size + 1);
     
-    int close_tag_found = 0;
-    do
+    mf_str = t2cgen_render_makefile(ctx, suite_root, dir_path, ftest_nme, 
+                                    makefile_tpl, nParts);
+    fputs(mf_str, mf);
+    free(mf_str);
+    
+    if (!out_file_commit (&mf_out))
     {
-        fgets_and_skip_comments(str, size, fl, &ln_count);
-        
-        if (t2c_parse_close_tag(str, bl_tag[IBL_PURPOSE]))
-        {
-            close_tag_found = 1;
-            free(text);
-            text = strdup(templ);
-            if (purpose->nLines == 0)
-            {
-			    ++(*purposes_number);   
-	            text = replace_all_substr_in_string(text, "<%params%>", "//    none\n");
-	            sprintf(str, "%d", *purposes_number);
-    	        text = replace_all_substr_in_string(text, tags[PURPNUM_TAG_POS], str);
-	            text = replace_all_substr_in_string(text, TAG_FINALLY_NAME, finally_code);
-    	        break;
-            }
-            
-			char 	*text1 = NULL;
-			int 	*purp_num = NULL;
-			long 	*purp_array = NULL;
-
-			purp_array = alloc_mem (purp_array, MAX_LINES, sizeof (long));
-			purp_num = alloc_mem (purp_num, 2, sizeof (int));
-			*purp_num = 1;
-			text1 = strdup (text);
-	
-			parameter_and_text_generator (purpose, &text, text1, finally_code, purp_array, *purposes_number, 0, purp_num);
-
-			*purposes_number += *purp_num - 1;	
-
-			free (text1);
-			free (purp_num);
-			free (purp_array);
-            break;
-        }
-        else
-        {
-            str_t = trim_with_nl (str);
-            if (strlen(str_t) > 0)
-            {
-                if (purpose->nLines >= MAX_PARAMS_NUM)
-                {
-                    isBad = 1;
-                    fprintf (stderr, "Line %d: Too many parameters are specified for the test purpose.\n",
-                        ln_count);
-                    break;
-                }
-
-				purpose->Lines[purpose->nLines] = NULL;
-                purpose->Lines[purpose->nLines] = (TLine *)alloc_mem (purpose->Lines[purpose->nLines], 2, sizeof (TLine));
-                parse_purpose_line (str_t, purpose->Lines[purpose->nLines], &warning_text);                
-                purpose->nLines++;
-
-                if (strcmp (warning_text, WARNING_OK) != 0)
-                {
-                	fprintf (stderr, "Line %d: %s", ln_count, WARNING_PREFIX);
-                	fprintf (stderr, "%s\n", warning_text);
-                }
-            }
-        }
+        fprintf(stderr, "Unable to write %s\n", makefile_path);
     }
-    while (!feof(fl) && !ferror(fl));
+    free (makefile_path);
+}
+/*
+ * Write 'data' to the file unless the file already contains exactly that
+ * (see out_file_commit()). Returns 1 on success, 0 if the file could not be
+ * written.
+ */
+static int
+write_file_if_changed(const char* path, const char* data)
+{
+    TOutFile of;
+    FILE* fl = out_file_open(&of, path);
     
-    if (!close_tag_found)
+    if (fl == NULL)
     {
-        fprintf (stderr, "Line %d: No close tag found for PURPOSE section.\n", ln_count);
-        isBad = 1;
+        out_file_discard(&of);
+        return 0;
     }
-
-    free(str);
-    free(warning_text);
-    for (i = 0; i < purpose->nLines; i++)    
-    {
-    	for (j = 0; j < purpose->Lines[i]->nComponents; j++)
-    	{
-    		if (purpose->Lines[i]->Components[j]->Type == COMPONENT_TYPE_STRING)
-    		{
-    			free (purpose->Lines[i]->Components[j]->str);
-    		}
-    		free (purpose->Lines[i]->Components[j]);
-    	}
-    	free (purpose->Lines[i]);
-    }
-    free (purpose);
-    if (isBad)
-    {
-        free(text);
-        return NULL;
-    }
-    return text;
+    fputs(data, fl);
+    return out_file_commit(&of);
 }
 
+/*
+ * Generate the header to be precompiled (see PRECOMPILED_HEADER in the config 
+ * file): the headers test.tpl includes before the code of a test and the ones
+ * listed in PCH_HEADERS. The makefiles include it before anything else in the 
+ * tests (see common.tmk). The precompiled header is only valid with the flags 
+ * it was compiled with, so there is a copy of the header for the release 
+ * builds (<output_dir>/t2c_pch/release/) and one for the debug builds 
+ * (.../debug/). The files are not touched if they are up to date, so the 
+ * precompiled headers are not rebuilt each time the tests are generated.
+ */
 static void
-gen_tp_arrays(int number, char** pTetHooks, char** pTpFuncs)
+gen_pch_header(const char* output_dir_path)
 {
+    static const char* build_dirs[] = {"release", "debug"};
+    static const char* delims = " \t,";
+    TStrBuf hdr;
+    const char* header = cfg_parm_values[CFG_PCH_HEADERS_POS];
+    size_t len;
+    char* pch_dir = NULL;
+    char* dir = NULL;
+    char* path = NULL;
     int i;
-    char iStr[8]; 
-    
-    char* tet_hook_tpl = "    {tp_launcher, <%purpose_number%>},\n"; 
-    char* t2c_func_tpl = "    test_purpose_<%purpose_number%>,\n"; 
     
-    char* tstr = NULL;
+    strbuf_init(&hdr);
+    strbuf_append(&hdr, 
+        "// The header precompiled for the tests in this directory, they are compiled\n"
+        "// with \"-include <this header>\" (PRECOMPILED_HEADER = yes in the config file).\n"
+        "// This file was generated by the T2C system, do not edit it.\n\n"
+        "#include <errno.h>\n"
+        "#include <unistd.h>\n\n"
+        "#include <t2c_tet_support.h>\n"
+        "#include <t2c.h>\n");
     
-    *pTetHooks = strdup("");
-    *pTpFuncs = strdup("");
-    
-    for(i = 1; i <= number; ++i)
+    // The names are taken from the value of PCH_HEADERS in place.
+    header += strspn(header, delims);
+    if (*header != '\0')
+    {
+        strbuf_append(&hdr, "\n// PCH_HEADERS\n");
+    }
+    for (; *header != '\0'; header += strspn(header, delims))
     {
-        sprintf(iStr, "%d", i);
+        len = strcspn(header, delims);
         
-        tstr = strdup(tet_hook_tpl);
-        tstr = replace_all_substr_in_string(tstr, "<%purpose_number%>", iStr);
-        *pTetHooks = str_append(*pTetHooks, tstr);
-        free(tstr);
+        strbuf_append(&hdr, "#include ");
+        if ((header[0] == '<') || (header[0] == '\"'))
+        {
+            strbuf_append_n(&hdr, header, len);
+        }
+        else
+        {
+            strbuf_append_char(&hdr, '<');
+            strbuf_append_n(&hdr, header, len);
+            strbuf_append_char(&hdr, '>');
+        }
+        strbuf_append_char(&hdr, '\n');
+        header += len;
+    }
+    
+    pch_dir = concat_paths((char*)output_dir_path, PCH_DIR);
+    for (i = 0; i < 2; ++i)
+    {
+        dir = concat_paths(pch_dir, (char*)build_dirs[i]);
+        path = concat_paths(dir, PCH_HEADER);
         
-        tstr = strdup(t2c_func_tpl);
-        tstr = replace_all_substr_in_string(tstr, "<%purpose_number%>", iStr);
-        *pTpFuncs = str_append(*pTpFuncs, tstr);
-        free(tstr);
+        if ((!is_directory_exists(pch_dir) && (mkdir(pch_dir, S_IRWXU | S_IRWXG | S_IRWXO) != 0)) ||
+            (!is_directory_exists(dir) && (mkdir(dir, S_IRWXU | S_IRWXG | S_IRWXO) != 0)) ||
+            !write_file_if_changed(path, strbuf_str(&hdr)))
+        {
+            fprintf(stderr, "Unable to create the header to be precompiled: %s\n", path);
+        }
+        free(dir);
+        free(path);
     }
-    return;
+    free(pch_dir);
+    strbuf_free(&hdr);
 }
 
 static void 
-gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
+gen_common_makefile (const char* suite_root_path, const char* output_dir_path,
+                     const TGenJobList* jl)
 {
     char* common_mk_path = NULL;
     char* common_mk_data = NULL;
@@ -2407,62 +2109,46 @@ gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
     }
     fclose(tmk);
     
-    FILE* mf = NULL;   // common.mk
+    FILE* mf = NULL;
+    TOutFile mf_out;
 
     common_mk_path = str_sum(output_dir_path, "common.mk");
-        
-    mf = open_file(common_mk_path, "w", NULL);
 
-    if (!mf)
     {
-        free (common_mk_path);
-        free(tpl_path1);
-        free(tpl_path2);
-        free(tmk_path);
-        fprintf(stderr, "Unable to create common makefile in %s\n", output_dir_path);
-        return;
+        char* cmk_values[CMK_PARAM_NUM];
+        TTemplate* cmk_tpl = tpl_compile(common_mk_data, common_mk_params, CMK_PARAM_NUM, 0);
+        
+        cmk_values[CMK_DIR_PATH_POS] = test_dir;
+        cmk_values[CMK_COMPILER_POS] = cfg_parm_values[CFG_COMPILER_POS];
+        cmk_values[CMK_ADD_CFLAGS_POS] = cfg_parm_values[CFG_COMP_FLAGS_POS];
+        cmk_values[CMK_ADD_LFLAGS_POS] = cfg_parm_values[CFG_LINK_FLAGS_POS];
+        cmk_values[CMK_TEST_STD_FLAGS_POS] = (gen_cfg.bGenCpp ? "TEST_STD_CFLAGS_CPP" : "TEST_STD_CFLAGS_C");
+        cmk_values[CMK_TEST_FILE_EXT_POS] = (gen_cfg.bGenCpp ? "cpp" : "c");
+        cmk_values[CMK_SP_FLAG_POS] = (bSingleProcess ? "-DT2C_SINGLE_PROCESS" : "");
+        cmk_values[CMK_PCH_POS] = (bPrecompiledHeader ? "yes" : "no");
+        cmk_values[CMK_CONCURRENT_FLAG_POS] = concurrent_flag;
+        cmk_values[CMK_BATCH_FLAG_POS] = (bBatch ? "-DT2C_BATCH" : "");
+        cmk_values[CMK_KILL_WAIT_FLAG_POS] = kill_wait_flag;
+        
+        free(common_mk_data);
+        common_mk_data = tpl_render(cmk_tpl, cmk_values, NULL, 0);
+        tpl_free(cmk_tpl);
     }
-
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_DIR_PATH_POS],
-        test_dir);
-    
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_COMPILER_POS],
-        cfg_parm_values[CFG_COMPILER_POS]);
-    
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_ADD_CFLAGS_POS],
-        cfg_parm_values[CFG_COMP_FLAGS_POS]);
-
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_ADD_LFLAGS_POS],
-        cfg_parm_values[CFG_LINK_FLAGS_POS]);
-
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_TEST_STD_FLAGS_POS],
-        (bGenCpp ? "TEST_STD_CFLAGS_CPP" : "TEST_STD_CFLAGS_C"));
-
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_TEST_FILE_EXT_POS],
-        (bGenCpp ? "cpp" : "c"));
-
-    common_mk_data = replace_all_substr_in_string(
-        common_mk_data, 
-        common_mk_params[CMK_SP_FLAG_POS],
-        (bSingleProcess ? "-DT2C_SINGLE_PROCESS" : ""));
     
-    fputs(common_mk_data, mf);
+    // The makefiles of all the tests depend on common.mk, it is not 
+    // touched if it has not changed.
+    if (!write_file_if_changed(common_mk_path, common_mk_data))
+    {
+        fprintf(stderr, "Unable to create common makefile in %s\n", output_dir_path);
+    }
        
+    if (bPrecompiledHeader)
+    {
+        gen_pch_header(output_dir_path);
+    }
+    
     free(common_mk_path);
     free(common_mk_data);
-    fclose(mf);
     
     free(tpl_path1);
     free(tpl_path2);
@@ -2472,10 +2158,11 @@ gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
     // Generate main makefile (it will invoke makefiles in each subdir).
     main_mk_path = str_sum (output_dir_path, "Makefile");
 
-    mf = open_file (main_mk_path, "w", NULL);
+    mf = out_file_open (&mf_out, main_mk_path);
 
     if (!mf)
     {
+        out_file_discard (&mf_out);
         free (main_mk_path);
         free (path1);     
         free (path2);
@@ -2484,7 +2171,22 @@ gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
         return;
     }
 
-    fprintf (mf, "EXCLUDE = Makefile common.mk objs\n\n");
+    if (flat_mk_tpl != NULL)
+    {
+        write_flat_makefile (mf, jl);
+        
+        if (!out_file_commit (&mf_out))
+        {
+            fprintf(stderr, "Unable to write %s\n", main_mk_path);
+        }
+        free (main_mk_path);
+        free (path1);
+        free (path2);
+        free (suite_inc);   
+        return;
+    }
+
+    fprintf (mf, "EXCLUDE = Makefile common.mk objs %s\n\n", PCH_DIR);
 
     fprintf (mf, "SUBDIRS := $(filter-out $(EXCLUDE), $(wildcard *))\n");
     fprintf (mf, "BUILDDIRS = $(SUBDIRS)\n");
@@ -2493,10 +2195,24 @@ gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
 
     fprintf (mf, "all:    $(BUILDDIRS)\n\n");
 
+    if (bPrecompiledHeader)
+    {
+        // the precompiled headers are built before the tests rather than
+        // by the makefiles of several tests at the same time
+        fprintf (mf, "include common.mk\n\n");
+        fprintf (mf, "$(BUILDDIRS): $(PCH)\n");
+        fprintf (mf, "$(STB_DIRS): $(DBG_PCH)\n\n");
+    }
+
     fprintf (mf, "$(BUILDDIRS):\n");
     fprintf (mf, "\t$(MAKE) -C $@\n\n");
 
-    fprintf (mf, "clean: $(CLEANDIRS)\n\n");
+    fprintf (mf, "clean: $(CLEANDIRS)\n");
+    if (bPrecompiledHeader)
+    {
+        fprintf (mf, "\trm -f $(PCH) $(DBG_PCH)\n");
+    }
+    fprintf (mf, "\n");
     fprintf (mf, "$(CLEANDIRS):\n");
     fprintf (mf, "\t$(MAKE) -C $(subst _clean_,,$@) clean\n\n");
     
@@ -2506,9 +2222,12 @@ gen_common_makefile (const char* suite_root_path, const char* output_dir_path)
 
     fprintf (mf, ".PHONY:    all $(BUILDDIRS) $(CLEANDIRS) clean standalone $(STB_DIRS)\n\n");
 
+    if (!out_file_commit (&mf_out))
+    {
+        fprintf(stderr, "Unable to write %s\n", main_mk_path);
+    }
     free (main_mk_path);
 
-    fclose (mf);
     free (path1);
     free (path2);
     free (suite_inc);   
@@ -2523,6 +2242,7 @@ set_defaults ()
     {
         free(cfg_parm_values[i]);
     }
+    t2cgen_settings_init(&gen_cfg);
     
     cfg_parm_values[CFG_COMPILER_POS]   = (char *)strdup("gcc");
     cfg_parm_values[CFG_COMP_FLAGS_POS] = (char *)strdup("");
@@ -2532,6 +2252,15 @@ set_defaults ()
     cfg_parm_values[CFG_LANGUAGE_POS]   = (char *)strdup("C");
     cfg_parm_values[CFG_SINGLE_POS]     = (char *)strdup("no");
     cfg_parm_values[CFG_MK_TPL_POS]     = (char *)strdup("");
+    cfg_parm_values[CFG_PARAM_TABLES_POS] = (char *)strdup("no");
+    cfg_parm_values[CFG_FLAT_MK_POS]    = (char *)strdup("no");
+    cfg_parm_values[CFG_SPLIT_POS]      = (char *)strdup("0");
+    cfg_parm_values[CFG_PCH_POS]        = (char *)strdup("no");
+    cfg_parm_values[CFG_PCH_HEADERS_POS] = (char *)strdup("");
+    cfg_parm_values[CFG_YEAR_POS]       = (char *)strdup("");
+    cfg_parm_values[CFG_CONCURRENT_POS] = (char *)strdup("0");
+    cfg_parm_values[CFG_BATCH_POS]      = (char *)strdup("no");
+    cfg_parm_values[CFG_KILL_WAIT_POS]  = (char *)strdup("10");
 }
 
 static void
@@ -2573,7 +2302,7 @@ load_config(const char* fpath)
             bAddTetScenRecord = 0;
         }
         
-        int waittime = atoi(cfg_parm_values[CFG_WAIT_TIME_POS]);
+        int waittime = t2cgen_wait_time_ms(cfg_parm_values[CFG_WAIT_TIME_POS]);
         if (waittime == 0)
         {
             sprintf(cfg_parm_values[CFG_WAIT_TIME_POS], "0");
@@ -2582,7 +2311,7 @@ load_config(const char* fpath)
         if (!strcmp(cfg_parm_values[CFG_LANGUAGE_POS], "cpp") ||
             !strcmp(cfg_parm_values[CFG_LANGUAGE_POS], "CPP"))
         {
-            bGenCpp = 1;
+            gen_cfg.bGenCpp = 1;
         }
         
         if (!strcmp(cfg_parm_values[CFG_SINGLE_POS], "yes") ||
@@ -2591,6 +2320,39 @@ load_config(const char* fpath)
             bSingleProcess = 1;
         }
         
+        gen_cfg.bParamTables = (!strcmp(cfg_parm_values[CFG_PARAM_TABLES_POS], "yes") ||
+                                !strcmp(cfg_parm_values[CFG_PARAM_TABLES_POS], "YES"));
+        
+        bFlatMakefile = (!strcmp(cfg_parm_values[CFG_FLAT_MK_POS], "yes") ||
+                         !strcmp(cfg_parm_values[CFG_FLAT_MK_POS], "YES"));
+        
+        gen_cfg.nSplitPurposes = atoi(cfg_parm_values[CFG_SPLIT_POS]);
+        if (gen_cfg.nSplitPurposes < 0)
+        {
+            gen_cfg.nSplitPurposes = 0;
+        }
+        
+        bPrecompiledHeader = (!strcmp(cfg_parm_values[CFG_PCH_POS], "yes") ||
+                              !strcmp(cfg_parm_values[CFG_PCH_POS], "YES"));
+        
+        int concurrent = t2cgen_concurrency(cfg_parm_values[CFG_CONCURRENT_POS]);
+        concurrent_flag[0] = 0;
+        if (concurrent >= 0)
+        {
+            sprintf(concurrent_flag, "-DT2C_CONCURRENT_PURPOSES=%d", concurrent);
+        }
+        
+        bBatch = (!strcmp(cfg_parm_values[CFG_BATCH_POS], "yes") ||
+                  !strcmp(cfg_parm_values[CFG_BATCH_POS], "YES"));
+        
+        // 10 seconds is the default in t2c_tet_support (T2C_KILLWAIT).
+        int killwait = t2cgen_wait_time_ms(cfg_parm_values[CFG_KILL_WAIT_POS]);
+        kill_wait_flag[0] = 0;
+        if ((killwait > 0) && (killwait != 10000))
+        {
+            sprintf(kill_wait_flag, "-DT2C_KILL_WAIT_MS=%d", killwait);
+        }
+        
         fclose (fd);
         free (line);
     }
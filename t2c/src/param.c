@@ -1,15 +1,23 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../include/libmem.h"
+#include "../include/libfile.h"
 #include "../include/libstr.h"
 #include "../include/param.h"
+#include "../include/template.h"
 
 int
 char_in_string (const char c, const char *s)
 {
-    if (index (s, c))
+    if (strchr (s, c))
     {
         return TRUE;
     }
@@ -44,8 +52,79 @@ string_is_number (char *s)
 }
 
 void
-parse_purpose_line (const char *string, TLine *line, char **warning)
+purpose_init (TPurpose *purp)
+{
+    purp->nLines = 0;
+    purp->maxLines = 0;
+    purp->Lines = NULL;
+    purp->nComponents = 0;
+    purp->maxComponents = 0;
+    purp->Components = NULL;
+    strbuf_init (&purp->pool);
+}
+
+void
+purpose_free (TPurpose *purp)
+{
+    free (purp->Lines);
+    free (purp->Components);
+    strbuf_free (&purp->pool);
+    purpose_init (purp);
+}
+
+/*
+ * Return the slot for the next component of the line (the last line of 
+ * the purpose). The pointer is valid until the next call.
+ */
+static TComponent *
+component_slot (TPurpose *purp, const TLine *line)
+{
+    int i = line->first + line->nComponents;
+    
+    if (i >= purp->maxComponents)
+    {
+        purp->maxComponents = (purp->maxComponents < 16) ? 16 : purp->maxComponents * 2;
+        purp->Components = (TComponent *)alloc_mem (purp->Components, 
+            purp->maxComponents, sizeof (TComponent));
+    }
+    return &purp->Components[i];
+}
+
+static void
+add_string_component (TPurpose *purp, TLine *line, const char *str)
+{
+    TComponent *comp = component_slot (purp, line);
+    
+    comp->Type = COMPONENT_TYPE_STRING;
+    comp->off = purp->pool.len;
+    comp->n = 1;
+    strbuf_append (&purp->pool, str);
+    strbuf_append_char (&purp->pool, NULL_TERMINATOR);
+    line->nComponents++;
+}
+
+/*
+ * Drop the components of the line parsed so far and make the whole string 
+ * its only value.
+ */
+static void
+make_common_line (TPurpose *purp, TLine *line, size_t pool_len, const char *str)
+{
+    purp->pool.len = pool_len;
+    line->Type = LINE_TYPE_COMMON; 
+    line->nComponents = 0;
+    add_string_component (purp, line, str);
+}
+
+/*
+ * Parse a line of the PURPOSE section and add it to the purpose.
+ * *warning is set to WARNING_OK or to the description of the problem.
+ */
+void
+parse_purpose_line (const char *string, TPurpose *purp, const char **warning)
 {
+    TLine       *line = NULL;
+    size_t      pool_len = purp->pool.len;
     int         state, prev_bslash_state, prev_apostr_state;
     char        ch = NULL_TERMINATOR;
     char        next_ch = NULL_TERMINATOR;
@@ -65,8 +144,18 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
     int			in_apostr = 0;
             
     size_t tlen = 0;
+    
+    if (purp->nLines >= purp->maxLines)
+    {
+        purp->maxLines = (purp->maxLines < 8) ? 8 : purp->maxLines * 2;
+        purp->Lines = (TLine *)alloc_mem (purp->Lines, purp->maxLines, sizeof (TLine));
+    }
+    line = &purp->Lines[purp->nLines];
+    line->Type = LINE_TYPE_COMMON;
+    line->nComponents = 0;
+    line->first = purp->nComponents;
+    
     state = STATE_INIT;
-    line->nComponents = -1;
     str_ = strdup (string);
     for (i = 0; i < strlen (str_); i++)
     {
@@ -105,7 +194,7 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
     wo_close_bracket = TRUE;
     interval_available = TRUE;
     is_warning = FALSE;
-    strcpy (*warning, WARNING_OK);
+    *warning = WARNING_OK;
     set_len = strlen (SET);
     res_len = strlen (RES);
     
@@ -156,28 +245,7 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
             
             case STATE_COMMON:
             {
-                if (is_warning)
-                {
-                    for (i = 0; i < line->nComponents; i++)
-                    {
-                        if (line->Components[i]->Type == COMPONENT_TYPE_STRING)
-                        {
-                            free (line->Components[i]->str);
-                        }
-                        free (line->Components[i]);
-                    }
-                }
-                
-                line->Type = LINE_TYPE_COMMON; 
-                line->nComponents = 1;
-                
-                line->Components[0] = NULL;
-                line->Components[0] = alloc_mem (line->Components[0], 2, sizeof (TComponent));
-                line->Components[0]->Type = COMPONENT_TYPE_STRING;
-                line->Components[0]->str = NULL;
-                line->Components[0]->str = alloc_mem_for_string (line->Components[0]->str, strlen (str_) + 1);
-                strcpy (line->Components[0]->str, str_);
-                line->Components[0]->n = 1;
+                make_common_line (purp, line, pool_len, str_);
                 
                 wo_close_bracket = FALSE;
                 continue_for = FALSE;               
@@ -276,32 +344,25 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                         if (!(string_is_number (comp)))
                         {
                             is_warning = TRUE;
-                            strcpy (*warning, WARNING_INTERVAL);
+                            *warning = WARNING_INTERVAL;
                             state = STATE_COMMON;
                             break;              
                         }
                         if (strlen (comp) > MAX_INT_LENGTH_IN_STR_FORM)
                         {
                             is_warning = TRUE;
-                            strcpy (*warning, WARNING_MAX_INT);
+                            *warning = WARNING_MAX_INT;
                             state = STATE_COMMON;
                             break;              
                         }
                         
                         is_interval = FALSE;
-                        line->Components[line->nComponents]->b = atoi (comp);
+                        component_slot (purp, line)->b = atoi (comp);
                         line->nComponents++;
                     }
                     else
                     {
-                        line->Components[line->nComponents] = NULL;
-                        line->Components[line->nComponents] = alloc_mem (line->Components[line->nComponents], 2, sizeof (TComponent));
-                        line->Components[line->nComponents]->Type = COMPONENT_TYPE_STRING;
-                        line->Components[line->nComponents]->str = NULL;
-                        line->Components[line->nComponents]->str = alloc_mem_for_string (line->Components[line->nComponents]->str, strlen (comp) + 1);
-                        strcpy (line->Components[line->nComponents]->str, comp);
-                        line->Components[line->nComponents]->n = 1;
-                        line->nComponents++;
+                        add_string_component (purp, line, comp);
                     }
                     
                     if (ch == SEMICOLON)
@@ -387,14 +448,14 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                     if (!(string_is_number (comp)))
                     {
                         is_warning = TRUE;
-                        strcpy (*warning, WARNING_INTERVAL);
+                        *warning = WARNING_INTERVAL;
                         state = STATE_COMMON;
                         break;              
                     }
                     if (strlen (comp) > MAX_INT_LENGTH_IN_STR_FORM)
                     {
                         is_warning = TRUE;
-                        strcpy (*warning, WARNING_MAX_INT);
+                        *warning = WARNING_MAX_INT;
                         state = STATE_COMMON;
                         break;              
                     }
@@ -402,11 +463,10 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                     is_interval = TRUE;
                     interval_available = FALSE;
 
-                    line->Components[line->nComponents] = NULL;
-                    line->Components[line->nComponents] = alloc_mem (line->Components[line->nComponents], 2, sizeof (TComponent));
-                    line->Components[line->nComponents]->Type = COMPONENT_TYPE_INTERVAL;
-                    line->Components[line->nComponents]->a = atoi (comp);
-                    line->Components[line->nComponents]->n = 1;
+                    TComponent *interval = component_slot (purp, line);
+                    interval->Type = COMPONENT_TYPE_INTERVAL;
+                    interval->a = atoi (comp);
+                    interval->n = 1;
                     strcpy (comp, EMPTY_STRING);
                 }
                 else
@@ -436,7 +496,7 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                     if (numbers_ended)
                     {
                         is_warning = TRUE;
-                        strcpy (*warning, WARNING_COLON);
+                        *warning = WARNING_COLON;
                         state = STATE_COMMON;
                         break;
                     }
@@ -451,12 +511,12 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                     if (strlen (comp) > MAX_INT_LENGTH_IN_STR_FORM)
                     {
                         is_warning = TRUE;
-                        strcpy (*warning, WARNING_MAX_INT);
+                        *warning = WARNING_MAX_INT;
                         state = STATE_COMMON;
                         break;
                     }
                     
-                    line->Components[line->nComponents]->n = atoi (comp);
+                    component_slot (purp, line)->n = atoi (comp);
                     line->nComponents++;
 
                     if (ch == SEMICOLON)
@@ -474,7 +534,7 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
                 }
                 
                 is_warning = TRUE;
-                strcpy (*warning, WARNING_COLON);
+                *warning = WARNING_COLON;
                 state = STATE_COMMON;
                 break;              
             }
@@ -489,138 +549,528 @@ parse_purpose_line (const char *string, TLine *line, char **warning)
     
     if (wo_close_bracket)
     {
-        strcpy (*warning, WARNING_NO_END);
-        for (i = 0; i < line->nComponents; i++)
+        *warning = WARNING_NO_END;
+        make_common_line (purp, line, pool_len, str_);
+    }
+    
+    purp->nComponents = line->first + line->nComponents;
+    purp->nLines++;
+    
+    free (comp);
+    free (str_);
+}
+
+/*
+ * Find the first value of the line starting from the component *ci.
+ * For an interval, the value is returned in *val. 
+ * Returns FALSE if there are no values left in the line.
+ */
+static int
+first_line_value (const TPurpose *purp, const TLine *line, int *ci, long *val)
+{
+    for (; *ci < line->nComponents; (*ci)++)
+    {
+        const TComponent *comp = PURP_COMPONENT (purp, line, *ci);
+        
+        if (comp->Type == COMPONENT_TYPE_STRING)
+        {
+            return TRUE;
+        }
+        
+        if (comp->a <= comp->b)
+        {
+            *val = comp->a;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Move to the next value of the line. Returns FALSE if there are no 
+ * values left in the line.
+ */
+static int
+next_line_value (const TPurpose *purp, const TLine *line, int *ci, long *val)
+{
+    const TComponent *comp = PURP_COMPONENT (purp, line, *ci);
+    
+    if ((comp->Type == COMPONENT_TYPE_INTERVAL) && (*val < comp->b))
+    {
+        (*val)++;
+        return TRUE;
+    }
+    
+    (*ci)++;
+    return first_line_value (purp, line, ci, val);
+}
+
+/*
+ * Set the text of the current value of the line k.
+ */
+static void
+set_param (const TPurpose *purp, int k, const int *ci, const long *val, 
+           char **params, char *nums)
+{
+    const TComponent *comp = PURP_COMPONENT (purp, &purp->Lines[k], ci[k]);
+    
+    if (comp->Type == COMPONENT_TYPE_STRING)
+    {
+        params[k] = PURP_STRING (purp, comp);
+    }
+    else
+    {
+        params[k] = nums + k * PARAM_NUM_LEN;
+        sprintf (params[k], "%ld", val[k]);
+    }
+}
+
+/*
+ * Called for each combination of the parameter values, in order. params[k] 
+ * is the value for the line k.
+ */
+typedef void (*TComboFunc) (const TPurpose *purp, char **params, void *data);
+
+/*
+ * Call func for each combination of the parameter values.
+ * The combinations are enumerated like the readings of an odometer, the
+ * values of the last SET line change first. The value of a RES line depends
+ * only on the number of the combination: the component i is used for 
+ * the next 'n' of the combinations. 
+ * Returns the number of the combinations.
+ */
+static int
+for_each_combination (TPurpose *purp, TComboFunc func, void *data)
+{
+    int         nLines = purp->nLines;
+    int         k;
+    int         count = 0;
+    int         done = FALSE;
+    int         *ci = NULL;         // current component of each line
+    long        *val = NULL;        // current value of the interval components
+    long        *res_end = NULL;    // last combination using ci[k] of a RES line
+    char        **params = NULL;
+    char        *nums = NULL;       // text of the interval values
+    
+    ci = (int *)alloc_mem (ci, nLines + 1, sizeof (int));
+    val = (long *)alloc_mem (val, nLines + 1, sizeof (long));
+    res_end = (long *)alloc_mem (res_end, nLines + 1, sizeof (long));
+    params = (char **)alloc_mem (params, nLines + 1, sizeof (char *));
+    nums = alloc_mem_for_string (nums, (nLines + 1) * PARAM_NUM_LEN);
+    
+    for (k = 0; k < nLines; k++)
+    {
+        TLine *line = &purp->Lines[k];
+        
+        ci[k] = 0;
+        if (line->Type == LINE_TYPE_RES)
+        {
+            res_end[k] = (line->nComponents > 0) ? PURP_COMPONENT (purp, line, 0)->n : 0;
+        }
+        else if (!first_line_value (purp, line, &ci[k], &val[k]))
+        {
+            done = TRUE;    // no combinations at all
+            break;
+        }
+        else
+        {
+            set_param (purp, k, ci, val, params, nums);
+        }
+    }
+    
+    while (!done)
+    {
+        count++;
+        
+        for (k = 0; k < nLines; k++)
         {
-            if (line->Components[i]->Type == COMPONENT_TYPE_STRING)
+            TLine *line = &purp->Lines[k];
+            
+            if (line->Type == LINE_TYPE_RES)
             {
-                free (line->Components[i]->str);
+                while ((ci[k] < line->nComponents - 1) && (res_end[k] < count))
+                {
+                    ci[k]++;
+                    res_end[k] += PURP_COMPONENT (purp, line, ci[k])->n;
+                }
+                params[k] = (line->nComponents > 0) ? 
+                    PURP_STRING (purp, PURP_COMPONENT (purp, line, ci[k])) : "";
             }
-            free (line->Components[i]);
         }
+        
+        func (purp, params, data);
+        
+        // Move to the next combination.
+        for (k = nLines - 1; k >= 0; k--)
+        {
+            TLine *line = &purp->Lines[k];
             
-        line->Type = LINE_TYPE_COMMON; 
-        line->nComponents = 1;
+            if (line->Type == LINE_TYPE_RES)
+            {
+                continue;
+            }
+            
+            if (next_line_value (purp, line, &ci[k], &val[k]))
+            {
+                set_param (purp, k, ci, val, params, nums);
+                break;
+            }
+            
+            ci[k] = 0;
+            first_line_value (purp, line, &ci[k], &val[k]);
+            set_param (purp, k, ci, val, params, nums);
+        }
         
-        line->Components[0] = NULL;
-        line->Components[0] = alloc_mem (line->Components[0], 2, sizeof (TComponent));
-        line->Components[0]->Type = COMPONENT_TYPE_STRING;
-        line->Components[0]->str = NULL;
-        line->Components[0]->str = alloc_mem_for_string (line->Components[0]->str, strlen (str_) + 1);
-        strcpy (line->Components[0]->str, str_);
-        line->Components[0]->n = 1;
+        done = (k < 0);
     }
     
-    free (comp);
-    free (str_);
+    free (nums);
+    free (params);
+    free (res_end);
+    free (val);
+    free (ci);
+    return count;
 }
 
+/*
+ * Remove white space around the string values of the parameters.
+ */
+static void
+trim_values (TPurpose *purp)
+{
+    int i;
+    
+    for (i = 0; i < purp->nComponents; i++)
+    {
+        TComponent *comp = &purp->Components[i];
+        if (comp->Type == COMPONENT_TYPE_STRING)
+        {
+            trim (PURP_STRING (purp, comp));
+        }
+    }
+}
+
+typedef struct
+{
+    TOutSink            *out;
+    const TTemplate     *tpl;
+    int                 num;        // of the next test purpose
+    TStrBuf             comment;
+} TExpandData;
+
+static void
+render_combination (const TPurpose *purp, char **params, void *data)
+{
+    TExpandData *ed = (TExpandData *)data;
+    char        num_str[PARAM_NUM_LEN];
+    char        *values[PTAGS_NUM];
+    int         k;
+    
+    ed->comment.len = 0;
+    for (k = 0; k < purp->nLines; k++)
+    {
+        strbuf_append (&ed->comment, COMMENT_POS);
+        strbuf_append (&ed->comment, params[k]);
+        strbuf_append (&ed->comment, STRING_NL);
+    }
+    
+    sprintf (num_str, "%d", ed->num++);
+    values[PTAG_PARAMS_POS] = (char *)strbuf_str (&ed->comment);
+    values[PTAG_PURPNUM_POS] = num_str;
+    tpl_render_to (&ed->out->buf, ed->tpl, values, params, purp->nLines);
+    sink_mark (ed->out, 1);
+    sink_flush (ed->out, 0);
+}
+
+/*
+ * Generate the code of the test purpose for each combination of the 
+ * parameter values and write it to 'out'. 
+ * The numbers of the test purposes start from first_num. 
+ * Returns the number of the generated test purposes.
+ */
 int
-get_res_component_from_purp_number (TLine *line, int k)
+expand_purpose (TPurpose *purp, TOutSink *out, const TTemplate *tpl, int first_num)
 {
-    int         i, j;
+    TExpandData ed;
+    int         count;
+    
+    trim_values (purp);
+    
+    ed.out = out;
+    ed.tpl = tpl;
+    ed.num = first_num;
+    strbuf_init (&ed.comment);
+    
+    count = for_each_combination (purp, render_combination, &ed);
+    
+    strbuf_free (&ed.comment);
+    return count;
+}
+
+/*
+ * Return the number of values of the line (0 for a RES line: its values 
+ * do not add to the number of the combinations).
+ */
+static long
+count_line_values (const TPurpose *purp, const TLine *line)
+{
+    long    count = 0;
+    int     i;
+    
+    if (line->Type == LINE_TYPE_RES)
+    {
+        return 0;
+    }
     
-    j = 0;
     for (i = 0; i < line->nComponents; i++)
     {
-        j += line->Components[i]->n;
-        if (j >= k)
+        const TComponent *comp = PURP_COMPONENT (purp, line, i);
+        
+        if (comp->Type == COMPONENT_TYPE_STRING)
+        {
+            count++;
+        }
+        else if (comp->a <= comp->b)
         {
-            return i;
+            count += comp->b - comp->a + 1;
         }
-    } 
+    }
+    return count;
+}
+
+/*
+ * Return the type of the value if it is a literal of a type that can be 
+ * stored in a table of parameters, VALUE_OTHER otherwise.
+ */
+static int
+value_type (const char *str)
+{
+    const char  *p = str;
+    char        *end = NULL;
+    size_t      len = strlen (str);
+    long        lval;
+    
+    if ((len >= 2) && (str[0] == QUOT) && (str[len - 1] == QUOT))
+    {
+        return VALUE_STRING;
+    }
+    
+    if ((*p == '-') || (*p == '+'))
+    {
+        ++p;
+    }
+    if (!char_in_string (*p, NUMBERS) || (*p == NULL_TERMINATOR))
+    {
+        return VALUE_OTHER;
+    }
     
-    return line->nComponents - 1;
+    errno = 0;
+    lval = strtol (str, &end, 0);
+    if ((*end == NULL_TERMINATOR) && (errno == 0) && 
+        (lval >= INT_MIN) && (lval <= INT_MAX))
+    {
+        return VALUE_INT;
+    }
+    
+    strtod (str, &end);
+    if ((*end == NULL_TERMINATOR) && (errno == 0))
+    {
+        return VALUE_DOUBLE;
+    }
+    
+    return VALUE_OTHER;
 }
 
-void
-parameter_and_text_generator (TPurpose *purp, char **text, char *text_tpl, const char *finally_code, long *pa, const int purp_num_real, int k, int *purp_num)
+/*
+ * Return the type of all the values of the line or VALUE_OTHER if it is
+ * not the same for all of them.
+ */
+static int
+line_value_type (const TPurpose *purp, const TLine *line)
 {
-    int         i, j, temp;
-    char        *temp_str1 = NULL;
-    char        *temp_str2 = NULL;
-    char        *temp_text = NULL;
-    char        *comment = NULL;
+    int     type = VALUE_OTHER;
+    int     i;
+    
+    for (i = 0; i < line->nComponents; i++)
+    {
+        const TComponent *comp = PURP_COMPONENT (purp, line, i);
+        int t = (comp->Type == COMPONENT_TYPE_INTERVAL) ? 
+            VALUE_INT : value_type (PURP_STRING (purp, comp));
+        
+        if ((t == VALUE_OTHER) || ((i > 0) && (t != type)))
+        {
+            return VALUE_OTHER;
+        }
+        type = t;
+    }
+    return type;
+}
+
+static const char *value_c_type[] = {
+    NULL,
+    "int",
+    "double",
+    "const char*"
+};
 
-    if (k == purp->nLines)
+typedef struct
+{
+    TOutSink    *out;
+    const int   *is_column;
+} TTableData;
+
+static void
+add_table_row (const TPurpose *purp, char **params, void *data)
+{
+    TTableData  *td = (TTableData *)data;
+    int         k;
+    int         first = TRUE;
+    
+    strbuf_append (&td->out->buf, "    {");
+    for (k = 0; k < purp->nLines; k++)
     {
-        for (i = 0; i < purp->nLines; i++)
+        if (td->is_column[k])
         {
-            if (purp->Lines[i]->Type == LINE_TYPE_RES)
+            if (!first)
             {
-                pa[i] = get_res_component_from_purp_number (purp->Lines[i], *purp_num);
+                strbuf_append (&td->out->buf, ", ");
             }
+            strbuf_append (&td->out->buf, params[k]);
+            first = FALSE;
         }
-        
-        temp_str1 = alloc_mem_for_string (temp_str1, MAX_STRING_LEGTH);
-        temp_str2 = alloc_mem_for_string (temp_str2, MAX_STRING_LEGTH);
-        comment = strdup (EMPTY_STRING);
-        temp_text = strdup (text_tpl);
+    }
+    strbuf_append (&td->out->buf, "},\n");
+    sink_flush (td->out, 0);
+}
 
-        temp_text = replace_all_substr_in_string(temp_text, FINALLY_TAG, finally_code);
-        for (i = 0; i < purp->nLines; i++)
+static void
+get_constant_value (const TPurpose *purp, char **params, void *data)
+{
+    char    **values = (char **)data;
+    int     k;
+    
+    for (k = 0; k < purp->nLines; k++)
+    {
+        if (values[k] == NULL)
         {
-            sprintf (temp_str1, PARAMNUM_TAG, i);
-            if (pa[i] < MAX_LONGINT)
-            {
-                char* tstr = trim(purp->Lines[i]->Components[pa[i]]->str);
-                temp_text = replace_all_substr_in_string(temp_text, temp_str1, tstr);
-                comment = str_append (comment, COMMENT_POS);
-                comment = str_append (comment, tstr);
-                comment = str_append (comment, STRING_NL);
-            }
-            else
-            {
-                sprintf (temp_str2, "%d", pa[i] - MAX_LONGINT);
-                temp_text = replace_all_substr_in_string(temp_text, temp_str1, temp_str2);
-                comment = str_append (comment, COMMENT_POS);
-                comment = str_append (comment, temp_str2);
-                comment = str_append (comment, STRING_NL);
-            }
+            values[k] = strdup (params[k]);
         }
+    }
+}
 
-        sprintf (temp_str1, "%d", purp_num_real + *purp_num);
-        temp_text = replace_all_substr_in_string(temp_text, PURPNUM_TAG, temp_str1);
-        temp_text = replace_all_substr_in_string(temp_text, PARAMS_TAG, comment);
-        if (*purp_num == 1)
+/*
+ * Same as expand_purpose() but the code of the test purpose is generated 
+ * only once, as the function test_purpose_<first_num>. The values of the 
+ * parameters that differ from one combination to another are stored in 
+ * the table tp_params_<first_num>_[] and tp_params_ points to the row for
+ * the current test purpose (tet_thistest). The parameters that have the 
+ * same value in all combinations are substituted as usual.
+ * This is possible only if all values of each such parameter are literals
+ * of the same type (int, double or string). Returns -1 if it is not so 
+ * (nothing is generated then).
+ */
+int
+expand_purpose_table (TPurpose *purp, TOutSink *out, const TTemplate *tpl, int first_num)
+{
+    int         nLines = purp->nLines;
+    int         *is_column = NULL;
+    char        **params = NULL;
+    char        num_str[PARAM_NUM_LEN];
+    char        *values[PTAGS_NUM];
+    TStrBuf     comment;
+    TTableData  td;
+    int         nColumns = 0;
+    int         count = -1;
+    int         isTable = TRUE;
+    int         k;
+    
+    trim_values (purp);
+    
+    is_column = (int *)alloc_mem (is_column, nLines + 1, sizeof (int));
+    params = (char **)alloc_mem (params, nLines + 1, sizeof (char *));
+    
+    for (k = 0; (k < nLines) && isTable; k++)
+    {
+        const TLine *line = &purp->Lines[k];
+        long n = count_line_values (purp, line);
+        
+        is_column[k] = (n > 1) || ((line->Type == LINE_TYPE_RES) && (line->nComponents > 1));
+        if ((line->Type != LINE_TYPE_RES) && (n == 0))
         {
-            strcpy (*text, EMPTY_STRING);
+            isTable = FALSE;    // no combinations at all
+        }
+        else if (is_column[k])
+        {
+            isTable = (line_value_type (purp, line) != VALUE_OTHER);
+            ++nColumns;
         }
-        *text = str_append (*text, temp_text);
-        (*purp_num)++;
-    
-        free (temp_text);
-        free (comment);
-        free (temp_str2);
-        free (temp_str1);
-        return;
     }
     
-    if (purp->Lines[k]->Type == LINE_TYPE_RES)
+    // A single combination needs no table.
+    if (!isTable || (nColumns == 0))
     {
-        parameter_and_text_generator (purp, text, text_tpl, finally_code, pa, purp_num_real, k + 1, purp_num);
+        free (params);
+        free (is_column);
+        return -1;
     }
-    else
+    
+    // The values of the other parameters are the same in all combinations.
+    for_each_combination (purp, get_constant_value, params);
+    
+    strbuf_init (&comment);
+    
+    sprintf (num_str, "%d", first_num);
+    strbuf_append (&out->buf, "// Parameters of the test purposes implemented by test_purpose_");
+    strbuf_append (&out->buf, num_str);
+    strbuf_append (&out->buf, "()\nstatic const struct\n{\n");
+    for (k = 0; k < nLines; k++)
     {
-        for (i = 0; i < purp->Lines[k]->nComponents; i++)
+        if (is_column[k])
         {
-            if (purp->Lines[k]->Components[i]->Type == COMPONENT_TYPE_STRING)
-            {
-                temp = pa[k];
-                pa[k] = i;
-                parameter_and_text_generator (purp, text, text_tpl, finally_code, pa, purp_num_real, k + 1, purp_num);
-                pa[k] = temp;
-            }
-            else
-            {
-                for (j = purp->Lines[k]->Components[i]->a; j <= purp->Lines[k]->Components[i]->b; j++)
-                {
-                    temp = pa[k];
-                    pa[k] = j + MAX_LONGINT;
-                    parameter_and_text_generator (purp, text, text_tpl, finally_code, pa, purp_num_real, k + 1, purp_num);
-                    pa[k] = temp;
-                }
-            }
+            char field[PARAM_NUM_LEN + 16];
+            
+            sprintf (field, " p%d;\n", k);
+            strbuf_append (&out->buf, "    ");
+            strbuf_append (&out->buf, value_c_type[line_value_type (purp, &purp->Lines[k])]);
+            strbuf_append (&out->buf, field);
+            
+            free (params[k]);
+            sprintf (field, "(tp_params_->p%d)", k);
+            params[k] = strdup (field);
         }
+        
+        strbuf_append (&comment, COMMENT_POS);
+        strbuf_append (&comment, params[k]);
+        strbuf_append (&comment, STRING_NL);
+    }
+    strbuf_append (&out->buf, "} tp_params_");
+    strbuf_append (&out->buf, num_str);
+    strbuf_append (&out->buf, "_[] = {\n");
+    
+    td.out = out;
+    td.is_column = is_column;
+    count = for_each_combination (purp, add_table_row, &td);
+    
+    strbuf_append (&out->buf, "};\n#define tp_params_ (&tp_params_");
+    strbuf_append (&out->buf, num_str);
+    strbuf_append (&out->buf, "_[tet_thistest - ");
+    strbuf_append (&out->buf, num_str);
+    strbuf_append (&out->buf, "])\n");
+    
+    values[PTAG_PARAMS_POS] = (char *)strbuf_str (&comment);
+    values[PTAG_PURPNUM_POS] = num_str;
+    tpl_render_to (&out->buf, tpl, values, params, nLines);
+    strbuf_append (&out->buf, "#undef tp_params_\n");
+    sink_mark (out, count);
+    sink_flush (out, 0);
+    
+    strbuf_free (&comment);
+    
+    for (k = 0; k < nLines; k++)
+    {
+        free (params[k]);
     }
+    free (params);
+    free (is_column);
+    return count;
 }
@@ -16,16 +16,34 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 ******************************************************************************/
 
+// sigaltstack() and SA_ONSTACK are XSI extensions, syscall() (used for 
+// pidfd_open(), see t2c_wait_child()) is not in POSIX at all.
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 //#include "../include/t2c_util.h"
 #include "../include/t2c_tet_support.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <setjmp.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/select.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 // The stuff below came from TET 3.7-lite with several changes 
 // (mostly simplifications).
@@ -34,42 +52,35 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 pid_t t2c_child = 0;
 
 ///////////////////////////////////////////////////////////////////////////
-// Kill the child and wait T2C_KILLWAIT seconds for it to die.
+// Kill the child and wait 'timeout_ms' milliseconds for it to die
+// (T2C_KILLWAIT seconds if it is not positive).
 // t2c_killwait is the tet_killw function with minor changes.
 #define T2C_KILLWAIT    10
 
-static int 
-t2c_killwait(pid_t child, unsigned int timeout);
-
-///////////////////////////////////////////////////////////////////////////
+int t2c_killwait_ms = T2C_KILLWAIT * 1000;
 
 static int 
-t2c_def_pcf(pid_t returned_pid, int* status);
-
-///////////////////////////////////////////////////////////////////////////
-// Alarm-related stuff
-struct alrmaction 
-{
-    unsigned int waittime;
-    struct sigaction sa;
-    sigset_t mask;
-};
+t2c_killwait(pid_t child, int timeout_ms);
 
-// Nonzero if an alarm has been raised. Alarm handlers increment this flag.
-int t2c_alarm_flag;
+// Wait for the child to terminate (or to stop if 'options' contain 
+// WUNTRACED) for 'timeout_ms' milliseconds at most.
+#define T2C_WAIT_SLICE_MS   100
 
-static void 
-t2c_catch_alarm(int);
+static pid_t
+t2c_wait_child(pid_t child, int* status, int timeout_ms, int options);
 
-static int 
-t2c_set_alarm(struct alrmaction *, struct alrmaction *);
+///////////////////////////////////////////////////////////////////////////
 
 static int 
-t2c_clr_alarm(struct alrmaction *);
+t2c_def_pcf(pid_t returned_pid, int* status);
 
 ///////////////////////////////////////////////////////////////////////////
 int pcc_pipe_[2];   // for parent-child control data transfer
 
+// Kill the test purposes running concurrently (see t2c_concurrent_fork()).
+static void
+t2c_concurrent_kill();
+
 ///////////////////////////////////////////////////////////////////////////
 // Signal handlers
 static void
@@ -82,8 +93,9 @@ sig_term(int sig)
 
     if (t2c_child > 0)
     {
-        t2c_killwait(t2c_child, T2C_KILLWAIT);
+        t2c_killwait(t2c_child, t2c_killwait_ms);
     }
+    t2c_concurrent_kill();
 
     sa.sa_handler = SIG_DFL;
     sa.sa_flags = 0; 
@@ -98,11 +110,22 @@ int
 t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
     TUserStartup ustartup, TUserCleanup ucleanup)
 {
-    int rtval, err, status;
+    return t2c_fork_ms(childfunc, pcf, 
+        (waittime > 0) ? waittime * 1000 : 0, 
+        ustartup, ucleanup);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_fork_ms()
+int 
+t2c_fork_ms(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms,
+    TUserStartup ustartup, TUserCleanup ucleanup)
+{
+    pid_t   rtval;
+    int     err, status;
     pid_t   savchild, pid;
     char    buf[256];
     struct sigaction tsa, new_sa; 
-    struct alrmaction new_aa, old_aa; 
     
     int ret_status = -1;
     
@@ -112,8 +135,6 @@ t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
     fflush(stdout);
     fflush(stderr);
     
-    t2c_alarm_flag = 0;
-
     // Save old value of t2c_child in case of recursive calls
     // to t2c_fork().
     savchild = t2c_child;
@@ -206,48 +227,20 @@ t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
     tet_setblock();
 
     /* wait for the child */
-    if (waittime > 0)
-    {
-        new_aa.waittime = waittime; 
-        new_aa.sa.sa_handler = t2c_catch_alarm; 
-        new_aa.sa.sa_flags = 0; 
-        (void) sigemptyset(&new_aa.sa.sa_mask); 
-        
-        t2c_alarm_flag = 0; 
-        if (t2c_set_alarm(&new_aa, &old_aa) == -1)
-        {
-            sprintf(buf, "t2c_fork: failed to set alarm. errno: %d.", errno);
-            tet_infoline(buf);
-            tet_result(TET_UNRESOLVED);
-            
-            t2c_child = savchild;
-            
-            return -1;
-        }
-    }
-    
-    rtval = waitpid(t2c_child, &status, WUNTRACED);
-    err = errno; 
-
-    if (waittime > 0)
-    {
-        (void) t2c_clr_alarm(&old_aa);
-    }
+    rtval = t2c_wait_child(t2c_child, &status, waittime_ms, WUNTRACED);
+    err = (rtval == -1) ? errno : 0; 
 
     int bContinue = 1;
-    if (rtval == -1)
+    if (rtval == 0)
     {
-        if (t2c_alarm_flag > 0)
-        {
-            sprintf(buf, "Child process timed out.");
-            tet_infoline(buf);
-            
-            tet_result(TET_UNRESOLVED);
-            t2c_killwait(t2c_child, T2C_KILLWAIT);
-                        
-            t2c_child = savchild;
-            bContinue = 0;    // We need to exit ASAP, but read the child status first.
-        }
+        sprintf(buf, "Child process timed out.");
+        tet_infoline(buf);
+        
+        tet_result(TET_UNRESOLVED);
+        t2c_killwait(t2c_child, t2c_killwait_ms);
+                    
+        t2c_child = savchild;
+        bContinue = 0;    // We need to exit ASAP, but read the child status first.
     }
     
     // Read test status submitted by the child.
@@ -276,7 +269,7 @@ t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
         tet_result(TET_UNRESOLVED);
                     
         // Kill the child with all its descendants.
-        t2c_killwait(t2c_child, T2C_KILLWAIT);
+        t2c_killwait(t2c_child, t2c_killwait_ms);
 
         t2c_child = savchild;
         return -1;
@@ -291,23 +284,22 @@ t2c_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime,
 }
 
 static int 
-t2c_killwait(pid_t child, unsigned int timeout)
+t2c_killwait(pid_t child, int timeout_ms)
 {
     pid_t pid;
     int sig = SIGTERM;
     int ret = -1;
-    int err, count, status;
-    struct alrmaction new_aa, old_aa; 
-    char buf[256];
+    int err = 0;
+    int count, status;
 
     //<>
     //fprintf(stderr, "[NB] Doomed to die: %d.\n", (int)child);
     //<>
 
-    new_aa.waittime = timeout; 
-    new_aa.sa.sa_handler = t2c_catch_alarm; 
-    new_aa.sa.sa_flags = 0; 
-    sigemptyset(&new_aa.sa.sa_mask); 
+    if (timeout_ms <= 0)
+    {
+        timeout_ms = T2C_KILLWAIT * 1000;
+    }
 
     for (count = 0; count < 2; ++count)
     {
@@ -317,28 +309,17 @@ t2c_killwait(pid_t child, unsigned int timeout)
             break;
         }
 
-        t2c_alarm_flag = 0; 
-        if (t2c_set_alarm(&new_aa, &old_aa) == -1)
-        {
-            sprintf(buf, "Failed to set alarm - errno %d.", errno);
-            tet_infoline(buf);
-            tet_result(TET_UNRESOLVED);
-            
-            return -1;
-        }
-        
-        pid = waitpid(child, &status, 0);
+        pid = t2c_wait_child(child, &status, timeout_ms, 0);
         err = errno;
-        t2c_clr_alarm(&old_aa);
 
         if (pid == child)
         {
             ret = 0;
             break;
         }
-        if (pid == -1 && t2c_alarm_flag == 0 && errno != ECHILD)
+        if (pid == -1)
         {
-            break;
+            break;  // not our child or already reaped
         }
         
         sig = SIGKILL; /* use a stronger signal the next time */
@@ -348,50 +329,132 @@ t2c_killwait(pid_t child, unsigned int timeout)
     return ret;
 }
 
-static int
-t2c_set_alarm(struct alrmaction *new_aa, struct alrmaction *old_aa)
+// The current time in milliseconds (CLOCK_MONOTONIC). The deadlines of 
+// the children are measured in it.
+static long long
+monotonic_ms()
 {
-    sigset_t alrmset;
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// The deadline 'timeout_ms' milliseconds from now, 0 (no deadline) if 
+// 'timeout_ms' is not positive.
+static long long
+deadline_ms(int timeout_ms)
+{
+    return (timeout_ms > 0) ? monotonic_ms() + timeout_ms : 0;
+}
 
-    if (new_aa->waittime == 0)
+// How long poll() may sleep before the children are checked with waitpid()
+// again: until 'deadline' (if it is not 0) but 'slice_ms' at most (if it
+// is not negative). -1 means "indefinitely".
+static int
+poll_timeout(long long deadline, int slice_ms)
+{
+    long long left;
+    
+    if (deadline == 0)
     {
-        return -2;
+        return slice_ms;
     }
     
-    if (sigaction(SIGALRM, &new_aa->sa, &old_aa->sa) == -1)
+    left = deadline - monotonic_ms();
+    if (left < 0)
     {
-        return -1;
+        left = 0;
     }
-
-    /* SIGALRM is blocked between tet_sigsafe_start/end calls,
-       so unblock it.  (This means the handler mustn't longjmp.) */
-    sigemptyset(&alrmset);
-    sigaddset(&alrmset, SIGALRM);
-    sigprocmask(SIG_UNBLOCK, &alrmset, &old_aa->mask);
-
-    alarm(new_aa->waittime);
-
-    return 0;
+    return ((slice_ms >= 0) && (slice_ms < left)) ? slice_ms : (int)left;
 }
 
+// The children that have no pidfd are polled with waitpid() at the 
+// intervals growing from 1 ms to T2C_WAIT_SLICE_MS. Returns the current 
+// interval and doubles '*slice'.
 static int
-t2c_clr_alarm(struct alrmaction *old_aa)
+next_slice(int* slice)
 {
-    alarm(0);
-    sigprocmask(SIG_SETMASK, &old_aa->mask, (sigset_t *)0);
-    if (sigaction(SIGALRM, &old_aa->sa, (struct sigaction *)0) == -1)
+    int cur = *slice;
+    
+    if (*slice < T2C_WAIT_SLICE_MS)
     {
-        return -1;
+        *slice *= 2;
     }
-    return 0;
+    return cur;
+}
+
+// A file descriptor that becomes readable when the child terminates 
+// (pidfd_open(), Linux 5.3 and newer) or -1 if it is not available.
+static int
+pidfd_open_child(pid_t child)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, child, 0);
+#else
+    return -1;
+#endif
 }
 
-// a handler for SIGALRM signal.
-static void 
-t2c_catch_alarm(int sig)
+// Returns 'child' if it has terminated (or stopped), 0 if 'timeout_ms'
+// (if it is positive) has expired first and -1 in case of an error (errno
+// is set then). No signals or alarms are used for that: the child is 
+// watched through its pidfd with poll() where pidfd_open() is available, 
+// otherwise it is polled with waitpid() at increasing intervals. A pidfd 
+// does not report stops, so with WUNTRACED the child is also checked 
+// every T2C_WAIT_SLICE_MS.
+static pid_t
+t2c_wait_child(pid_t child, int* status, int timeout_ms, int options)
 {
-    // no longjmp, just increment the counter.
-    ++t2c_alarm_flag;
+    long long deadline = deadline_ms(timeout_ms);
+    struct pollfd pfd;
+    int slice = 1;
+    pid_t rtval;
+    int err;
+    
+    pfd.fd = pidfd_open_child(child);
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    
+    for (;;)
+    {
+        int slice_ms = -1;  // no need to wake up before the deadline
+        
+        rtval = waitpid(child, status, WNOHANG | options);
+        if ((rtval == -1) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (rtval != 0)
+        {
+            break;
+        }
+        if ((deadline != 0) && (monotonic_ms() >= deadline))
+        {
+            break;  // timed out, rtval is 0
+        }
+        
+        if (pfd.fd < 0)
+        {
+            slice_ms = next_slice(&slice);
+        }
+        else if (options & WUNTRACED)
+        {
+            slice_ms = T2C_WAIT_SLICE_MS;
+        }
+        
+        // EINTR and the like are handled by waitpid() above.
+        poll(&pfd, (pfd.fd < 0) ? 0 : 1, poll_timeout(deadline, slice_ms));
+    }
+    
+    err = errno;
+    if (pfd.fd >= 0)
+    {
+        close(pfd.fd);
+    }
+    errno = err;
+    
+    return rtval;
 }
 
 static int 
@@ -416,7 +479,7 @@ t2c_def_pcf(pid_t returned_pid, int* status)
             *status = WSTOPSIG(*status);
             sprintf(buf, "Child process was stopped by signal %d.", *status);
             tet_infoline(buf);
-            t2c_killwait(t2c_child, T2C_KILLWAIT);
+            t2c_killwait(t2c_child, t2c_killwait_ms);
         }
         else
         {
@@ -428,61 +491,1156 @@ t2c_def_pcf(pid_t returned_pid, int* status)
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// t2c_fork_dbg() - debug version of t2c_fork
-int 
-t2c_fork_dbg(TChildFunc childfunc,  TParentControlFunc pcf, int waittime,
-         TUserStartup ustartup, TUserCleanup ucleanup)
+// Concurrent test purposes: each one is executed in its own process with 
+// its own parent-child control pipe and capture file, the parent starts
+// the test purposes in advance and reports them in order 
+// (see t2c_concurrent_fork()).
+
+// States of a test purpose
+#define CC_IDLE     0   // not started yet
+#define CC_RUNNING  1
+#define CC_DONE     2   // has terminated (or stopped), not reported yet
+#define CC_OVER     3   // reported or abandoned
+
+typedef struct
 {
-    char buf[256];
-    int ret_status = -1; // failure is assumed by default
+    int state;
+    pid_t pid;
+    FILE* capture;      // the journal output of the test purpose
+    int status_fd;      // the read end of its parent-child control pipe
+    int pidfd;          // see pidfd_open_child(), -1 if there is none
+    long long deadline; // when it times out, see deadline_ms()
+    int timed_out;
+    int stopped;        // it has stopped rather than terminated
     
-    fflush(stdout);
-    fflush(stderr);
+    // The results of waitpid() for it.
+    pid_t rtval;
+    int status;
+    int err;
+} TConcurrentPurpose;
+
+static TConcurrentPurpose* cc_tp = NULL;   // cc_tp[i] is the test purpose i + 1
+static TChildFunc* cc_funcs = NULL;
+static const int* cc_concurrent = NULL;
+static int cc_num = 0;
+static int cc_waittime_ms = 0;
+static int cc_max = 1;          // how many test purposes may run at the same time
+static int cc_running = 0;      // how many of them are running
+static int cc_exclusive = 0;    // nonzero if the running one should run alone
+
+// The parent waits for the running test purposes with poll(), one pollfd
+// for each (cc_max in total).
+static struct pollfd* cc_fds = NULL;
+static int cc_slice = 1;        // see next_slice()
+
+static void
+t2c_concurrent_kill()
+{
+    int i;
     
-    int init_failed = 0;
-    char* reason = NULL;
+    for (i = 0; i < cc_num; ++i)
+    {
+        if (cc_tp[i].state == CC_RUNNING || cc_tp[i].stopped)
+        {
+            kill(cc_tp[i].pid, SIGKILL);
+        }
+    }
+}
 
-    if (ustartup)
+// The test purpose i is no longer running.
+static void
+cc_finished(int i, pid_t rtval, int status, int err)
+{
+    TConcurrentPurpose* tp = &cc_tp[i];
+    
+    tp->state = CC_DONE;
+    tp->rtval = rtval;
+    tp->status = status;
+    tp->err = err;
+    tp->stopped = (rtval == tp->pid && WIFSTOPPED(status));
+    
+    if (tp->pidfd >= 0)
     {
-        ustartup(&init_failed, &reason);
+        close(tp->pidfd);
+        tp->pidfd = -1;
     }
     
-    if (init_failed)
+    --cc_running;
+    if (!cc_concurrent[i])
     {
-        if (reason)
+        cc_exclusive = 0;
+    }
+}
+
+// Kill the test purpose i if it is still running and free its resources.
+static void
+cc_release(int i)
+{
+    TConcurrentPurpose* tp = &cc_tp[i];
+    
+    if (tp->state == CC_RUNNING || tp->stopped)
+    {
+        kill(tp->pid, SIGKILL);
+        while (waitpid(tp->pid, NULL, 0) == -1 && errno == EINTR)
         {
-            tet_infoline(reason);
         }
-        tet_result(TET_UNINITIATED);
+        if (tp->state == CC_RUNNING)
+        {
+            cc_finished(i, -1, 0, 0);
+        }
+        tp->stopped = 0;
+    }
+    
+    if (tp->capture != NULL)
+    {
+        fclose(tp->capture);
+        tp->capture = NULL;
+    }
+    if (tp->status_fd >= 0)
+    {
+        close(tp->status_fd);
+        tp->status_fd = -1;
+    }
+    tp->state = CC_OVER;
+}
+
+// Start the test purpose i. Returns 0 on success, -1 otherwise (errno is 
+// then set).
+static int
+cc_start(int i)
+{
+    TConcurrentPurpose* tp = &cc_tp[i];
+    struct sigaction tsa;
+    int st[2];
+    int err;
+    pid_t pid;
+    
+    int sig;
+    int ch_sig[] = {SIGTERM, SIGALRM, SIGABRT};
+    
+    tp->capture = tmpfile();
+    if (tp->capture == NULL)
+    {
+        return -1;
+    }
+    if (pipe(st) != 0)
+    {
+        err = errno;
+        fclose(tp->capture);
+        tp->capture = NULL;
+        errno = err;
+        return -1;
+    }
+    
+    fflush(stdout);
+    fflush(stderr);
+    
+    pid = fork();
+    if (pid == -1)
+    {
+        err = errno;
+        fclose(tp->capture);
+        tp->capture = NULL;
+        close(st[0]);
+        close(st[1]);
+        errno = err;
+        return -1;
+    }
+    
+    if (pid == 0)
+    {
+        /* child process */
         
-        // Write no-PASS test status to the pipe.
-        int st = 0;
-        int pcc_num = write(pcc_pipe_[1], &st, sizeof(int));
-        if (pcc_num != sizeof(int))
+        // Reset signal handlers to default ones.
+        for (sig = 0; sig < sizeof(ch_sig)/sizeof(ch_sig[0]); ++sig)
         {
-            sprintf(buf, "t2c_fork_dbg: unable to write to the parent-child control pipe, errno: %d.", errno);
-            tet_infoline(buf);
+            if (sigaction(ch_sig[sig], (struct sigaction *) 0, &tsa) != -1 && 
+                (tsa.sa_handler != SIG_IGN && tsa.sa_handler != SIG_DFL)) 
+            {
+                tsa.sa_handler = SIG_DFL;
+                sigaction(ch_sig[sig], &tsa, (struct sigaction *) 0);
+            }
         }
+        // The output and the status of this test purpose only.
+        pcc_pipe_[0] = st[0];
+        pcc_pipe_[1] = st[1];
+        t2c_capture_fd = fileno(tp->capture);
+        
+        tet_thistest = i + 1;
+        tet_setcontext();
+        
+        cc_funcs[i]();
+        exit(EXIT_SUCCESS);
     }
-    else
-    {        
-        // OK, call the "child" function
-        childfunc();
+    
+    close(st[1]);
+    tp->pid = pid;
+    tp->status_fd = st[0];
+    tp->pidfd = pidfd_open_child(pid);
+    tp->deadline = deadline_ms(cc_waittime_ms);
+    tp->state = CC_RUNNING;
+    cc_slice = 1;
+    
+    ++cc_running;
+    if (!cc_concurrent[i])
+    {
+        cc_exclusive = 1;
     }
+    return 0;
+}
+
+// Start the test purposes from 'cur' on while it is allowed. Those deleted
+// by the test are skipped, TET will not call them. The test purposes are
+// not started too far ahead of 'cur', so that the number of the open files
+// is limited.
+static void
+cc_fill(int cur)
+{
+    int i;
     
-    if (ucleanup)
+    for (i = cur; (i < cc_num) && (i < cur + 2 * cc_max); ++i)
     {
-        ucleanup();
+        if ((cc_running >= cc_max) || cc_exclusive)
+        {
+            break;
+        }
+        if ((cc_tp[i].state != CC_IDLE) || 
+            ((i > cur) && (tet_reason(i + 1) != NULL)))
+        {
+            continue;
+        }
+        
+        // An exclusive test purpose is started only when nothing else is
+        // running, the following ones are not started before it.
+        if (!cc_concurrent[i] && (cc_running > 0))
+        {
+            break;
+        }
+        
+        if (cc_start(i) != 0)
+        {
+            break;  // try again when some test purpose terminates
+        }
     }
+}
+
+// Check if the running test purposes have terminated or timed out.
+static void
+cc_reap()
+{
+    TConcurrentPurpose* tp;
+    pid_t rtval;
+    int status = 0;
+    int i;
     
-    // Read test status submitted by the "child" function.
-    int pcc_num = read(pcc_pipe_[0], &ret_status, sizeof(int));
-    if (pcc_num != sizeof(int))
+    for (i = 0; i < cc_num; ++i)
     {
-        sprintf(buf, "t2c_fork_dbg: unable to read from the parent-child control pipe, errno: %d.", errno);
-        tet_infoline(buf);
-        ret_status = -1; // something wrong happened
+        tp = &cc_tp[i];
+        if (tp->state != CC_RUNNING)
+        {
+            continue;
+        }
+        
+        rtval = waitpid(tp->pid, &status, WNOHANG | WUNTRACED);
+        if (rtval == tp->pid)
+        {
+            cc_finished(i, rtval, status, 0);
+        }
+        else if (rtval == -1 && errno != EINTR)
+        {
+            cc_finished(i, rtval, 0, errno);
+        }
+        else if ((tp->deadline != 0) && (monotonic_ms() >= tp->deadline))
+        {
+            t2c_killwait(tp->pid, t2c_killwait_ms);
+            tp->timed_out = 1;
+            cc_finished(i, -1, 0, 0);
+        }
     }
+}
+
+// Wait until a running test purpose terminates or the nearest deadline 
+// comes. The children are watched through their pidfds, but they are also
+// checked with waitpid() every T2C_WAIT_SLICE_MS to notice the stops (or 
+// more often if some of them have no pidfd, see t2c_wait_child()).
+static void
+cc_sleep()
+{
+    TConcurrentPurpose* tp;
+    long long next = 0;
+    int polled = 0;
+    int nfds = 0;
+    int i;
     
-    return ret_status;
+    for (i = 0; i < cc_num; ++i)
+    {
+        tp = &cc_tp[i];
+        if (tp->state != CC_RUNNING)
+        {
+            continue;
+        }
+        
+        if ((tp->deadline != 0) && ((next == 0) || (tp->deadline < next)))
+        {
+            next = tp->deadline;
+        }
+        if (tp->pidfd < 0)
+        {
+            polled = 1;
+            continue;
+        }
+        cc_fds[nfds].fd = tp->pidfd;
+        cc_fds[nfds].events = POLLIN;
+        cc_fds[nfds].revents = 0;
+        ++nfds;
+    }
+    
+    // EINTR and the like are handled by cc_reap().
+    poll(cc_fds, nfds, poll_timeout(next, 
+        polled ? next_slice(&cc_slice) : T2C_WAIT_SLICE_MS));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_concurrent_init()
+void 
+t2c_concurrent_init(TChildFunc funcs[], const int concurrent[], int num,
+    int waittime_ms, int max_num)
+{
+    int i;
+    
+    if (max_num <= 0)
+    {
+#ifdef _SC_NPROCESSORS_ONLN
+        max_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (max_num <= 0)
+        {
+            max_num = 1;
+        }
+    }
+    
+    cc_tp = (TConcurrentPurpose*)calloc(num, sizeof(TConcurrentPurpose));
+    for (i = 0; i < num; ++i)
+    {
+        cc_tp[i].state = CC_IDLE;
+        cc_tp[i].status_fd = -1;
+        cc_tp[i].pidfd = -1;
+    }
+    cc_fds = (struct pollfd*)calloc(max_num, sizeof(struct pollfd));
+    
+    cc_funcs = funcs;
+    cc_concurrent = concurrent;
+    cc_num = num;
+    cc_waittime_ms = waittime_ms;
+    cc_max = max_num;
+    cc_running = 0;
+    cc_exclusive = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_concurrent_fork()
+int 
+t2c_concurrent_fork(TParentControlFunc pcf)
+{
+    int cur = tet_thistest - 1;
+    TConcurrentPurpose* tp;
+    pid_t savchild;
+    char buf[256];
+    struct sigaction new_sa;
+    int start_err = 0;
+    int i;
+    
+    int ret_status = -1;
+    
+    if ((cur < 0) || (cur >= cc_num))
+    {
+        sprintf(buf, "t2c_concurrent_fork: invalid test purpose number: %d.", tet_thistest);
+        tet_infoline(buf);
+        tet_result(TET_UNRESOLVED);
+        return -1;
+    }
+    tp = &cc_tp[cur];
+    
+    // TET has skipped the previous test purposes that have not been 
+    // reported yet, their results are discarded.
+    for (i = 0; i < cur; ++i)
+    {
+        if (cc_tp[i].state != CC_OVER)
+        {
+            cc_release(i);
+        }
+    }
+    
+    /* if SIGTERM is set to default, catch it so we can propagate 
+       t2c_killwait() */
+    if (sigaction(SIGTERM, (struct sigaction *)NULL, &new_sa) != -1 &&
+        new_sa.sa_handler == SIG_DFL)
+    {
+        new_sa.sa_handler = sig_term;
+        sigaction(SIGTERM, &new_sa, (struct sigaction *)NULL);
+    }
+    
+    tet_setblock();
+    
+    for (;;)
+    {
+        cc_reap();
+        if ((tp->state == CC_DONE) || (tp->state == CC_OVER))
+        {
+            break;
+        }
+        
+        cc_fill(cur);
+        if ((tp->state == CC_IDLE) && (cc_running == 0))
+        {
+            start_err = errno;  // it cannot be started
+            break;
+        }
+        cc_sleep();
+    }
+    
+    if (tp->state != CC_DONE)
+    {
+        sprintf(buf, "t2c_concurrent_fork: unable to start the test purpose. errno: %d.", start_err);
+        tet_infoline(buf);
+        tet_result(TET_UNRESOLVED);
+        cc_release(cur);
+        return -1;
+    }
+    
+    // The journal output of the test purpose, as if it had just been 
+    // executed.
+    t2c_capture_replay(fileno(tp->capture));
+    
+    if (tp->timed_out)
+    {
+        tet_infoline("Child process timed out.");
+        tet_result(TET_UNRESOLVED);
+        
+        // If we returned -1 the result would be set to UNRESOLVED and this
+        // kind of result overrides any user-defined result codes.
+        cc_release(cur);
+        return 0;
+    }
+    
+    // Read test status submitted by the child.
+    int pcc_num = read(tp->status_fd, &ret_status, sizeof(int));
+    if (pcc_num != sizeof(int))
+    {
+        sprintf(buf, "t2c_concurrent_fork: unable to read from the parent-child control pipe, errno: %d.", errno);
+        tet_infoline(buf);
+        ret_status = -1; // something wrong happened
+    }
+    
+    // Check if the child has successfully completed its work.
+    savchild = t2c_child;
+    t2c_child = tp->pid;
+    
+    TParentControlFunc real_pcf = (pcf != NULL) ? pcf : t2c_def_pcf;
+    if (real_pcf(tp->rtval, &tp->status) == 0) // if something went wrong...
+    {
+        sprintf(buf, "Abnormal child process termination. errno: %d.", tp->err);
+        tet_infoline(buf);
+            
+        tet_result(TET_UNRESOLVED);
+        ret_status = -1;
+    }
+    
+    // The default PCF kills a stopped child and waits for it.
+    if (tp->stopped && waitpid(tp->pid, NULL, WNOHANG) == -1)
+    {
+        tp->stopped = 0;
+    }
+    
+    t2c_child = savchild;
+    cc_release(cur);
+    return ret_status;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_concurrent_stop()
+void 
+t2c_concurrent_stop()
+{
+    int i;
+    
+    for (i = 0; i < cc_num; ++i)
+    {
+        cc_release(i);
+    }
+    
+    free(cc_tp);
+    cc_tp = NULL;
+    free(cc_fds);
+    cc_fds = NULL;
+    cc_num = 0;
+    cc_running = 0;
+    cc_exclusive = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// The batch mode: the test purposes are executed one after another in 
+// a single child process while they terminate normally (see 
+// t2c_batch_fork()). The parent sends the requests (TBatchRequest) to the 
+// child through one pipe, the child replies through the other one when
+// each test purpose has finished.
+
+static pid_t batch_pid = 0;
+static int batch_req = -1;      // the requests (write end)
+static int batch_rep = -1;      // the replies (read end)
+static int batch_pidfd = -1;    // see pidfd_open_child()
+
+// A request to execute 'childfunc' as the test purpose 'thistest'.
+typedef struct
+{
+    TChildFunc childfunc;
+    int thistest;
+} TBatchRequest;
+
+// Write 'size' bytes to fd. Returns 0 on success, -1 otherwise.
+// SIGPIPE is ignored, so that the death of the reader is reported as an error.
+static int
+write_all(int fd, const void* data, size_t size)
+{
+    struct sigaction sa, old_sa;
+    const char* p = (const char*)data;
+    ssize_t num;
+    
+    sa.sa_handler = SIG_IGN;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPIPE, &sa, &old_sa);
+    
+    while (size > 0)
+    {
+        num = write(fd, p, size);
+        if (num < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (num <= 0)
+        {
+            break;
+        }
+        p += num;
+        size -= num;
+    }
+    
+    sigaction(SIGPIPE, &old_sa, (struct sigaction *)NULL);
+    return (size == 0) ? 0 : -1;
+}
+
+// Read 'size' bytes from fd. Returns 0 on success, -1 on error or at the end
+// of the file.
+static int
+read_all(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+    ssize_t num;
+    
+    while (size > 0)
+    {
+        num = read(fd, p, size);
+        if (num < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (num <= 0)
+        {
+            return -1;
+        }
+        p += num;
+        size -= num;
+    }
+    return 0;
+}
+
+// The main loop of the batch child. Never returns.
+static void
+batch_main(int req, int rep)
+{
+    TBatchRequest request;
+    int done = 1;
+    
+    // Until the parent closes the pipe (see t2c_batch_stop()).
+    while (read_all(req, &request, sizeof(request)) == 0)
+    {
+        tet_thistest = request.thistest;
+        tet_setcontext();
+        
+        request.childfunc();
+        
+        fflush(stdout);
+        fflush(stderr);
+        if (write_all(rep, &done, sizeof(done)) != 0)
+        {
+            break;
+        }
+    }
+    
+    exit(EXIT_SUCCESS);
+}
+
+// Create the batch child. Returns 0 on success, -1 otherwise (the error is
+// described in 'buf').
+static int
+batch_start(char* buf)
+{
+    int req[2], rep[2];
+    struct sigaction tsa;
+    
+    int sig;
+    int ch_sig[] = {SIGTERM, SIGALRM, SIGABRT};
+    
+    if (pipe(req) != 0)
+    {
+        sprintf(buf, "t2c_batch_fork: pipe() failed. errno: %d.", errno);
+        return -1;
+    }
+    if (pipe(rep) != 0)
+    {
+        sprintf(buf, "t2c_batch_fork: pipe() failed. errno: %d.", errno);
+        close(req[0]);
+        close(req[1]);
+        return -1;
+    }
+    
+    fflush(stdout);
+    fflush(stderr);
+    
+    batch_pid = fork();
+    switch (batch_pid)
+    {
+    case -1:
+        sprintf(buf, "t2c_batch_fork: fork() failed. errno: %d.", errno);
+        close(req[0]);
+        close(req[1]);
+        close(rep[0]);
+        close(rep[1]);
+        batch_pid = 0;
+        return -1;
+        
+    case 0:
+        /* child process */
+        close(req[1]);
+        close(rep[0]);
+        
+        // Reset signal handlers to default ones.
+        for (sig = 0; sig < sizeof(ch_sig)/sizeof(ch_sig[0]); ++sig)
+        {
+            if (sigaction(ch_sig[sig], (struct sigaction *) 0, &tsa) != -1 && 
+                (tsa.sa_handler != SIG_IGN && tsa.sa_handler != SIG_DFL)) 
+            {
+                tsa.sa_handler = SIG_DFL;
+                sigaction(ch_sig[sig], &tsa, (struct sigaction *) 0);
+            }
+        }
+        
+        batch_main(req[0], rep[1]);
+    }
+    
+    close(req[0]);
+    close(rep[1]);
+    batch_req = req[1];
+    batch_rep = rep[0];
+    batch_pidfd = pidfd_open_child(batch_pid);
+    return 0;
+}
+
+// Forget the batch child, the next test purpose will be executed in a new 
+// one. If it has not been reaped yet, it is killed and reaped here.
+static void
+batch_abandon(int reaped)
+{
+    if (!reaped)
+    {
+        kill(batch_pid, SIGKILL);
+        while (waitpid(batch_pid, NULL, 0) == -1 && errno == EINTR)
+        {
+        }
+    }
+    close(batch_req);
+    close(batch_rep);
+    if (batch_pidfd >= 0)
+    {
+        close(batch_pidfd);
+    }
+    
+    batch_pid = 0;
+    batch_req = -1;
+    batch_rep = -1;
+    batch_pidfd = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_batch_fork()
+int 
+t2c_batch_fork(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms)
+{
+    TBatchRequest request;
+    pid_t savchild;
+    pid_t rtval = -1;
+    int status = 0;
+    int err = 0;
+    int done;
+    int num;
+    char buf[256];
+    struct sigaction new_sa; 
+    struct pollfd fds[2];
+    long long deadline;
+    int slice = 1;
+    
+    int bDone = 0;      // the test purpose has finished, the child is still alive
+    int bClosed = 0;    // the child has closed the reply pipe
+    int bTimedOut = 0;
+    int ret_status = -1;
+    
+    fflush(stdout);
+    fflush(stderr);
+    
+    request.childfunc = childfunc;
+    request.thistest = tet_thistest;
+    
+    // The child may have terminated after the previous test purpose (its 
+    // status is not checked then), so it is created anew in this case too.
+    if ((batch_pid > 0) && (write_all(batch_req, &request, sizeof(request)) != 0))
+    {
+        batch_abandon(0);
+    }
+    if (batch_pid <= 0)
+    {
+        if ((batch_start(buf) != 0) || 
+            (write_all(batch_req, &request, sizeof(request)) != 0))
+        {
+            if (batch_pid > 0)
+            {
+                sprintf(buf, "t2c_batch_fork: the child process has terminated.");
+                batch_abandon(0);
+            }
+            tet_infoline(buf);
+            tet_result(TET_UNRESOLVED);
+            return -1;
+        }
+    }
+    
+    // Save old value of t2c_child in case of recursive calls.
+    savchild = t2c_child;
+    t2c_child = batch_pid;
+    
+    /* if SIGTERM is set to default, catch it so we can propagate 
+       t2c_killwait() */
+    if (sigaction(SIGTERM, (struct sigaction *)NULL, &new_sa) != -1 &&
+        new_sa.sa_handler == SIG_DFL)
+    {
+        new_sa.sa_handler = sig_term;
+        sigaction(SIGTERM, &new_sa, (struct sigaction *)NULL);
+    }
+    
+    tet_setblock();
+    
+    // The parent waits for the reply or for the child to terminate (its 
+    // pidfd becomes readable then). The stops are noticed by waitpid() 
+    // every T2C_WAIT_SLICE_MS (see t2c_wait_child()).
+    deadline = deadline_ms(waittime_ms);
+    for (;;)
+    {
+        rtval = waitpid(batch_pid, &status, WNOHANG | WUNTRACED);
+        err = (rtval == -1) ? errno : 0;
+        if ((rtval == batch_pid) || ((rtval == -1) && (err != EINTR)))
+        {
+            break;  // the child has terminated or stopped
+        }
+        if ((deadline != 0) && (monotonic_ms() >= deadline))
+        {
+            bTimedOut = 1;
+            break;
+        }
+        
+        fds[0].fd = bClosed ? -1 : batch_rep;  // poll() ignores fd -1
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = batch_pidfd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        
+        num = poll(fds, 2, poll_timeout(deadline, 
+            (batch_pidfd < 0) ? next_slice(&slice) : T2C_WAIT_SLICE_MS));
+        if ((num < 0) && (errno != EINTR))
+        {
+            rtval = -1;
+            err = errno;
+            break;
+        }
+        if ((num > 0) && (fds[0].revents != 0))
+        {
+            if (read_all(batch_rep, &done, sizeof(done)) == 0)
+            {
+                bDone = 1;
+                break;
+            }
+            
+            // The child has closed the pipe, it is terminating.
+            bClosed = 1;
+        }
+    }
+    
+    if (bTimedOut)
+    {
+        sprintf(buf, "Child process timed out.");
+        tet_infoline(buf);
+        
+        tet_result(TET_UNRESOLVED);
+        t2c_killwait(batch_pid, t2c_killwait_ms);
+        batch_abandon(1);
+        
+        // Read the child status (see t2c_fork()).
+        read(pcc_pipe_[0], &ret_status, sizeof(int));
+        
+        t2c_child = savchild;
+        return 0;
+    }
+    
+    // Read test status submitted by the test purpose.
+    int pcc_num = read(pcc_pipe_[0], &ret_status, sizeof(int));
+    if (pcc_num != sizeof(int))
+    {
+        sprintf(buf, "t2c_batch_fork: unable to read from the parent-child control pipe, errno: %d.", errno);
+        tet_infoline(buf);
+        ret_status = -1; // something wrong happened
+    }
+    
+    if (bDone)
+    {
+        // For the parent control function, the test purpose has terminated
+        // as the child of t2c_fork() does.
+        rtval = batch_pid;
+        status = 0;
+    }
+    
+    // Check if the test purpose has successfully completed its work.
+    int bStopped = ((rtval == batch_pid) && WIFSTOPPED(status));
+    TParentControlFunc real_pcf = (pcf != NULL) ? pcf : t2c_def_pcf;
+    if (real_pcf(rtval, &status) == 0) // if something went wrong...
+    {
+        sprintf(buf, "Abnormal child process termination. errno: %d.", err);
+        tet_infoline(buf);
+            
+        tet_result(TET_UNRESOLVED);
+        ret_status = -1;
+    }
+    
+    // The next test purpose will be executed in a new child if this one
+    // has not survived. The default PCF kills a stopped child and waits 
+    // for it.
+    if (!bDone)
+    {
+        if (rtval == batch_pid)
+        {
+            batch_abandon(!bStopped || (waitpid(batch_pid, NULL, WNOHANG) == -1));
+        }
+        else
+        {
+            batch_abandon(err == ECHILD);
+        }
+    }
+    
+    t2c_child = savchild;
+    return ret_status;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_batch_stop()
+void 
+t2c_batch_stop()
+{
+    if (batch_pid <= 0)
+    {
+        return;
+    }
+    
+    // The child exits when there are no more requests.
+    close(batch_req);
+    while (waitpid(batch_pid, NULL, 0) == -1 && errno == EINTR)
+    {
+    }
+    close(batch_rep);
+    if (batch_pidfd >= 0)
+    {
+        close(batch_pidfd);
+    }
+    
+    batch_pid = 0;
+    batch_req = -1;
+    batch_rep = -1;
+    batch_pidfd = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_fork_dbg() - debug version of t2c_fork
+int 
+t2c_fork_dbg(TChildFunc childfunc,  TParentControlFunc pcf, int waittime,
+         TUserStartup ustartup, TUserCleanup ucleanup)
+{
+    char buf[256];
+    int ret_status = -1; // failure is assumed by default
+    
+    fflush(stdout);
+    fflush(stderr);
+    
+    int init_failed = 0;
+    char* reason = NULL;
+
+    if (ustartup)
+    {
+        ustartup(&init_failed, &reason);
+    }
+    
+    if (init_failed)
+    {
+        if (reason)
+        {
+            tet_infoline(reason);
+        }
+        tet_result(TET_UNINITIATED);
+        
+        // Write no-PASS test status to the pipe.
+        int st = 0;
+        int pcc_num = write(pcc_pipe_[1], &st, sizeof(int));
+        if (pcc_num != sizeof(int))
+        {
+            sprintf(buf, "t2c_fork_dbg: unable to write to the parent-child control pipe, errno: %d.", errno);
+            tet_infoline(buf);
+        }
+    }
+    else
+    {        
+        // OK, call the "child" function
+        childfunc();
+    }
+    
+    if (ucleanup)
+    {
+        ucleanup();
+    }
+    
+    // Read test status submitted by the "child" function.
+    int pcc_num = read(pcc_pipe_[0], &ret_status, sizeof(int));
+    if (pcc_num != sizeof(int))
+    {
+        sprintf(buf, "t2c_fork_dbg: unable to read from the parent-child control pipe, errno: %d.", errno);
+        tet_infoline(buf);
+        ret_status = -1; // something wrong happened
+    }
+    
+    return ret_status;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// In-process containment of the test purposes (see t2c_fork_contained()).
+
+// The fatal signals a test purpose may cause by itself.
+static const int contained_signals[] = {
+    SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT
+};
+#define CONTAINED_SIGNALS_NUM \
+    (int)(sizeof(contained_signals) / sizeof(contained_signals[0]))
+
+static sigjmp_buf contained_env;
+
+// Nonzero while a test purpose is executed by contained_run().
+static volatile sig_atomic_t contained_active = 0;
+
+// The signal that interrupted the test purpose, 0 if none.
+static volatile sig_atomic_t contained_sig = 0;
+
+// The alternate signal stack, so that stack overflows can be handled too.
+static char* contained_stack = NULL;
+
+// A handler for the fatal signals and SIGALRM.
+static void
+contained_catch(int sig)
+{
+    if (!contained_active)
+    {
+        // Not from a test purpose (or the alarm was late): let the fatal 
+        // signal take its default action.
+        if (sig != SIGALRM)
+        {
+            signal(sig, SIG_DFL);
+            raise(sig);
+        }
+        return;
+    }
+    
+    contained_active = 0;
+    contained_sig = sig;
+    siglongjmp(contained_env, 1);
+}
+
+// Call 'childfunc' with the handlers of the fatal signals installed and
+// the timer set to 'waittime_ms' milliseconds (if it is positive). 
+// Returns the signal that interrupted 'childfunc' (SIGALRM if it timed 
+// out) or 0 if it returned normally.
+static int
+contained_run(TChildFunc childfunc, int waittime_ms)
+{
+    struct sigaction sa;
+    struct sigaction old_sa[CONTAINED_SIGNALS_NUM];
+    struct sigaction old_alrm;
+    stack_t ss;
+    stack_t old_ss;
+    struct itimerval timer;
+    sigset_t alrmset;
+    sigset_t old_mask;
+    int bStack = 0;
+    int i;
+    
+    if (contained_stack == NULL)
+    {
+        contained_stack = (char*)malloc(SIGSTKSZ);
+    }
+    if (contained_stack != NULL)
+    {
+        ss.ss_sp = contained_stack;
+        ss.ss_size = SIGSTKSZ;
+        ss.ss_flags = 0;
+        bStack = (sigaltstack(&ss, &old_ss) == 0);
+    }
+    
+    sa.sa_handler = contained_catch;
+    sa.sa_flags = SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    for (i = 0; i < CONTAINED_SIGNALS_NUM; ++i)
+    {
+        sigaction(contained_signals[i], &sa, &old_sa[i]);
+    }
+    sigaction(SIGALRM, &sa, &old_alrm);
+    
+    sigemptyset(&alrmset);
+    sigaddset(&alrmset, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &alrmset, &old_mask);
+    
+    contained_sig = 0;
+    
+    memset(&timer, 0, sizeof(timer));
+    timer.it_value.tv_sec = waittime_ms / 1000;
+    timer.it_value.tv_usec = (waittime_ms % 1000) * 1000;
+    
+    // siglongjmp() from contained_catch() restores the signal mask too.
+    if (sigsetjmp(contained_env, 1) == 0)
+    {
+        contained_active = 1;
+        if (waittime_ms > 0)
+        {
+            setitimer(ITIMER_REAL, &timer, NULL);
+        }
+        
+        childfunc();
+    }
+    
+    contained_active = 0;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_REAL, &timer, NULL);
+    
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    sigaction(SIGALRM, &old_alrm, NULL);
+    for (i = 0; i < CONTAINED_SIGNALS_NUM; ++i)
+    {
+        sigaction(contained_signals[i], &old_sa[i], NULL);
+    }
+    if (bStack)
+    {
+        sigaltstack(&old_ss, NULL);
+    }
+    
+    return contained_sig;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// t2c_fork_contained()
+int 
+t2c_fork_contained(TChildFunc childfunc, TParentControlFunc pcf, int waittime_ms,
+    TUserStartup ustartup, TUserCleanup ucleanup)
+{
+    char buf[256];
+    int ret_status = -1; // failure is assumed by default
+    int sig = 0;
+    
+    fflush(stdout);
+    fflush(stderr);
+    
+    int init_failed = 0;
+    char* reason = NULL;
+
+    if (ustartup)
+    {
+        ustartup(&init_failed, &reason);
+    }
+    
+    if (init_failed)
+    {
+        if (reason)
+        {
+            tet_infoline(reason);
+        }
+        tet_result(TET_UNINITIATED);
+        
+        // Write no-PASS test status to the pipe.
+        int st = 0;
+        int pcc_num = write(pcc_pipe_[1], &st, sizeof(int));
+        if (pcc_num != sizeof(int))
+        {
+            sprintf(buf, "t2c_fork_contained: unable to write to the parent-child control pipe, errno: %d.", errno);
+            tet_infoline(buf);
+        }
+    }
+    else
+    {        
+        sig = contained_run(childfunc, waittime_ms);
+        if (sig == SIGALRM)
+        {
+            tet_infoline("Test purpose timed out.");
+        }
+        else if (sig != 0)
+        {
+            sprintf(buf, "Test purpose was terminated by signal %d.", sig);
+            tet_infoline(buf);
+        }
+    }
+    
+    // Like the child process in t2c_fork(), a test purpose that crashed
+    // does not get to the cleanup instructions.
+    if (ucleanup && (sig == 0))
+    {
+        ucleanup();
+    }
+    
+    // Read test status submitted by the test purpose. The one interrupted 
+    // by a signal may have left no status in the pipe, so do not block.
+    for (;;)
+    {
+        fd_set rset;
+        struct timeval tv;
+        int st;
+        
+        FD_ZERO(&rset);
+        FD_SET(pcc_pipe_[0], &rset);
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        
+        if ((select(pcc_pipe_[0] + 1, &rset, NULL, NULL, &tv) <= 0) ||
+            (read(pcc_pipe_[0], &st, sizeof(int)) != sizeof(int)))
+        {
+            break;
+        }
+        ret_status = st;
+    }
+    
+    if ((ret_status == -1) && (sig == 0))
+    {
+        sprintf(buf, "t2c_fork_contained: unable to read from the parent-child control pipe, errno: %d.", errno);
+        tet_infoline(buf);
+    }
+    
+    return (sig == 0) ? ret_status : -1;
 }
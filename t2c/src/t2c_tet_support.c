@@ -24,6 +24,7 @@ the 'T2C' test generation framework.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../include/t2c_tet_support.h"
 #include "../include/t2c_trace.h"
@@ -112,11 +113,11 @@ t2c_req_impl(const char* r_id, const char* r_comment,
     {
         TRACE0("One or more application requirements failed.");
         TRACE0("There might be a bug in the test itself. Please report this to the test developer.");
-        tet_result(TET_UNRESOLVED);
+        t2c_result(TET_UNRESOLVED);
     }
     else
     {
-        tet_result(TET_FAIL);
+        t2c_result(TET_FAIL);
     }
     
     free(href_buf);
@@ -151,6 +152,96 @@ t2c_checked_req_out(const char* r_id, int bVerbose)
 
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Capturing the journal output of a test purpose executed concurrently with
+// the others (see t2c_concurrent_fork()).
+
+// Kinds of the records in the capture file
+#define T2C_REC_INFOLINE    0
+#define T2C_REC_PRINTF      1
+#define T2C_REC_RESULT      2
+
+// A record is followed by 'value' bytes of the text, except for a result.
+typedef struct
+{
+    int kind;
+    int value;  // the length of the text or the result code
+} TCaptureRecord;
+
+int t2c_capture_fd = -1;
+
+// Each record is written at once and is not buffered, so the output is not 
+// lost if the test purpose crashes.
+static void
+capture_write(int kind, int value, const char* text)
+{
+    TCaptureRecord rec;
+    size_t len = (text != NULL) ? (size_t)value : 0;
+    char* buf = (char*)malloc(sizeof(rec) + len);
+    
+    if (buf == NULL)
+    {
+        return;
+    }
+    
+    rec.kind = kind;
+    rec.value = value;
+    memcpy(buf, &rec, sizeof(rec));
+    if (len > 0)
+    {
+        memcpy(buf + sizeof(rec), text, len);
+    }
+    
+    if (write(t2c_capture_fd, buf, sizeof(rec) + len) != (ssize_t)(sizeof(rec) + len))
+    {
+        fprintf(stderr, "Unable to write the journal output of the test purpose.\n");
+    }
+    free(buf);
+}
+
+void
+t2c_capture_replay(int fd)
+{
+    TCaptureRecord rec;
+    char* text = NULL;
+    
+    if (lseek(fd, 0, SEEK_SET) == (off_t)-1)
+    {
+        return;
+    }
+    
+    while (read(fd, &rec, sizeof(rec)) == sizeof(rec))
+    {
+        if (rec.kind == T2C_REC_RESULT)
+        {
+            tet_result(rec.value);
+            continue;
+        }
+        
+        if (rec.value < 0)
+        {
+            break;
+        }
+        text = (char*)malloc(rec.value + 1);
+        if ((text == NULL) || (read(fd, text, rec.value) != rec.value))
+        {
+            free(text);
+            break;
+        }
+        text[rec.value] = 0;
+        
+        if (rec.kind == T2C_REC_PRINTF)
+        {
+            t2c_printf("%s", text);
+        }
+        else
+        {
+            tet_infoline(text);
+        }
+        free(text);
+    }
+}
+
 // A replacement for tet_printf that takes 'const char*' instead of 'char*'
 int
 t2c_printf(const char* format, ...)
@@ -159,6 +250,26 @@ t2c_printf(const char* format, ...)
     char* fmt = NULL;
     va_list ap;
     
+    if (t2c_capture_fd >= 0)
+    {
+        va_list aq;
+        char* text = NULL;
+        
+        va_start(ap, format);
+        va_copy(aq, ap);
+        res = vsnprintf(NULL, 0, format, ap);
+        va_end(ap);
+        
+        if ((res >= 0) && ((text = (char*)malloc(res + 1)) != NULL))
+        {
+            vsnprintf(text, res + 1, format, aq);
+            capture_write(T2C_REC_PRINTF, res, text);
+            free(text);
+        }
+        va_end(aq);
+        return res;
+    }
+    
     fmt = strdup(format);
         
     va_start(ap, format);
@@ -170,4 +281,32 @@ t2c_printf(const char* format, ...)
     return res;
 }
 
+void
+t2c_infoline(const char* line)
+{
+    char* str = NULL;
+    
+    if (t2c_capture_fd >= 0)
+    {
+        capture_write(T2C_REC_INFOLINE, (int)strlen(line), line);
+        return;
+    }
+    
+    str = strdup(line);
+    tet_infoline(str);
+    free(str);
+}
+
+void
+t2c_result(int result)
+{
+    if (t2c_capture_fd >= 0)
+    {
+        capture_write(T2C_REC_RESULT, result, NULL);
+        return;
+    }
+    
+    tet_result(result);
+}
+
 // the end
@@ -710,10 +710,12 @@ t2c_rcat_load_impl(FILE* fd, TReqInfoList** ptail)
     int root_opened = 0;
     int root_closed = 0;
 
-    char* rtext = NULL;
+    TStrBuf rtext;
 
     char* pos;
     
+    strbuf_init(&rtext);
+    
     do
     {
         fgets(str, sz, fd);
@@ -757,8 +759,7 @@ t2c_rcat_load_impl(FILE* fd, TReqInfoList** ptail)
                 break;
 
             case T2C_RCAT_OPEN_TAG:  // open tag
-                free(rtext);
-                rtext = strdup("");  // we'll append text to this string later
+                strbuf_free(&rtext);  // we'll append text to this string later
                     
                 if (root_closed)
                 {
@@ -822,13 +823,13 @@ t2c_rcat_load_impl(FILE* fd, TReqInfoList** ptail)
                 if (pos[0] == '<')
                 {
                     // Create a list item with text accumulated in rtext
-                    if (strlen(rtext) == 0)
+                    if (rtext.len == 0)
                     {
                         fprintf(stderr, "Line %d: WARNING: Text is empty for the \"%s\" requirement\n", nLine, attr_id_val[0]);
                     }
                     attr_id_val[0] = t2c_unreplace_special_chars(attr_id_val[0]);
-                    rtext = t2c_unreplace_special_chars(rtext);
-                    tail = t2c_req_info_list_append(tail, attr_id_val[0], rtext);
+                    strbuf_attach(&rtext, t2c_unreplace_special_chars(strbuf_detach(&rtext)));
+                    tail = t2c_req_info_list_append(tail, attr_id_val[0], strbuf_str(&rtext));
                     
                     // Try to parse a closing tag
                     bOK = t2c_parse_close_tag(pos, req_tag[0]);
@@ -858,8 +859,8 @@ t2c_rcat_load_impl(FILE* fd, TReqInfoList** ptail)
                         pos[num - 2] = 0;
                     }
 
-                    rtext = str_append(rtext, pos);
-                    rtext = str_append(rtext, " ");
+                    strbuf_append(&rtext, pos);
+                    strbuf_append_char(&rtext, ' ');
                     
                     // Mode is not changed: mode = T2C_RCAT_BODY;
                 }
@@ -876,7 +877,7 @@ t2c_rcat_load_impl(FILE* fd, TReqInfoList** ptail)
         if (!bOK) break;
     } while(!feof(fd));
 
-    free(rtext);
+    strbuf_free(&rtext);
     free(str);
 
     // cleanup
@@ -0,0 +1,2637 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+
+#include "../include/t2c_util.h"
+#include "../include/libmem.h"
+#include "../include/param.h"
+#include "../include/t2cgen.h"
+
+/*
+ * The core of the code generator: parsing a .t2c-file and generating the code
+ * of the test, its makefile and its scenario record from it (see t2cgen.h).
+ * Nothing here depends on the config file or on where the files are, so the
+ * same code is used by the t2c program (main.c) and by the other users of 
+ * t2cgen.a.
+ */
+
+// The code of the test purposes is written to a temporary file 
+// in chunks of at least this size.
+#define PURPOSES_FLUSH_SIZE 65536
+
+#define PART_FILE_SUFFIX     "_part"       /* <test>_part<N>.c is a part of a test */
+#define GLOBALS_HDR_SUFFIX   "_globals.h"  /* the GLOBAL section for the parts */
+
+/************************************************************************/
+// Sections of a .t2c-file: the tags known to the lexer (see lexer.h).
+static char* section_name[] = {
+    "GLOBAL",
+    "STARTUP",
+    "CLEANUP",    
+    "BLOCK",
+    "TARGETS",
+    "DEFINE",
+    "FINALLY",    
+    "CODE",
+    "PURPOSE",
+    NULL
+};
+
+// Section IDs, top-level sections:
+#define SEC_GLOBAL      0
+#define SEC_STARTUP     1
+#define SEC_CLEANUP     2
+#define SEC_BLOCK       3
+    
+// Sections in the <BLOCK> tag:
+#define SEC_TARGETS     4
+#define SEC_DEFINE      5
+#define SEC_FINALLY     6
+#define SEC_CODE        7
+#define SEC_PURPOSE     8
+
+#define SECTIONS_NUM    9
+
+// Where the sections may begin. A tag of a section found anywhere else
+// is not a tag but a line of text.
+#define LEVEL_TOP       0
+#define LEVEL_BLOCK     1
+
+static const int section_level[SECTIONS_NUM] = {
+    LEVEL_TOP,          // GLOBAL
+    LEVEL_TOP,          // STARTUP
+    LEVEL_TOP,          // CLEANUP
+    LEVEL_TOP,          // BLOCK
+    LEVEL_BLOCK,        // TARGETS
+    LEVEL_BLOCK,        // DEFINE
+    LEVEL_BLOCK,        // FINALLY
+    LEVEL_BLOCK,        // CODE
+    LEVEL_BLOCK         // PURPOSE
+};
+
+#define COMMON_TAGS_NUM     T2CGEN_TEST_TAGS_NUM
+#define GROUP_NAME_POS      0
+#define OBJECT_NAME_POS     1
+#define TEST_PURPOSES_POS   2
+#define TET_HOOKS_POS       3
+#define YEAR_POS            4
+#define LIBRARY_POS         5
+#define LIBSECTION_POS      6
+#define GLOBALS_POS         7
+#define STARTUP_POS         8
+#define CLEANUP_POS         9
+#define FTEMPLATE_POS       10
+#define TP_FUNCS_POS        11
+#define PCF_FUNCS_POS       12
+#define WAIT_TIME_POS       13
+#define RCAT_NAMES_POS      14
+#define SUITE_SUBDIR_POS    15
+#define CONCURRENT_POS      16
+#define TP_CONCURRENT_POS   17
+#define TP_ISOLATED_POS     18
+#define WAIT_TIME_MS_POS    19
+
+static char* common_tags[COMMON_TAGS_NUM] = { 
+    "<%group_name%>",
+    "<%object_name%>",
+    "<%test_purposes%>",
+    "<%tet_hooks%>",
+    "<%year%>",
+    "<%library%>",
+    "<%libsection%>",
+    "<%globals%>",
+    "<%startup%>",
+    "<%cleanup%>",
+    "<%ftemplate%>",
+    "<%tp_funcs%>",
+    "<%pcf_funcs%>",
+    "<%wait_time%>",
+    "<%rcat_names%>",
+    "<%suite_subdir%>",
+    "<%concurrent_purposes%>",
+    "<%tp_concurrent%>",
+    "<%tp_isolated%>",
+    "<%wait_time_ms%>"
+};
+    
+#define MAX_TARGETS_NUM 256
+    
+#define TAGS_NUM 8
+#define COMMENT_TAG_POS  0
+#define DEFINE_TAG_POS   1
+#define CODE_TAG_POS     2
+#define PURPNUM_TAG_POS  3
+#define UNDEF_TAG_POS    4
+#define TARGETS_TAG_POS  5
+#define	LSB_MIN_VER_POS	 6
+#define	LSB_MAX_VER_POS  7
+    
+static char* tags[] = { 
+    "<%comment%>",
+    "<%define%>",
+    "<%code%>",
+    "<%purpose_number%>",
+    "<%undef%>",
+    "<%targets%>",
+    "<%lsb_min_ver%>",
+    "<%lsb_max_ver%>"
+};
+
+#define TAG_FINALLY_NAME "<%finally%>"
+
+// Tags substituted for each test purpose (see PTAG_*_POS in param.h).
+// Purpose parameters (<%0%>, <%1%>, ...) are substituted as well.
+static char* purpose_tags[] = {
+    PARAMS_TAG,
+    PURPNUM_TAG
+};
+    
+// Placeholders for makefile parameters
+static char* mk_params[] = {
+    "<%test_name%>",
+    "<%test_dir_path%>",
+    "<%test_suite_root%>",
+    "<%test_tmp_basename%>",
+    "<%test_parts%>"
+};
+// Positions of makefile parameter placeholders in mk_params[]
+#define MK_PARAM_NUM    (sizeof(mk_params)/sizeof(mk_params[0]))
+#define MK_NAME_POS         0
+#define MK_DIR_PATH_POS     1
+#define MK_SUITE_ROOT_POS   2
+#define MK_TMP_BASENAME_POS 3
+#define MK_PARTS_POS        T2CGEN_MK_PARTS_POS
+
+// Number of params to be extracted from the header of a .t2c-file
+#define HEADER_PARAMS_NUM    T2CGEN_HDR_PARAMS_NUM
+#define PARAM_LIB_POS        0
+#define PARAM_SECTION_POS    1
+#define PARAM_RCAT_POS       2
+#define PARAM_T2C_BASENAME_POS   3
+#define PARAM_CONCURRENT_POS 4
+
+static char* hdr_param_name[HEADER_PARAMS_NUM] = { 
+    "library", 
+    "libsection",
+    "additional_req_catalogues",
+    "t2c_basename",
+    "concurrent_purposes"
+};
+
+/*
+ * Split the test purposes of the test between several files if there are 
+ * more than 'split' of them. 
+ * Returns the number of the last test purpose in the main file.
+ */
+static int
+split_test(TGenContext* ctx, TGenTest* test, int number, int split);
+
+/*
+ * Prepare the GLOBAL section of a test to be split: the variables and
+ * functions defined there stay in the main file but are no longer static
+ * (*main_code), the other parts get a header where they are declared 
+ * (*hdr_code, see split_test() for the rules). 
+ * Returns NULL if it is done, otherwise why the section cannot be shared
+ * this way (nothing is returned in *main_code and *hdr_code then).
+ */
+static const char*
+share_globals(const char* code, int bCpp, char** main_code, char** hdr_code);
+
+static void
+gen_tp_arrays(TGenContext* ctx, int number, int nMain, char** pTetHooks, char** pTpFuncs);
+
+/*
+ * Read the next token of the .t2c-file, ctx->ln_count is set to the number
+ * of its line. Returns 0 at the end of the file, 1 otherwise.
+ */
+static int
+next_token(TGenContext* ctx, TToken* tok);
+
+// The items of the arrays in test.tpl that have an element for each test 
+// purpose: pc_func[], tp_concurrent_[] and tp_isolated_[].
+typedef struct
+{
+    TStrBuf pcf_funcs;
+    TStrBuf concurrent;
+    TStrBuf isolated;
+} TTpArrays;
+
+// The attributes of a BLOCK section that apply to each of its test purposes.
+typedef struct
+{
+    char* pcf_name;     // parentControlFunction, "NULL" by default
+    int bConcurrent;    // concurrent="no" - 0 (see CONCURRENT_PURPOSES)
+    int bIsolated;      // isolated="yes" - 1 (see BATCH_PURPOSES)
+    int bParamTables;   // paramTables="no" - 0 (see PARAM_TABLES)
+} TBlockAttrs;
+
+/*
+Parse the specified file and save the extracted data in the strings (memory for those
+will be allocated if necessary). The code of the test purposes is written to 
+'purposes'. Returns 1 on success, 0 in case of failure.
+*/
+static int
+parse_file(TGenContext* ctx, const char* input_path, const TTemplate* purpose_tpl, int* purposes_number,
+           char** pstrGlobals, char** pstrStartup,
+           char** pstrCleanup, TOutSink* purposes,
+           char** pcf_funcs, char** tp_concurrent, char** tp_isolated);
+
+/*
+Return the contents of a section that are used as is (GLOBAL, STARTUP, 
+CLEANUP, CODE, FINALLY). Returns NULL in case of error (no closing tag), 
+the contents of the section (as a string) otherwise.
+*/
+static char*
+parse_text(TGenContext* ctx, int section);
+
+/*
+Write the code for all purposes in the block to 'out'. Returns 1 on success,
+0 in case of error (the output is incomplete then and should be discarded).
+The items of the arrays for the purposes are added to 'arrays'.
+*/
+static int
+parse_block(TGenContext* ctx, const TTemplate* purpose_tpl, int* purposes_number,
+            TOutSink* out, TTpArrays* arrays, const TBlockAttrs* attrs, 
+            const char *lsb_min_ver, const char *lsb_max_ver);
+
+static char*
+concurrent_defines(const char* value);
+
+/*
+Matches <TARGETS> section. On success, 1 is returned. If the section
+is not found or is invalid (no closing tag, for example), 0 is returned.
+*pstrTargets will be filled with target names, *pnTargets - with their
+quantity.
+*/
+static int 
+parse_targets(TGenContext* ctx, char** pstrTargets, int* pnTargets);
+
+/*
+Matches <DEFINES> section. On success, 1 is returned. If the section
+is not found or is invalid (no closing tag, for example), 0 is returned.
+On success, the contents of the section (as a string) are returned in *pstrDefines,
+appropriate #undefs - in *pstrUndefs.
+*pstrDefineNames will be filled with target names, *pnDefines - with their
+quantity.
+*/
+static int
+parse_defines(TGenContext* ctx, char** pstrDefines, char** pstrUndefs);
+
+/* Read a <PURPOSE> section and fill in the gaps of the template with
+ * purpose number and parameter values. The code of the purpose is written 
+ * to 'out' (the code of each purpose as soon as it is generated). 
+ * Returns 1 on success, 0 in case of error (nothing is written then).
+ */
+static int
+parse_purpose(TGenContext* ctx, const TTemplate* templ, int* purposes_number,
+              TOutSink* out, const TBlockAttrs* attrs);
+
+/* Substitute the contents of the FINALLY section into the code template of
+ * the block and compile the result for parse_purpose().
+ */
+static TTemplate*
+compile_purpose_template(const char* templ, const char* finally_code);
+
+static char*
+replace_char(char* where, char from, char to)
+{
+    char* prval = strchr(where, from);
+    while (prval)
+    {
+        *(prval) = to;
+        prval = strchr(prval + 1, from);
+    }
+    
+    return where;
+}
+
+
+/************************************************************************/
+
+/*
+ * The defaults correspond to an empty config file.
+ */
+void
+t2cgen_settings_init (TGenSettings* cfg)
+{
+    cfg->bGenCpp = 0;
+    cfg->bParamTables = 0;
+    cfg->nSplitPurposes = 0;
+    cfg->wait_time = "30";
+    cfg->year = "2007";
+    cfg->test_dir = "";
+    cfg->on_parse = NULL;
+}
+
+/*
+ * The hash of the version of the generator and of the settings that affect
+ * the generated code, to be a part of the hash of everything a test depends
+ * on in the cache (see gen_cache_check()).
+ */
+THash
+t2cgen_settings_hash (const TGenSettings* cfg)
+{
+    char str[64];
+    THash h = HASH_INIT;
+    
+    sprintf (str, "%d %d %d %d", T2CGEN_VERSION, cfg->bGenCpp, cfg->bParamTables, 
+             cfg->nSplitPurposes);
+    h = hash_string (h, str);
+    h = hash_string (h, cfg->wait_time);
+    h = hash_string (h, cfg->year);
+    return hash_string (h, cfg->test_dir);
+}
+
+/*
+ * The names of the tags for the templates of the given kind (T2CGEN_TPL_*),
+ * to be passed to tpl_compile() or tpl_registry_get(). NULL is returned if 
+ * the kind is unknown.
+ */
+char**
+t2cgen_tpl_tags (int kind, int* nTags)
+{
+    switch (kind)
+    {
+    case T2CGEN_TPL_TEST:
+        *nTags = COMMON_TAGS_NUM;
+        return common_tags;
+    case T2CGEN_TPL_PURPOSE:
+        *nTags = TAGS_NUM;
+        return tags;
+    case T2CGEN_TPL_MAKEFILE:
+        *nTags = MK_PARAM_NUM;
+        return mk_params;
+    default:
+        *nTags = 0;
+        return NULL;
+    }
+}
+
+TTemplate*
+t2cgen_compile_template (int kind, const char* text)
+{
+    int nTags = 0;
+    char** tag_names = t2cgen_tpl_tags (kind, &nTags);
+    
+    if (tag_names == NULL)
+    {
+        return NULL;
+    }
+    return tpl_compile (text, tag_names, nTags, 0);
+}
+
+/*
+ * Prepare the context for processing the .t2c-file 'src'. The statistics 
+ * of the processing are added to *stats. t2cgen_context_free() should be 
+ * called when the file has been processed.
+ */
+void
+t2cgen_context_init (TGenContext* ctx, const TGenSettings* cfg, TSrcFile* src,
+                     TGenStats* stats)
+{
+    int i;
+    
+    ctx->cfg = cfg;
+    ctx->src = src;
+    ctx->ln_count = 0;
+    lexer_init(&ctx->lex, src, section_name);
+    ctx->bInMemory = 0;
+    ctx->shared_tp = NULL;
+    ctx->nShared = 0;
+    ctx->maxShared = 0;
+    ctx->stats = stats;
+    for (i = 0; i < HEADER_PARAMS_NUM; ++i)
+    {
+        ctx->hdr_param_value[i] = NULL;
+    }
+}
+
+void
+t2cgen_context_free (TGenContext* ctx)
+{
+    int i;
+    
+    for (i = 0; i < HEADER_PARAMS_NUM; ++i)
+    {
+        free (ctx->hdr_param_value[i]);
+        ctx->hdr_param_value[i] = NULL;
+    }
+    free (ctx->shared_tp);
+    ctx->shared_tp = NULL;
+    ctx->nShared = 0;
+    ctx->maxShared = 0;
+}
+
+/*
+ * The text of the makefile of the test (or of its rules in the non-recursive
+ * makefile, see FLAT_MAKEFILE), dir_path is the directory of the test. 
+ * The header of the .t2c-file should have been parsed.
+ */
+char*
+t2cgen_render_makefile (const TGenContext* ctx, const char* suite_root, 
+                        const char* dir_path, const char* ftest_nme, 
+                        const TTemplate* makefile_tpl, int nParts)
+{
+    char* mf_str = NULL;
+    char* mk_values[MK_PARAM_NUM];
+    char* t2c_basename = NULL;
+    TStrBuf parts;
+    int i;
+    
+    mk_values[MK_NAME_POS] = (char*)ftest_nme;
+    mk_values[MK_DIR_PATH_POS] = (char*)dir_path;
+    mk_values[MK_SUITE_ROOT_POS] = (char*)suite_root;
+    
+    //-- (begin) - to be deprecated later
+    if ((ctx->hdr_param_value[PARAM_T2C_BASENAME_POS] != NULL) && 
+        (ctx->hdr_param_value[PARAM_T2C_BASENAME_POS][0] != 0))
+    {
+        t2c_basename = strdup(ctx->hdr_param_value[PARAM_T2C_BASENAME_POS]);
+    }
+    else
+    {
+        t2c_basename = strdup(ftest_nme);
+    }
+    mk_values[MK_TMP_BASENAME_POS] = t2c_basename;
+    //-- (end)
+    
+    // the files with the other parts of the test (see split_test())
+    strbuf_init(&parts);
+    for (i = 1; i < nParts; ++i)
+    {
+        char* part_nme = t2cgen_file_name(ctx->cfg, ftest_nme, i);
+        
+        if (i > 1)
+        {
+            strbuf_append(&parts, " ");
+        }
+        strbuf_append(&parts, part_nme);
+        free(part_nme);
+    }
+    mk_values[MK_PARTS_POS] = (char*)strbuf_str(&parts);
+    
+    mf_str = tpl_render(makefile_tpl, mk_values, NULL, 0);
+    free(t2c_basename);
+    strbuf_free(&parts);
+    return mf_str;
+}
+
+/*
+ * The directory of the test: <output_dir>/<ftest_nme>/
+ */
+char*
+t2cgen_test_dir_path (const char* output_dir, const char* ftest_nme)
+{
+    char* path = strdup (output_dir);
+    
+    if ((path[0] == '\0') || (path[strlen (path) - 1] != '/'))
+    {
+        path = str_append (path, "/");
+    }
+    path = str_append (path, ftest_nme);
+    return str_append (path, "/");
+}
+
+/*
+ * The record for the test in the scenario file (with '\n' at the end):
+ * the path to the test relative to the directory of the test suite.
+ */
+char*
+t2cgen_scen_record (const char* suite_root, const char* output_dir, 
+                    const char* ftest_nme)
+{
+    char* scen_item = NULL;
+    char* short_output_dir = NULL;
+
+    short_output_dir = replace_substr_in_string ((char*) output_dir, 
+                                                 suite_root, "");
+    scen_item = str_sum ("\t", (short_output_dir[0] != '/') ? "/" : "");
+    scen_item = str_append (scen_item, short_output_dir);
+    if ((short_output_dir[0] == '\0') ||
+        (short_output_dir[strlen (short_output_dir) - 1] != '/'))
+    {
+        scen_item = str_append (scen_item, "/");
+    }
+    scen_item = str_append (scen_item, ftest_nme);
+    scen_item = str_append (scen_item, "/");
+    scen_item = str_append (scen_item, ftest_nme);
+    scen_item = str_append (scen_item, "\n");
+    
+    free (short_output_dir);
+    return scen_item;
+}
+
+/*
+ * Generate the test described by 'in' in memory. The results are stored in
+ * *out, t2cgen_output_free() should be called for it in any case. Returns 1
+ * on success, 0 if the test cannot be generated (the errors are reported to
+ * stderr).
+ */
+int
+t2cgen_generate (const TGenSettings* cfg, const TGenInput* in, TGenOutput* out)
+{
+    TGenContext ctx;
+    TGenTest test;
+    TSrcFile src;
+    TTemplate* test_tpl = NULL;
+    TTemplate* purpose_tpl = NULL;
+    TTemplate* part_tpl = NULL;
+    TTemplate* mk_tpl = NULL;
+    char* dir_path = NULL;
+    int split = 0;
+    int bOK = 0;
+    int i;
+    
+    out->nFiles = 0;
+    out->file_names = NULL;
+    out->files = NULL;
+    out->makefile = NULL;
+    out->scen_record = NULL;
+    stats_init (&out->stats);
+    
+    src_open_mem (&src, in->src, in->src_size);
+    t2cgen_context_init (&ctx, cfg, &src, &out->stats);
+    ctx.bInMemory = 1;
+    t2cgen_parse_header (&ctx);
+    out->stats.bytes_in += (long long)src.size;
+    
+    test_tpl = t2cgen_compile_template (T2CGEN_TPL_TEST, in->test_tpl);
+    purpose_tpl = t2cgen_compile_template (T2CGEN_TPL_PURPOSE, in->purpose_tpl);
+    if (in->part_tpl != NULL)
+    {
+        part_tpl = t2cgen_compile_template (T2CGEN_TPL_TEST, in->part_tpl);
+    }
+    if (in->mk_tpl != NULL)
+    {
+        mk_tpl = t2cgen_compile_template (T2CGEN_TPL_MAKEFILE, in->mk_tpl);
+    }
+    
+    // the test is split only if its makefile knows about the parts
+    if ((part_tpl != NULL) && ((mk_tpl == NULL) || tpl_has_tag (mk_tpl, MK_PARTS_POS)))
+    {
+        split = cfg->nSplitPurposes;
+    }
+    
+    if (t2cgen_prepare (&ctx, purpose_tpl, in->input_path, in->group_nme, 
+                        in->test_nme, split, &test))
+    {
+        bOK = 1;
+        out->nFiles = test.nParts + ((test.globals_hdr != NULL) ? 1 : 0);
+        out->file_names = (char**)alloc_mem (NULL, out->nFiles, sizeof (char*));
+        out->files = (char**)alloc_mem (NULL, out->nFiles, sizeof (char*));
+        for (i = 0; i < test.nParts; ++i)
+        {
+            out->file_names[i] = t2cgen_file_name (cfg, in->test_nme, i);
+            out->files[i] = t2cgen_render_test ((i == 0) ? test_tpl : part_tpl, 
+                                                &test, i);
+            if (out->files[i] == NULL)
+            {
+                bOK = 0;
+                continue;
+            }
+            out->stats.bytes_out += (long long)strlen (out->files[i]);
+        }
+        if (test.globals_hdr != NULL)
+        {
+            out->file_names[i] = t2cgen_globals_hdr_name (in->test_nme);
+            out->files[i] = strdup (test.globals_hdr);
+            out->stats.bytes_out += (long long)strlen (out->files[i]);
+        }
+        
+        dir_path = t2cgen_test_dir_path (in->output_dir, in->test_nme);
+        if (mk_tpl != NULL)
+        {
+            out->makefile = t2cgen_render_makefile (&ctx, in->suite_root, dir_path, 
+                                                    in->test_nme, mk_tpl, test.nParts);
+        }
+        out->scen_record = t2cgen_scen_record (in->suite_root, in->output_dir, 
+                                               in->test_nme);
+        free (dir_path);
+    }
+    
+    if (bOK)
+    {
+        ++out->stats.nFiles;
+    }
+    else
+    {
+        ++out->stats.nFailed;
+    }
+    
+    t2cgen_free_test (&test);
+    t2cgen_context_free (&ctx);
+    src_close (&src);
+    tpl_free (test_tpl);
+    tpl_free (purpose_tpl);
+    tpl_free (part_tpl);
+    tpl_free (mk_tpl);
+    return bOK;
+}
+
+void
+t2cgen_output_free (TGenOutput* out)
+{
+    int i;
+    
+    for (i = 0; i < out->nFiles; ++i)
+    {
+        free (out->file_names[i]);
+        free (out->files[i]);
+    }
+    free (out->file_names);
+    free (out->files);
+    free (out->makefile);
+    free (out->scen_record);
+    out->nFiles = 0;
+    out->file_names = NULL;
+    out->files = NULL;
+    out->makefile = NULL;
+    out->scen_record = NULL;
+}
+
+/*
+ * Parse the .t2c-file and prepare the code of the test, the header should
+ * have been parsed already (see t2cgen_parse_header()). The code of the test
+ * purposes is written to a temporary file unless ctx->bInMemory is set.
+ * Returns 1 on success, 0 otherwise. t2cgen_free_test() should be called 
+ * for 'test' in any case.
+ */
+int
+t2cgen_prepare (TGenContext* ctx, const TTemplate* purpose_tpl, const char* input_path, 
+                const char* group_nme, const char* test_nme, int split, TGenTest* test)
+{
+    int i;
+    int purposes_num = 0;
+    int nMain = 0;
+    int wait_ms = 0;
+    char num_buf[32];
+
+    char** common_tag_values = test->tag_values;
+    
+    int bOK = 1;
+    
+    double t_start = stats_time();
+    double t_parsed;
+    double t_purposes = ctx->stats->phase_time[PHASE_PURPOSES];
+
+    for (i = 0; i < COMMON_TAGS_NUM; i++)
+    {
+        common_tag_values[i] = NULL;
+    }
+    
+    test->nParts = 1;
+    test->part_off = NULL;
+    test->part_funcs = NULL;
+    test->globals_hdr = NULL;
+    
+    // If no temporary file can be created, the code is kept in memory.
+    sink_init(&test->purposes, ctx->bInMemory ? NULL : tmpfile(), 
+              PURPOSES_FLUSH_SIZE);
+    
+    // where each test purpose ends in the code, to split the test
+    test->purposes.bMarks = (split > 0);
+
+    bOK = parse_file(ctx, input_path, purpose_tpl, &purposes_num, 
+        &(common_tag_values[GLOBALS_POS]), 
+        &(common_tag_values[STARTUP_POS]),
+        &(common_tag_values[CLEANUP_POS]),
+        &test->purposes,
+        &(common_tag_values[PCF_FUNCS_POS]),
+        &(common_tag_values[TP_CONCURRENT_POS]),
+        &(common_tag_values[TP_ISOLATED_POS]));
+    
+    // The time spent on the purposes has been accounted separately.
+    t_parsed = stats_time();
+    ctx->stats->phase_time[PHASE_SECTIONS] += (t_parsed - t_start) - 
+        (ctx->stats->phase_time[PHASE_PURPOSES] - t_purposes);
+    
+    if ((!bOK) || (test_nme == NULL)) 
+    { 
+        return 0;
+    }
+    
+    sink_flush(&test->purposes, 1);
+    if (test->purposes.error)
+    {
+        fprintf(stderr, "Failed to write the code of the test purposes to a temporary file.\n");
+        return 0;
+    }
+
+    common_tag_values[GROUP_NAME_POS]   = (char*)strdup(group_nme); 
+    common_tag_values[OBJECT_NAME_POS]  = (char*)strdup(test_nme);
+    common_tag_values[FTEMPLATE_POS]    = (char*)strdup(input_path);
+    
+    // The functions that take the time limit in seconds get it rounded up.
+    wait_ms = t2cgen_wait_time_ms(ctx->cfg->wait_time);
+    sprintf(num_buf, "%d", (wait_ms / 1000) + ((wait_ms % 1000) ? 1 : 0));
+    common_tag_values[WAIT_TIME_POS]    = (char*)strdup(num_buf);
+    sprintf(num_buf, "%d", wait_ms);
+    common_tag_values[WAIT_TIME_MS_POS] = (char*)strdup(num_buf);
+    
+    nMain = purposes_num;
+    if ((split > 0) && (purposes_num > split))
+    {
+        char* main_globals = NULL;
+        char* hdr_globals = NULL;
+        const char* reason = share_globals(common_tag_values[GLOBALS_POS], 
+                                           ctx->cfg->bGenCpp, &main_globals, &hdr_globals);
+        
+        if (reason != NULL)
+        {
+            fprintf(stderr, "warning: the GLOBAL section of %s %s, "
+                "the test is not split\n", test_nme, reason);
+        }
+        else
+        {
+            nMain = split_test(ctx, test, purposes_num, split);
+        }
+        
+        if (test->nParts > 1)
+        {
+            free(common_tag_values[GLOBALS_POS]);
+            common_tag_values[GLOBALS_POS] = main_globals;
+            
+            test->globals_hdr = str_sum(
+                "// This file was generated by the T2C system. The variables and functions\n"
+                "// defined in the GLOBAL section of the test are declared here for its\n"
+                "// parts other than ", test_nme);
+            test->globals_hdr = str_append(test->globals_hdr, 
+                ctx->cfg->bGenCpp ? ".cpp.\n\n" : ".c.\n\n");
+            test->globals_hdr = str_append(test->globals_hdr, hdr_globals);
+            test->globals_hdr = str_append(test->globals_hdr, "\n");
+        }
+        else
+        {
+            free(main_globals);
+        }
+        free(hdr_globals);
+    }
+    
+    gen_tp_arrays(ctx, purposes_num, nMain, &common_tag_values[TET_HOOKS_POS], &common_tag_values[TP_FUNCS_POS]);
+        
+   
+    common_tag_values[YEAR_POS] = strdup(ctx->cfg->year);
+    common_tag_values[LIBRARY_POS] = strdup(ctx->hdr_param_value[PARAM_LIB_POS]);
+    common_tag_values[LIBSECTION_POS] = strdup(ctx->hdr_param_value[PARAM_SECTION_POS]);
+    
+    replace_char(common_tag_values[LIBRARY_POS], '\n', ' ');
+    replace_char(common_tag_values[LIBRARY_POS], '\r', ' ');
+    replace_char(common_tag_values[LIBSECTION_POS], '\n', ' ');
+    replace_char(common_tag_values[LIBSECTION_POS], '\r', ' ');
+
+    // Prepare the list of additional req catalogues
+    {
+        const char* delims = " ,;\t";
+        char* token = NULL;
+        char* pos = NULL;
+        TStrBuf rcats;
+        
+        strbuf_init(&rcats);
+        token = strtok_r(ctx->hdr_param_value[PARAM_RCAT_POS], delims, &pos);
+        while (token)
+        {
+            strbuf_append(&rcats, "    \"");
+            strbuf_append(&rcats, token);
+            strbuf_append(&rcats, "\",\n");
+            token = strtok_r(NULL, delims, &pos);
+        }
+        common_tag_values[RCAT_NAMES_POS] = strbuf_detach(&rcats);
+    }   
+    
+    common_tag_values[SUITE_SUBDIR_POS] = strdup(ctx->cfg->test_dir);
+    common_tag_values[CONCURRENT_POS] = concurrent_defines(ctx->hdr_param_value[PARAM_CONCURRENT_POS]);
+    
+    ctx->stats->nPurposes += purposes_num;
+    ctx->stats->phase_time[PHASE_TEMPLATES] += stats_time() - t_parsed;
+    return 1;
+}
+
+/*
+ * The code of the test purposes in part 'part' of the test (see split_test())
+ * followed by part_funcs[part]. NULL is returned if it cannot be read.
+ */
+static char*
+read_part(TGenTest* test, int part)
+{
+    char* code = NULL;
+    
+    if (test->nParts == 1)
+    {
+        return sink_read(&test->purposes, 0, 
+                         test->purposes.written + (long long)test->purposes.buf.len);
+    }
+    
+    // Only the code of this part is read into memory.
+    code = sink_read(&test->purposes, 
+                     (part > 0) ? test->part_off[part - 1] : 0, 
+                     test->part_off[part]);
+    if (code == NULL)
+    {
+        return NULL;
+    }
+    return str_append(code, test->part_funcs[part]);
+}
+
+/*
+ * Write the files of the test prepared by t2cgen_prepare() to the directory
+ * dir_path (ending with '/'): <test>.c made from test_tpl and, if the test
+ * is split, the other parts made from part_tpl and <test>_globals.h. 
+ * A file is left as it is if its contents have not changed, so that it is 
+ * not compiled again. Returns 1 on success, 0 if a file cannot be written
+ * (the error is reported to stderr).
+ */
+int
+t2cgen_write_files (const TGenSettings* cfg, TGenTest* test, 
+                    const TTemplate* test_tpl, const TTemplate* part_tpl,
+                    const char* dir_path, const char* ftest_nme, TGenStats* stats)
+{
+    FILE* fl;
+    TOutFile of;
+    char* nme = NULL;
+    char* path = NULL;
+    int bOK = 1;
+    int i;
+    
+    for (i = 0; (i <= test->nParts) && bOK; ++i)
+    {
+        if (i < test->nParts)
+        {
+            nme = t2cgen_file_name (cfg, ftest_nme, i);
+        }
+        else if (test->globals_hdr != NULL)
+        {
+            nme = t2cgen_globals_hdr_name (ftest_nme);
+        }
+        else
+        {
+            break;
+        }
+        path = str_sum (dir_path, nme);
+        
+        fl = out_file_open (&of, path);
+        if (i < test->nParts)
+        {
+            bOK = (fl != NULL) && 
+                  t2cgen_write_test (fl, (i == 0) ? test_tpl : part_tpl, test, i);
+        }
+        else
+        {
+            bOK = (fl != NULL) && (fputs (test->globals_hdr, fl) >= 0);
+        }
+        
+        if (bOK)
+        {
+            stats->bytes_out += (long long)ftell (fl);
+            bOK = out_file_commit (&of);
+        }
+        else
+        {
+            out_file_discard (&of);
+        }
+        if (!bOK)
+        {
+            fprintf (stderr, "Failed to write the test to %s\n", path);
+        }
+        free (nme);
+        free (path);
+    }
+    return bOK;
+}
+
+/*
+ * Write the code of the test (part 'part' of it, see split_test()) to 'out'. 
+ * Returns 0 if an error occurs, 1 otherwise.
+ */
+int
+t2cgen_write_test(FILE* out, const TTemplate* test_tpl, TGenTest* test, int part)
+{
+    FILE* streams[COMMON_TAGS_NUM];
+    char* code = NULL;
+    int bOK;
+    int i;
+    
+    for (i = 0; i < COMMON_TAGS_NUM; i++)
+    {
+        streams[i] = NULL;
+    }
+    
+    if (test->nParts > 1)
+    {
+        code = read_part(test, part);
+        if (code == NULL)
+        {
+            return 0;
+        }
+        
+        test->tag_values[TEST_PURPOSES_POS] = code;
+        bOK = tpl_write(out, test_tpl, test->tag_values, NULL, NULL, 0);
+        test->tag_values[TEST_PURPOSES_POS] = NULL;
+        free(code);
+        return bOK;
+    }
+    
+    if (test->purposes.fl != NULL)
+    {
+        streams[TEST_PURPOSES_POS] = test->purposes.fl;
+    }
+    else
+    {
+        test->tag_values[TEST_PURPOSES_POS] = (char*)strbuf_str(&test->purposes.buf);
+    }
+    
+    /* do all substitutions */
+    return tpl_write(out, test_tpl, test->tag_values, streams, NULL, 0);
+}
+
+/*
+ * The code of the test (part 'part' of it) as a string, NULL if an error 
+ * occurs.
+ */
+char*
+t2cgen_render_test(const TTemplate* test_tpl, TGenTest* test, int part)
+{
+    char* code = NULL;
+    char* res = NULL;
+    
+    if ((test->nParts == 1) && (test->purposes.fl == NULL))
+    {
+        test->tag_values[TEST_PURPOSES_POS] = (char*)strbuf_str(&test->purposes.buf);
+        return tpl_render(test_tpl, test->tag_values, NULL, 0);
+    }
+    
+    code = read_part(test, part);
+    if (code == NULL)
+    {
+        return NULL;
+    }
+    test->tag_values[TEST_PURPOSES_POS] = code;
+    res = tpl_render(test_tpl, test->tag_values, NULL, 0);
+    test->tag_values[TEST_PURPOSES_POS] = NULL;
+    free(code);
+    return res;
+}
+
+void
+t2cgen_free_test(TGenTest* test)
+{
+    int i;
+    
+    test->tag_values[TEST_PURPOSES_POS] = NULL;   // owned by test->purposes
+    for (i = 0; i < COMMON_TAGS_NUM; i++)
+    {
+        free(test->tag_values[i]);
+        test->tag_values[i] = NULL;
+    }
+    
+    if (test->purposes.fl != NULL)
+    {
+        fclose(test->purposes.fl);
+    }
+    sink_free(&test->purposes);
+    
+    if (test->part_funcs != NULL)
+    {
+        for (i = 0; i < test->nParts; i++)
+        {
+            free(test->part_funcs[i]);
+        }
+    }
+    free(test->part_funcs);
+    free(test->part_off);
+    free(test->globals_hdr);
+    test->part_funcs = NULL;
+    test->globals_hdr = NULL;
+    test->part_off = NULL;
+    test->nParts = 1;
+}
+
+/*
+ * The number of the test purposes to be executed at the same time according
+ * to the value of CONCURRENT_PURPOSES (in the config file) or 
+ * concurrent_purposes (in the header of a .t2c-file): N > 0, "auto" 
+ * (0 is returned, the number of the processors is used) or anything else 
+ * ("no", "0", ...) if the purposes should be executed one by one (-1 is 
+ * returned). The value is passed to the test as T2C_CONCURRENT_PURPOSES.
+ */
+int
+t2cgen_concurrency(const char* value)
+{
+    int num;
+    
+    if (!strcmp(value, "auto") || !strcmp(value, "AUTO"))
+    {
+        return 0;
+    }
+    
+    num = atoi(value);
+    return (num > 0) ? num : -1;
+}
+
+/*
+ * The time limit specified by WAIT_TIME or KILL_WAIT (in the config file),
+ * in milliseconds: "N" means N seconds, "Nms" - N milliseconds. 0 is
+ * returned if the value is not a positive number (no time limit).
+ */
+int
+t2cgen_wait_time_ms(const char* value)
+{
+    char* end = NULL;
+    long num = strtol(value, &end, 10);
+    
+    if ((end == value) || (num <= 0))
+    {
+        return 0;
+    }
+    
+    if (!strcmp(end, "ms") || !strcmp(end, "MS"))
+    {
+        return (num < INT_MAX) ? (int)num : INT_MAX;
+    }
+    return (num < INT_MAX / 1000) ? (int)num * 1000 : (INT_MAX / 1000) * 1000;
+}
+
+// The lines for <%concurrent_purposes%>: concurrent_purposes in the header
+// of a .t2c-file overrides CONCURRENT_PURPOSES for this test.
+static char*
+concurrent_defines(const char* value)
+{
+    char buf[128];
+    int num;
+    
+    if (value[0] == 0)
+    {
+        return strdup("");
+    }
+    
+    num = t2cgen_concurrency(value);
+    if (num < 0)
+    {
+        return strdup("#undef T2C_CONCURRENT_PURPOSES\n");
+    }
+    
+    sprintf(buf, "#undef T2C_CONCURRENT_PURPOSES\n#define T2C_CONCURRENT_PURPOSES %d\n", num);
+    return strdup(buf);
+}
+
+/* 
+ * Extract data from the T2C-file header (library, libsection etc.) and
+ * store them in ctx->hdr_param_value[] (see hdr_param_name[]).
+ * The lines of ctx->src are not changed, so the file can be parsed again after
+ * src_rewind(). If some parameter is not found in the file, an empty string 
+ * is returned as its value.
+ */
+void
+t2cgen_parse_header(TGenContext* ctx)
+{
+    int i;
+    
+    char* line = NULL;
+    char* tstr = NULL;  // temporary
+    char* str_t = NULL; // temporary
+    
+    char* beg_ln = NULL;
+    
+    TStrBuf str;
+    
+    for (i = 0; i < HEADER_PARAMS_NUM; ++i)
+    {
+        ctx->hdr_param_value[i] = strdup("");
+    }
+    
+    strbuf_init(&str);
+    while ((line = src_next_line(ctx->src)) != NULL)
+    {
+        ++ctx->ln_count;
+        
+        // trim a copy of the line, the file will be parsed again
+        str.len = 0;
+        strbuf_append(&str, line);
+        strbuf_trim(&str, " \n\t");
+        tstr = str.str;
+       
+        for (i = 0; i < HEADER_PARAMS_NUM; ++i)
+        {   
+            if (tstr[0] == '#')
+            {
+                beg_ln = strstr(tstr + 1, hdr_param_name[i]);
+                if (beg_ln == tstr + 1)
+                {
+                    beg_ln = beg_ln + strlen(hdr_param_name[i]);
+                    if ((beg_ln[0] == ' ') || (beg_ln[0] == '\t'))
+                    {
+                        str_t = trim_with_nl(beg_ln);
+                        
+                        free(ctx->hdr_param_value[i]);
+                        ctx->hdr_param_value[i] = strdup(str_t);
+                    }
+                    break;
+                }
+            }
+        } /*end for*/
+        
+        if ((tstr[0] != 0) && (tstr[0] != '#'))
+        {
+            break;
+        }
+    }
+    
+    strbuf_free(&str);
+}
+
+static int
+next_token(TGenContext* ctx, TToken* tok)
+{
+    int res = lexer_next(&ctx->lex, tok);
+    
+    ctx->ln_count = ctx->lex.line;
+    return res;
+}
+
+static int
+parse_file(TGenContext* ctx, const char* input_path, const TTemplate* purpose_tpl, int* purposes_number,
+           char** pstrGlobals, char** pstrStartup,
+           char** pstrCleanup, TOutSink* purposes,
+           char** pcf_funcs, char** tp_concurrent, char** tp_isolated)
+{
+    char* text = NULL;
+    char* lsb_min_ver = NULL;
+    char* lsb_max_ver = NULL;
+    
+    int nBlocks = 0;
+    int isBad = 0;
+    
+    TTpArrays arrays;
+    TBlockAttrs attrs;
+    TToken tok;
+
+    // reset line count
+    ctx->ln_count = 0;
+    if (ctx->cfg->on_parse != NULL)
+    {
+        ctx->cfg->on_parse (input_path);
+    }
+    
+    *purposes_number = 0;
+
+    if (ctx->src->size <= 2)
+    {
+        return 0;
+    }
+    src_rewind(ctx->src);
+    lexer_init(&ctx->lex, ctx->src, section_name);
+
+    *pstrGlobals = strdup("");
+    *pstrStartup = strdup("");
+    *pstrCleanup = strdup("");
+    strbuf_init(&arrays.pcf_funcs);
+    strbuf_init(&arrays.concurrent);
+    strbuf_init(&arrays.isolated);
+    
+    // Where the contents of the top-level text sections go.
+    char** top_text[SECTIONS_NUM] = {pstrGlobals, pstrStartup, pstrCleanup, NULL};
+    
+    char* attribs = NULL; 
+    char* bl_attr_name[] = {"parentControlFunction", "lsbMinVersion", "lsbMaxVersion", 
+                            "concurrent", "isolated", "paramTables", NULL};
+    char* bl_attr_val[]  = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    
+
+    while (next_token(ctx, &tok))
+    {
+        if ((tok.kind != TOKEN_OPEN) || (section_level[tok.tag] != LEVEL_TOP))
+        {
+            continue;   // not a tag
+        }
+        
+        if (tok.tag != SEC_BLOCK)
+        {
+            /* found GLOBAL, STARTUP or CLEANUP */
+            text = parse_text(ctx, tok.tag);
+            if (text == NULL) 
+            {
+                isBad = 1;
+                fprintf (stderr, "Line %d: Invalid %s section.\n", ctx->ln_count, 
+                    section_name[tok.tag]);
+                break;
+            }
+            
+            free(*top_text[tok.tag]);
+            *top_text[tok.tag] = text;
+            continue;
+        }
+        
+        // Parse attributes, extract PCF name (if present).
+        free(attribs);
+        attribs = (tok.attribs != NULL) ? 
+            get_substr(tok.attribs, 0, (long)tok.attribs_len - 1) : NULL;
+        if (!t2c_parse_attributes(attribs, bl_attr_name, bl_attr_val))
+        {
+            isBad = 1;
+            fprintf (stderr, "Line %d: Invalid attribute specification for <BLOCK> section.\n", ctx->ln_count);
+            break;
+        }
+        
+        if (bl_attr_val[0])
+        {
+            attrs.pcf_name = bl_attr_val[0];
+            bl_attr_val[0] = NULL;
+        }
+        else
+        {
+            attrs.pcf_name = strdup("NULL");
+        }
+        
+        if (bl_attr_val[1])
+        {
+            lsb_min_ver = bl_attr_val[1];
+            bl_attr_val[1] = NULL;
+        }
+        else
+        {
+            lsb_min_ver = strdup("NULL");
+        }
+        
+        if (bl_attr_val[2])
+        {
+            lsb_max_ver = bl_attr_val[2];
+            bl_attr_val[2] = NULL;
+        }
+        else
+        {
+            lsb_max_ver = strdup("NULL");
+        }
+        
+        // concurrent="no": the purposes of the block are never executed
+        // at the same time as the other ones (see CONCURRENT_PURPOSES).
+        attrs.bConcurrent = 1;
+        if (bl_attr_val[3])
+        {
+            attrs.bConcurrent = (strcmp(bl_attr_val[3], "no") && strcmp(bl_attr_val[3], "NO"));
+            free(bl_attr_val[3]);
+            bl_attr_val[3] = NULL;
+        }
+        
+        // isolated="yes": each purpose of the block is executed in a process
+        // of its own (see BATCH_PURPOSES).
+        attrs.bIsolated = 0;
+        if (bl_attr_val[4])
+        {
+            attrs.bIsolated = (!strcmp(bl_attr_val[4], "yes") || !strcmp(bl_attr_val[4], "YES"));
+            free(bl_attr_val[4]);
+            bl_attr_val[4] = NULL;
+        }
+        
+        // paramTables="no": the code is generated for each combination of 
+        // the parameter values even if PARAM_TABLES is "yes", e.g. when the 
+        // parameters are used where a constant expression is required.
+        attrs.bParamTables = 1;
+        if (bl_attr_val[5])
+        {
+            attrs.bParamTables = (strcmp(bl_attr_val[5], "no") && strcmp(bl_attr_val[5], "NO"));
+            free(bl_attr_val[5]);
+            bl_attr_val[5] = NULL;
+        }
+        
+        int ln_beg = ctx->ln_count;
+        int bBlockOK = parse_block(ctx, purpose_tpl, purposes_number, purposes, &arrays,
+                                   &attrs, lsb_min_ver, lsb_max_ver);
+        ++ctx->stats->nBlocks;
+
+        free (lsb_max_ver);
+        free (lsb_min_ver);
+        free(attrs.pcf_name);
+        
+        if (!bBlockOK) 
+        {
+            isBad = 1;
+            fprintf (stderr, 
+                "Line %d: The BLOCK section that begins at line %d is invalid.\n", 
+                ctx->ln_count, ln_beg);
+            break;
+        }
+
+        ++nBlocks;
+    }
+
+    *pcf_funcs = strbuf_detach(&arrays.pcf_funcs);
+    *tp_concurrent = strbuf_detach(&arrays.concurrent);
+    *tp_isolated = strbuf_detach(&arrays.isolated);
+    
+    int i;
+    for (i = 0; i < sizeof(bl_attr_val)/sizeof(bl_attr_val[0]) - 1; ++i)
+    {
+        free(bl_attr_val[i]);
+    }
+
+    free(attribs);
+    return ((!isBad) && (nBlocks > 0));
+}
+
+static char*
+parse_text(TGenContext* ctx, int section)
+{
+    char* text = NULL;
+    TStrBuf buf;
+    TToken tok;
+    int isBad = 0;
+
+    strbuf_init (&buf);
+    
+    int close_tag_found = 0;
+    while (next_token(ctx, &tok))
+    {
+        if ((tok.kind == TOKEN_CLOSE) && (tok.tag == section))
+        {
+            close_tag_found = 1;
+            break;
+        }
+        else
+        {
+            strbuf_append (&buf, tok.str);
+        }
+    }
+    
+    if (!close_tag_found)
+    {
+        fprintf (stderr, "Line %d: No close tag found for %s section.\n", ctx->ln_count,
+            section_name[section]);
+        isBad = 1;
+    }
+    
+    text = strbuf_detach (&buf);
+    if (isBad && text)
+    {
+        free(text);
+    }
+
+    return ((isBad) ? NULL : text);
+}
+
+// Add the items for a test purpose to the arrays.
+static void
+add_tp_items(TTpArrays* arrays, const TBlockAttrs* attrs)
+{
+    strbuf_append(&arrays->pcf_funcs, "    ");
+    strbuf_append(&arrays->pcf_funcs, attrs->pcf_name);
+    strbuf_append(&arrays->pcf_funcs, ",\n");
+    
+    strbuf_append(&arrays->concurrent, (attrs->bConcurrent ? "    1,\n" : "    0,\n"));
+    strbuf_append(&arrays->isolated, (attrs->bIsolated ? "    1,\n" : "    0,\n"));
+}
+
+static int
+parse_block(TGenContext* ctx, const TTemplate* purpose_tpl, int* purposes_number,
+            TOutSink* out, TTpArrays* arrays, const TBlockAttrs* attrs, 
+            const char *lsb_min_ver, const char *lsb_max_ver)
+{
+
+    int isBad = 0;
+    TToken tok;
+    
+    char* targets[MAX_TARGETS_NUM];            
+
+    int nTargets = 0;    
+
+    int isCodeFound = 0;
+    int isEndFound = 0;
+    int isDefineFound = 0;
+    int isTargetFound = 0;
+    int isPurposeFound = 0;
+
+    char* templ = NULL;
+    char* finally_code = NULL;
+    char* tag_values[TAGS_NUM];
+    TTemplate* purp_tpl = NULL;    // compiled templ + finally_code
+    
+    int i = 0;
+    int ln_beg = ctx->ln_count;
+        
+    for (i = 0; i < MAX_TARGETS_NUM; ++i)
+    {
+        targets[i] = NULL;
+    }
+    
+    for (i = 0; i < TAGS_NUM; ++i)
+    {
+        tag_values[i] = NULL;
+    }
+    /* tag_values[PURPNUM_TAG_POS] remains NULL: the tag is left as is and 
+       will be substituted for each test purpose */
+    tag_values[COMMENT_TAG_POS] = strdup("// Target interfaces:\n");
+    tag_values[TARGETS_TAG_POS] = strdup("Target interface(s):\\n");
+    
+    if (strcmp (lsb_min_ver, STRING_NULL) == 0)
+    {
+    	tag_values[LSB_MIN_VER_POS] = strdup (lsb_min_ver);
+		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_SEMICOLON);
+    }
+	else
+	{
+    	tag_values[LSB_MIN_VER_POS] = strdup (STRING_APOSTR);
+		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], lsb_min_ver);
+		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_APOSTR);
+		tag_values[LSB_MIN_VER_POS] = str_append (tag_values[LSB_MIN_VER_POS], STRING_SEMICOLON);
+	}
+    
+    if (strcmp (lsb_max_ver, STRING_NULL) == 0)
+    {
+    	tag_values[LSB_MAX_VER_POS] = strdup (lsb_max_ver);
+		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_SEMICOLON);
+    }
+	else
+	{
+    	tag_values[LSB_MAX_VER_POS] = strdup (STRING_APOSTR);
+		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], lsb_max_ver);
+		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_APOSTR);
+		tag_values[LSB_MAX_VER_POS] = str_append (tag_values[LSB_MAX_VER_POS], STRING_SEMICOLON);
+	}
+    
+    finally_code = strdup("");
+
+    while (next_token(ctx, &tok))
+    {
+        int old_purp_num = 0;
+        
+        if ((tok.kind == TOKEN_CLOSE) && (tok.tag == SEC_BLOCK))
+        {
+        	
+            if (!isCodeFound)
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: No CODE section is specified in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            if (!isPurposeFound) // no purpose found => assume there is one with no parameters.
+            {
+                if (!templ)
+                {
+                    isBad = 1;
+                    fprintf(stderr, 
+                        "Line %d: Code template is invalid in the BLOCK beginning at line %d.\n",
+                        ctx->ln_count, ln_beg);
+                    break;
+                }
+                
+                char strTmp[16] = "";
+                char* purp_values[PTAGS_NUM];
+                
+                ++(*purposes_number);
+                                        
+                isPurposeFound = 1;
+                
+                if (!purp_tpl)
+                {
+                    purp_tpl = compile_purpose_template (templ, finally_code);
+                }
+
+                sprintf (strTmp, "%d", *purposes_number);
+                purp_values[PTAG_PARAMS_POS] = COMMENT_NONE;
+                purp_values[PTAG_PURPNUM_POS] = strTmp;
+                tpl_render_to (&out->buf, purp_tpl, purp_values, NULL, 0);
+                sink_mark (out, 1);
+                sink_flush (out, 0);
+                
+                // add proper items to the arrays of parent control func ptrs
+                // and concurrency flags
+                add_tp_items(arrays, attrs);
+            }
+
+            /* End of the block */
+            isEndFound = 1;
+
+            break;            
+        }
+        
+        // Parse block-level tags.
+        if ((tok.kind != TOKEN_OPEN) || (section_level[tok.tag] != LEVEL_BLOCK))
+        {
+            continue;   // not a tag
+        }
+        
+        switch (tok.tag)
+        {
+        case SEC_TARGETS:
+            isTargetFound = 1;
+            
+            isBad = !parse_targets(ctx, targets, &nTargets);
+            if (isBad)
+            {
+                fprintf(stderr, 
+                    "Line %d: Invalid TARGET section in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            for (i = 0; i < nTargets; ++i)
+            {
+                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "//    ");
+                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], targets[i]);
+                tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "\n");
+                
+                replace_char(targets[i], '\n', ' ');
+                replace_char(targets[i], '\r', ' ');
+                replace_char(targets[i], '\"', ' ');
+    
+                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], "    ");
+                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], targets[i]);
+                tag_values[TARGETS_TAG_POS] = str_append (tag_values[TARGETS_TAG_POS], "\\n");
+            }
+            tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], "//");
+
+            tag_values[COMMENT_TAG_POS] = str_append (tag_values[COMMENT_TAG_POS], 
+                "\n// Parameters:\n<%params%>");
+
+            break;
+        case SEC_DEFINE:
+            if (isDefineFound)
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: Multiple DEFINE sections found in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            isDefineFound = 1;
+            
+            isBad = !parse_defines(ctx, 
+                &(tag_values[DEFINE_TAG_POS]), &(tag_values[UNDEF_TAG_POS]));
+            if (isBad)
+            {
+                fprintf(stderr, 
+                    "Line %d: Invalid DEFINE section in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            break;
+        case SEC_FINALLY:
+            free (finally_code);
+            finally_code = parse_text (ctx, SEC_FINALLY);
+            
+            tpl_free (purp_tpl);
+            purp_tpl = NULL;
+            
+            if (!finally_code)
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: Invalid FINALLY section found in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+            
+            break;
+        case SEC_CODE:
+            if (!isTargetFound || (nTargets == 0))
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: No target interfaces are specified in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            if (isCodeFound)
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: Multiple CODE sections found in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+            
+            isCodeFound = 1;
+
+            if (tag_values[DEFINE_TAG_POS] == NULL)
+            {
+                tag_values[DEFINE_TAG_POS] = strdup ("");
+            }
+
+            if (tag_values[UNDEF_TAG_POS] == NULL)
+            {
+                tag_values[UNDEF_TAG_POS] = strdup ("");
+            }
+
+            tag_values[CODE_TAG_POS] = parse_text (ctx, SEC_CODE);
+
+            if (tag_values[CODE_TAG_POS] == NULL)
+            {
+                isBad = 1;
+                fprintf(stderr, 
+                    "Line %d: The CODE section is invalid in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            /************************************************************************/
+            /* Generate purpose template with comments, defines, undefs, code, and  */
+            /* a 'finally' section.                                                 */
+            /************************************************************************/
+            templ = tpl_render (purpose_tpl, tag_values, NULL, 0);
+            break;
+        case SEC_PURPOSE:
+            if (!isCodeFound)
+            {
+                isBad = 1;
+                fprintf (stderr, 
+                    "Line %d: Found PURPOSE section before CODE section in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+            
+            isPurposeFound = 1;
+            
+            if (!purp_tpl)
+            {
+                purp_tpl = compile_purpose_template (templ, finally_code);
+            }
+            
+            old_purp_num = *purposes_number;
+            isBad = !parse_purpose(ctx, purp_tpl, purposes_number, out, attrs);
+            
+            // add proper items to the arrays of parent control func ptrs
+            // and concurrency flags (the same for all newly parsed test purposes)
+            for (i = old_purp_num; i < *purposes_number; ++i)
+            {
+                add_tp_items(arrays, attrs);
+            }
+
+            if (isBad)
+            {
+                isBad = 1;
+                fprintf (stderr, 
+                    "Line %d: Invalid PURPOSE section found in the BLOCK beginning at line %d.\n", 
+                    ctx->ln_count, ln_beg);
+                break;
+            }
+
+            break;
+        }
+        if (isBad) 
+        {
+            break;
+        }
+    }
+
+    if (!isEndFound)
+    {
+        fprintf(stderr, "Line %d: End of the BLOCK that begins at line %d is not found.\n", 
+            ctx->ln_count, ln_beg);
+        isBad = 1;
+    }
+
+    free(templ);
+    free(finally_code);
+    tpl_free(purp_tpl);
+    for (i = 0; i < TAGS_NUM; ++i)
+    {
+        free(tag_values[i]);
+    }
+    
+    for (i = 0; i < nTargets; ++i)
+    {
+        free(targets[i]);
+    }
+    
+    return !isBad;
+}
+
+static int
+parse_targets(TGenContext* ctx, char** pstrTargets, int* pnTargets)
+{
+    char* str_t = NULL;
+    int isBad = 0;
+    TToken tok;
+
+    *pnTargets = 0;
+
+    int close_tag_found = 0;
+    while (next_token(ctx, &tok))
+    {
+        if ((tok.kind == TOKEN_CLOSE) && (tok.tag == SEC_TARGETS))
+        {
+            close_tag_found = 1;
+            break;
+        }
+        else
+        {
+            str_t = trim_with_nl (tok.str);
+            if (strlen(str_t) > 0)
+            {
+                
+                if (*pnTargets >= MAX_TARGETS_NUM-1)
+                {
+                    fprintf(stderr, "Line %d: Too many target interfaces in a single BLOCK.\n",
+                        ctx->ln_count);
+                    break;
+                }
+
+                pstrTargets[*pnTargets] = strdup(str_t);
+                ++(*pnTargets);
+            }
+        }
+    }
+    if (!close_tag_found)
+    {
+        fprintf (stderr, "Line %d: No close tag found for TARGETS section.\n", ctx->ln_count);
+        isBad = 1;
+    }
+    
+
+    return (!isBad);
+}
+
+static int
+parse_defines(TGenContext* ctx, char** pstrDefines, char** pstrUndefs)
+{
+    char* str = NULL;
+    char* str_t = NULL;
+    int isBad = 0;
+    TStrBuf defines;
+    TStrBuf undefs;
+    TToken tok;
+
+    strbuf_init(&defines);
+    strbuf_init(&undefs);
+
+    int close_tag_found = 0;
+    while (next_token(ctx, &tok))
+    {
+        str = tok.str;
+        if ((tok.kind == TOKEN_CLOSE) && (tok.tag == SEC_DEFINE))
+        {
+            close_tag_found = 1;
+            break;
+        }
+        else
+        {
+            str_t = trim(str);
+            strbuf_append(&defines, str_t);
+
+            if (strstr (str, "#define"))
+            {
+                char* delims = " \t\n\r";    
+                char* token = NULL;
+                char* pos = NULL;
+
+                token = strtok_r(str, delims, &pos); /* to #define */
+                token = strtok_r(NULL, delims, &pos); /* to NAME */
+
+                if (token == NULL)
+                {
+                    fprintf(stderr, "Line %d: Invalid #define directive.\n", ctx->ln_count);
+                    isBad = 1;
+                    break;
+                }
+                
+                char* bpos = strchr(token, '(');
+                if (bpos != NULL)
+                {
+                    *bpos = 0;
+                }
+                
+                strbuf_append(&undefs, "#undef ");
+                strbuf_append(&undefs, token);
+                strbuf_append(&undefs, "\n");
+            }
+        }
+    }
+    
+    if (!close_tag_found)
+    {
+        fprintf (stderr, "Line %d: No close tag found for DEFINE section.\n", ctx->ln_count);
+        isBad = 1;
+    }
+    
+    *pstrDefines = strbuf_detach(&defines);
+    *pstrUndefs = strbuf_detach(&undefs);
+
+    return (!isBad);
+}
+
+static TTemplate*
+compile_purpose_template(const char* templ, const char* finally_code)
+{
+    char* finally_tags[] = {TAG_FINALLY_NAME};
+    char* finally_values[] = {(char*)finally_code};
+    TTemplate* tpl = NULL;
+    char* text = NULL;
+    
+    // The FINALLY code may refer to the parameters of the purpose too, 
+    // so it is inserted before the purpose template is compiled.
+    tpl = tpl_compile(templ, finally_tags, 1, 0);
+    text = tpl_render(tpl, finally_values, NULL, 0);
+    tpl_free(tpl);
+    
+    tpl = tpl_compile(text, purpose_tags, PTAGS_NUM, TPL_NUMERIC_TAGS);
+    free(text);
+    return tpl;
+}
+
+/*
+ * Record that 'count' test purposes starting from 'first' are implemented
+ * by the function test_purpose_<first>.
+ */
+static void
+add_shared_tp(TGenContext* ctx, int first, int count)
+{
+    if (ctx->nShared == ctx->maxShared)
+    {
+        ctx->maxShared = (ctx->maxShared == 0) ? 8 : 2 * ctx->maxShared;
+        ctx->shared_tp = (int*)alloc_mem(ctx->shared_tp, 2 * ctx->maxShared, sizeof(int));
+    }
+    
+    ctx->shared_tp[2 * ctx->nShared] = first;
+    ctx->shared_tp[2 * ctx->nShared + 1] = count;
+    ++ctx->nShared;
+}
+
+static int
+parse_purpose(TGenContext* ctx, const TTemplate* templ, int* purposes_number,
+              TOutSink* out, const TBlockAttrs* attrs)
+{
+    char* str_t = NULL;
+    int isBad = 0;
+    const char *warning_text = NULL;           
+	TPurpose purpose;
+    TToken tok;
+    
+    purpose_init (&purpose);
+
+    
+    int close_tag_found = 0;
+    while (next_token(ctx, &tok))
+    {
+        if ((tok.kind == TOKEN_CLOSE) && (tok.tag == SEC_PURPOSE))
+        {
+            close_tag_found = 1;
+            if (purpose.nLines == 0)
+            {
+                char* purp_values[PTAGS_NUM];
+                char strTmp[16] = "";
+                
+			    ++(*purposes_number);   
+	            sprintf(strTmp, "%d", *purposes_number);
+                purp_values[PTAG_PARAMS_POS] = COMMENT_NONE;
+                purp_values[PTAG_PURPNUM_POS] = strTmp;
+                tpl_render_to(&out->buf, templ, purp_values, NULL, 0);
+                sink_mark(out, 1);
+                sink_flush(out, 0);
+    	        break;
+            }
+            
+            int count = -1;
+            double t_start = stats_time();
+            
+            if (ctx->cfg->bParamTables && attrs->bParamTables)
+            {
+                count = expand_purpose_table (&purpose, out, templ, *purposes_number + 1);
+                if (count > 0)
+                {
+                    add_shared_tp (ctx, *purposes_number + 1, count);
+                }
+            }
+            if (count < 0)
+            {
+                count = expand_purpose (&purpose, out, templ, *purposes_number + 1);
+            }
+            *purposes_number += count;
+            ctx->stats->nCombinations += count;
+            ctx->stats->phase_time[PHASE_PURPOSES] += stats_time() - t_start;
+            break;
+        }
+        else
+        {
+            str_t = trim_with_nl (tok.str);
+            if (strlen(str_t) > 0)
+            {
+                parse_purpose_line (str_t, &purpose, &warning_text);                
+
+                if (strcmp (warning_text, WARNING_OK) != 0)
+                {
+                	fprintf (stderr, "Line %d: %s", ctx->ln_count, WARNING_PREFIX);
+                	fprintf (stderr, "%s\n", warning_text);
+                }
+            }
+        }
+    }
+    
+    if (!close_tag_found)
+    {
+        fprintf (stderr, "Line %d: No close tag found for PURPOSE section.\n", ctx->ln_count);
+        isBad = 1;
+    }
+
+    purpose_free (&purpose);
+    return !isBad;
+}
+
+/*
+ * Number of the function that implements test purpose i (see 
+ * add_shared_tp()). The test purposes should be processed in ascending
+ * order, *pk is the current range of the shared test purposes (initially 0).
+ */
+static int
+tp_func_number(const TGenContext* ctx, int i, int* pk)
+{
+    // Skip the ranges that end before i.
+    while ((*pk < ctx->nShared) && 
+           (ctx->shared_tp[2 * *pk] + ctx->shared_tp[2 * *pk + 1] <= i))
+    {
+        ++(*pk);
+    }
+    
+    if ((*pk < ctx->nShared) && (ctx->shared_tp[2 * *pk] <= i))
+    {
+        return ctx->shared_tp[2 * *pk];
+    }
+    return i;
+}
+
+/*
+ * The test purposes after nMain are in the other parts of the test and are
+ * called via t2c_tp_<N>_() functions defined there (see split_test()).
+ */
+static void
+gen_tp_arrays(TGenContext* ctx, int number, int nMain, char** pTetHooks, char** pTpFuncs)
+{
+    int i;
+    int func;
+    int k = 0;  // current range of the shared test purposes
+    char iStr[16]; 
+    char funcStr[16];
+    
+    char* tet_hook_tpl = "    {tp_launcher, <%purpose_number%>},\n"; 
+    char* t2c_func_tpl = "    test_purpose_<%purpose_number%>,\n"; 
+    char* part_func_tpl = "    t2c_tp_<%purpose_number%>_,\n"; 
+    
+    char* purpnum_tag[] = {PURPNUM_TAG};
+    char* purpnum_val[] = {iStr};
+    char* funcnum_val[] = {funcStr};
+    
+    TTemplate* tet_hook = tpl_compile(tet_hook_tpl, purpnum_tag, 1, 0);
+    TTemplate* t2c_func = tpl_compile(t2c_func_tpl, purpnum_tag, 1, 0);
+    TTemplate* part_func = tpl_compile(part_func_tpl, purpnum_tag, 1, 0);
+    TStrBuf hooks;
+    TStrBuf funcs;
+    
+    strbuf_init(&hooks);
+    strbuf_init(&funcs);
+    
+    for(i = 1; i <= number; ++i)
+    {
+        sprintf(iStr, "%d", i);
+        func = tp_func_number(ctx, i, &k);
+        sprintf(funcStr, "%d", func);
+        
+        tpl_render_to(&hooks, tet_hook, purpnum_val, NULL, 0);
+        tpl_render_to(&funcs, (func <= nMain) ? t2c_func : part_func, 
+                      funcnum_val, NULL, 0);
+    }
+    
+    *pTetHooks = strbuf_detach(&hooks);
+    *pTpFuncs = strbuf_detach(&funcs);
+    
+    tpl_free(tet_hook);
+    tpl_free(t2c_func);
+    tpl_free(part_func);
+    return;
+}
+
+/*
+ * The parts are of about the same size (in bytes of code), there are 
+ * number / split of them (rounded up). A part can only end after a test 
+ * purpose whose function is not shared with the next one. 
+ *
+ * The main file of the test keeps the first part and declares 
+ * t2c_tp_<N>_() for each test purpose function N of the other parts; these 
+ * call the test purpose functions (static) and are defined at the end of 
+ * the respective parts. The other parts are made from part.tpl and include
+ * <test>_globals.h made from the GLOBAL section of the test by 
+ * share_globals(): the directives, types, prototypes, templates and inline
+ * functions are copied there, the variables and functions defined in the 
+ * section are only declared there and lose 'static' in the main file (so 
+ * their names should not clash with those of the library under test).
+ * The test is not split if the section contains a namespace or an extern "C"
+ * block, defines an array of unknown size or, in C++, a variable of an 
+ * unnamed struct, union, enum or class.
+ */
+static int
+split_test(TGenContext* ctx, TGenTest* test, int number, int split)
+{
+    const long long* marks = test->purposes.marks;  // where each TP ends
+    int nParts = (number + split - 1) / split;
+    int* part_end = NULL;   // the last test purpose of each part
+    long long total;
+    int i;
+    int j;
+    int k;
+    int func;
+    char str[64];
+    TStrBuf decls;
+    TStrBuf defs;
+    
+    if (test->purposes.nMarks != number)
+    {
+        return number;  // should not happen, do not split then
+    }
+    total = marks[number - 1];
+    
+    part_end = (int*)alloc_mem(part_end, nParts, sizeof(int));
+    test->nParts = 0;
+    for (i = 1, j = 1; i < nParts; ++i)
+    {
+        long long target = total * i / nParts;
+        
+        while ((j < number) && 
+               ((marks[j - 1] < target) || (marks[j - 1] == marks[j])))
+        {
+            ++j;
+        }
+        if (j >= number)
+        {
+            break;
+        }
+        part_end[test->nParts++] = j++;
+    }
+    part_end[test->nParts++] = number;
+    
+    if (test->nParts == 1)
+    {
+        free(part_end);
+        return number;
+    }
+    
+    test->part_off = (long long*)alloc_mem(test->part_off, test->nParts, sizeof(long long));
+    test->part_funcs = (char**)alloc_mem(test->part_funcs, test->nParts, sizeof(char*));
+    
+    strbuf_init(&decls);
+    strbuf_append(&decls, "\n// The test purposes in the other parts of the test.\n");
+    
+    k = 0;
+    j = part_end[0] + 1;
+    for (i = 0; i < test->nParts; ++i)
+    {
+        test->part_off[i] = marks[part_end[i] - 1];
+        if (i == 0)
+        {
+            continue;
+        }
+        
+        strbuf_init(&defs);
+        strbuf_append(&defs, "\n// The test purposes of this part, for the main file of the test.\n");
+        for (; j <= part_end[i]; ++j)
+        {
+            func = tp_func_number(ctx, j, &k);
+            if (func != j)
+            {
+                continue;
+            }
+            
+            sprintf(str, "void t2c_tp_%d_(void);\n", func);
+            strbuf_append(&decls, str);
+            
+            sprintf(str, "void t2c_tp_%d_(void)\n{\n", func);
+            strbuf_append(&defs, str);
+            sprintf(str, "    test_purpose_%d();\n}\n", func);
+            strbuf_append(&defs, str);
+        }
+        test->part_funcs[i] = strbuf_detach(&defs);
+    }
+    test->part_funcs[0] = strbuf_detach(&decls);
+    
+    i = part_end[0];
+    free(part_end);
+    return i;
+}
+
+/*
+ * Nonzero if the top-level declaration [beg, end) of the GLOBAL section
+ * (comments, literals and directives removed) may define a variable. 
+ * typedefs, extern declarations, struct (union, enum, class) definitions 
+ * without declarators and function prototypes do not.
+ */
+static int
+decl_defines_object(const char* beg, const char* end)
+{
+    static const char* type_keywords[] = {"struct", "union", "enum", "class", NULL};
+    const char* p;
+    const char* first_paren = NULL;
+    int depth = 0;
+    int has_init = 0;
+    size_t len;
+    int i;
+    
+    while ((beg < end) && isspace((unsigned char)*beg))
+    {
+        ++beg;
+    }
+    while ((end > beg) && isspace((unsigned char)end[-1]))
+    {
+        --end;
+    }
+    if (beg == end)
+    {
+        return 0;
+    }
+    
+    for (p = beg; p < end; ++p)
+    {
+        if ((*p == '(') && (depth == 0) && (first_paren == NULL))
+        {
+            first_paren = p;
+        }
+        if ((*p == '(') || (*p == '[') || (*p == '{'))
+        {
+            ++depth;
+        }
+        else if ((*p == ')') || (*p == ']') || (*p == '}'))
+        {
+            --depth;
+        }
+        else if ((*p == '=') && (depth == 0))
+        {
+            has_init = 1;
+        }
+    }
+    
+    for (p = beg; (p < end) && (isalnum((unsigned char)*p) || (*p == '_')); ++p)
+    {
+    }
+    len = (size_t)(p - beg);
+    
+    if (((len == 7) && !strncmp(beg, "typedef", len)) || 
+        ((len == 6) && !strncmp(beg, "extern", len)))
+    {
+        return has_init;
+    }
+    
+    // "struct S {...}" or "struct S" with nothing after it.
+    for (i = 0; type_keywords[i] != NULL; ++i)
+    {
+        if ((strlen(type_keywords[i]) == len) && !strncmp(beg, type_keywords[i], len))
+        {
+            break;
+        }
+    }
+    if (type_keywords[i] != NULL)
+    {
+        while ((p < end) && isspace((unsigned char)*p))
+        {
+            ++p;
+        }
+        while ((p < end) && (isalnum((unsigned char)*p) || (*p == '_')))
+        {
+            ++p;
+        }
+        while ((p < end) && isspace((unsigned char)*p))
+        {
+            ++p;
+        }
+        if ((p == end) || ((*p == '{') && (end[-1] == '}')))
+        {
+            return 0;
+        }
+    }
+    
+    // A prototype: "... f(...)", but not "... (*f)(...)".
+    if ((first_paren != NULL) && !has_init && (end[-1] == ')'))
+    {
+        for (p = first_paren + 1; (p < end) && isspace((unsigned char)*p); ++p)
+        {
+        }
+        if ((p < end) && (*p != '*') && (*p != '&') && (*p != '^'))
+        {
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+/*
+ * A copy of 'code' of the same length where the comments and the 
+ * preprocessor directives are replaced with spaces and the string and 
+ * character literals - with 0 followed by spaces. The line breaks are kept.
+ */
+static char*
+blank_code(const char* code)
+{
+    size_t len = strlen(code);
+    char* buf = NULL;
+    size_t i;
+    size_t j;
+    int bol = 1;    // only spaces since the beginning of the line
+    
+    buf = (char*)alloc_mem(buf, len + 1, sizeof(char));
+    memcpy(buf, code, len + 1);
+    for (i = 0; i < len; i = j)
+    {
+        j = i + 1;
+        if (bol && (code[i] == '#'))
+        {
+            for (j = i; (j < len) && (code[j] != '\n'); ++j)
+            {
+                if ((code[j] == '\\') && (j + 1 < len))
+                {
+                    ++j;
+                }
+            }
+        }
+        else if ((code[i] == '/') && (code[i + 1] == '*'))
+        {
+            const char* e = strstr(code + i + 2, "*/");
+            j = (e != NULL) ? (size_t)(e - code) + 2 : len;
+        }
+        else if ((code[i] == '/') && (code[i + 1] == '/'))
+        {
+            for (j = i; (j < len) && (code[j] != '\n'); ++j)
+            {
+            }
+        }
+        else if ((code[i] == '"') || (code[i] == '\''))
+        {
+            for (; (j < len) && (code[j] != code[i]); ++j)
+            {
+                if ((code[j] == '\\') && (j + 1 < len))
+                {
+                    ++j;
+                }
+            }
+            if (j < len)
+            {
+                ++j;
+            }
+            buf[i++] = '0';
+            bol = 0;
+        }
+        else
+        {
+            if (code[i] == '\n')
+            {
+                bol = 1;
+            }
+            else if (!isspace((unsigned char)code[i]))
+            {
+                bol = 0;
+            }
+            continue;
+        }
+        
+        for (; i < j; ++i)
+        {
+            if (buf[i] != '\n')
+            {
+                buf[i] = ' ';
+            }
+        }
+    }
+    return buf;
+}
+
+static int
+is_ident_char(char c)
+{
+    return (isalnum((unsigned char)c) || (c == '_'));
+}
+
+/*
+ * Nonzero if the word 'word' (an identifier) is in [beg, end) of 'code'.
+ */
+static int
+has_word(const char* code, size_t beg, size_t end, const char* word)
+{
+    size_t len = strlen(word);
+    size_t i;
+    
+    for (i = beg; i + len <= end; ++i)
+    {
+        if (!strncmp(code + i, word, len) && 
+            ((i == beg) || !is_ident_char(code[i - 1])) &&
+            ((i + len == end) || !is_ident_char(code[i + len])))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Append the declaration [beg, end) of 'code' to 'sb' without 'static' and, 
+ * if bNoInit is nonzero, without the initializers. 'blank' is the copy of 
+ * 'code' made by blank_code().
+ */
+static void
+append_decl(TStrBuf* sb, const char* code, const char* blank, 
+            size_t beg, size_t end, int bNoInit)
+{
+    size_t from = beg;
+    size_t i;
+    size_t k;
+    int depth = 0;
+    int bSpec = 1;  // in the declaration specifiers
+    
+    for (i = beg; i < end; ++i)
+    {
+        if (bSpec && !strncmp(blank + i, "static", 6) && 
+            ((i == beg) || !is_ident_char(blank[i - 1])) && 
+            (i + 6 <= end) && !is_ident_char(blank[i + 6]))
+        {
+            strbuf_append_n(sb, code + from, i - from);
+            for (i += 6; (i < end) && isspace((unsigned char)blank[i]); ++i)
+            {
+            }
+            from = i--;
+            bSpec = 0;
+        }
+        else if ((blank[i] == '(') || (blank[i] == '[') || (blank[i] == '{'))
+        {
+            bSpec = 0;
+            ++depth;
+        }
+        else if ((blank[i] == ')') || (blank[i] == ']') || (blank[i] == '}'))
+        {
+            --depth;
+        }
+        else if ((blank[i] == '=') && (depth == 0) && bNoInit)
+        {
+            // the initializer ends with ',' or ';' (or 'end')
+            for (k = i; (k > from) && isspace((unsigned char)blank[k - 1]); --k)
+            {
+            }
+            strbuf_append_n(sb, code + from, k - from);
+            for (; (i < end) && ((depth > 0) || ((blank[i] != ',') && (blank[i] != ';'))); ++i)
+            {
+                if ((blank[i] == '(') || (blank[i] == '[') || (blank[i] == '{'))
+                {
+                    ++depth;
+                }
+                else if ((blank[i] == ')') || (blank[i] == ']') || (blank[i] == '}'))
+                {
+                    --depth;
+                }
+            }
+            from = i--;
+        }
+        else if (!is_ident_char(blank[i]) && !isspace((unsigned char)blank[i]) && 
+                 (blank[i] != ':'))
+        {
+            bSpec = 0;
+        }
+    }
+    strbuf_append_n(sb, code + from, end - from);
+}
+
+/*
+ * The top-level declaration [beg, end) of the GLOBAL section defining 
+ * a variable (see share_globals()): NULL if the variable can be declared 
+ * in the other parts, otherwise the reason why it cannot.
+ */
+static const char*
+check_shared_var(const char* blank, size_t beg, size_t end, int bCpp)
+{
+    static const char* type_keywords[] = {"struct", "union", "enum", "class", NULL};
+    size_t i;
+    size_t k;
+    int depth = 0;
+    int j;
+    
+    for (i = beg; (i < end) && !((blank[i] == '=') && (depth == 0)); ++i)
+    {
+        if (blank[i] == '[')
+        {
+            for (k = i + 1; (k < end) && isspace((unsigned char)blank[k]); ++k)
+            {
+            }
+            if ((k < end) && (blank[k] == ']'))
+            {
+                return "defines an array of unknown size";
+            }
+        }
+        
+        // C++ only: an unnamed type in the other parts would be another type
+        if ((blank[i] == '{') && (depth == 0) && bCpp)
+        {
+            for (k = i; (k > beg) && isspace((unsigned char)blank[k - 1]); --k)
+            {
+            }
+            for (j = 0; type_keywords[j] != NULL; ++j)
+            {
+                size_t len = strlen(type_keywords[j]);
+                if ((k >= beg + len) && !strncmp(blank + k - len, type_keywords[j], len) &&
+                    ((k == beg + len) || !is_ident_char(blank[k - len - 1])))
+                {
+                    return "defines a variable of an unnamed type";
+                }
+            }
+        }
+        
+        if ((blank[i] == '(') || (blank[i] == '[') || (blank[i] == '{'))
+        {
+            ++depth;
+        }
+        else if ((blank[i] == ')') || (blank[i] == ']') || (blank[i] == '}'))
+        {
+            --depth;
+        }
+    }
+    return NULL;
+}
+
+static const char*
+share_globals(const char* code, int bCpp, char** main_code, char** hdr_code)
+{
+    char* blank = NULL;
+    const char* reason = NULL;
+    size_t len;
+    size_t prev = 0;    // the end of the previous declaration
+    size_t beg;
+    size_t end;
+    size_t body;        // the body of a function if it is defined there
+    size_t brace;       // the first top-level '{' in the declaration
+    size_t head;        // the end of the declaration or that '{'
+    size_t k;
+    int depth;
+    TStrBuf mc;
+    TStrBuf hc;
+    
+    *main_code = NULL;
+    *hdr_code = NULL;
+    if (code == NULL)
+    {
+        code = "";
+    }
+    
+    len = strlen(code);
+    blank = blank_code(code);
+    strbuf_init(&mc);
+    strbuf_init(&hc);
+    
+    while (reason == NULL)
+    {
+        for (beg = prev; (beg < len) && isspace((unsigned char)blank[beg]); ++beg)
+        {
+        }
+        
+        // comments, directives and spaces before the declaration
+        strbuf_append_n(&mc, code + prev, beg - prev);
+        strbuf_append_n(&hc, code + prev, beg - prev);
+        if (beg == len)
+        {
+            break;
+        }
+        
+        // the declaration ends with ';' or with the body of a function
+        depth = 0;
+        body = brace = len;
+        for (end = beg; end < len; ++end)
+        {
+            if ((blank[end] == '{') && (depth == 0))
+            {
+                for (k = end; (k > beg) && isspace((unsigned char)blank[k - 1]); --k)
+                {
+                }
+                if (brace == len)
+                {
+                    brace = end;
+                }
+                if ((k > beg) && (blank[k - 1] == ')'))
+                {
+                    body = end;
+                }
+            }
+            
+            if ((blank[end] == '(') || (blank[end] == '[') || (blank[end] == '{'))
+            {
+                ++depth;
+            }
+            else if ((blank[end] == ')') || (blank[end] == ']') || (blank[end] == '}'))
+            {
+                --depth;
+                if ((depth == 0) && (body != len))
+                {
+                    break;
+                }
+            }
+            else if ((blank[end] == ';') && (depth == 0))
+            {
+                break;
+            }
+        }
+        if (end == len)
+        {
+            reason = "cannot be parsed";
+            break;
+        }
+        ++end;
+        prev = end;
+        head = (brace < end) ? brace : end;
+        
+        if (has_word(blank, beg, head, "namespace") || 
+            (has_word(blank, beg, head, "extern") && (brace < end) && (body == len)))
+        {
+            reason = "contains a namespace or an extern \"C\" block";
+        }
+        else if (has_word(blank, beg, head, "template") || 
+                 has_word(blank, beg, head, "using") ||
+                 has_word(blank, beg, head, "typedef"))
+        {
+            // the same in all the parts
+            strbuf_append_n(&mc, code + beg, end - beg);
+            strbuf_append_n(&hc, code + beg, end - beg);
+        }
+        else if ((body != len) && 
+                 (has_word(blank, beg, body, "inline") || 
+                  has_word(blank, beg, body, "__inline") || 
+                  has_word(blank, beg, body, "__inline__")))
+        {
+            // inline functions are defined in each part
+            strbuf_append_n(&mc, code + beg, end - beg);
+            strbuf_append_n(&hc, code + beg, end - beg);
+        }
+        else if (body != len)
+        {
+            append_decl(&mc, code, blank, beg, end, 0);
+            if (memchr(blank + beg, ':', body - beg) != NULL)
+            {
+                // a member function, the class is declared there already
+            }
+            else
+            {
+                for (k = body; (k > beg) && isspace((unsigned char)blank[k - 1]); --k)
+                {
+                }
+                append_decl(&hc, code, blank, beg, k, 0);
+                strbuf_append(&hc, ";");
+            }
+        }
+        else if (!decl_defines_object(blank + beg, blank + end - 1))
+        {
+            // prototypes, types, extern declarations
+            append_decl(&mc, code, blank, beg, end, 0);
+            append_decl(&hc, code, blank, beg, end, 0);
+        }
+        else if ((reason = check_shared_var(blank, beg, end, bCpp)) == NULL)
+        {
+            // in C++, const objects have internal linkage unless they are extern
+            if (!has_word(blank, beg, end, "extern"))
+            {
+                if (bCpp && has_word(blank, beg, end, "const"))
+                {
+                    strbuf_append(&mc, "extern ");
+                }
+                strbuf_append(&hc, "extern ");
+            }
+            append_decl(&mc, code, blank, beg, end, 0);
+            append_decl(&hc, code, blank, beg, end, 1);
+        }
+    }
+    
+    free(blank);
+    if (reason != NULL)
+    {
+        strbuf_free(&mc);
+        strbuf_free(&hc);
+        return reason;
+    }
+    *main_code = strbuf_detach(&mc);
+    *hdr_code = strbuf_detach(&hc);
+    return NULL;
+}
+
+/*
+ * Name of the file for part 'part' of the test (<test>.c for part 0).
+ */
+char*
+t2cgen_file_name(const TGenSettings* cfg, const char* ftest_nme, int part)
+{
+    char* res = NULL;
+    char str[32];
+    
+    res = strdup(ftest_nme);
+    if (part > 0)
+    {
+        sprintf(str, "%s%d", PART_FILE_SUFFIX, part);
+        res = str_append(res, str);
+    }
+    return str_append(res, (cfg->bGenCpp ? ".cpp" : ".c"));
+}
+
+/*
+ * Name of the header included by the other parts of a split test.
+ */
+char*
+t2cgen_globals_hdr_name(const char* ftest_nme)
+{
+    return str_sum(ftest_nme, GLOBALS_HDR_SUFFIX);
+}
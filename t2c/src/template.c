@@ -0,0 +1,358 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/libmem.h"
+#include "../include/libstr.h"
+#include "../include/libfile.h"
+#include "../include/template.h"
+
+/*
+ * The templates (test.tpl, purpose.tpl, makefile templates) are parsed 
+ * only once into a list of text segments and tags. Rendering is then 
+ * done in a single pass, each value is copied exactly once.
+ * Unlike the substitution of the tags one by one, the values are not 
+ * scanned for other tags.
+ */
+
+static void 
+add_segment (TTemplate* tpl, size_t off, size_t len, int tag)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    
+    // merge adjacent text segments
+    if ((tag < 0) && (tpl->nSegs > 0) && (tpl->segs[tpl->nSegs - 1].tag < 0))
+    {
+        tpl->segs[tpl->nSegs - 1].len += len;
+        return;
+    }
+    
+    tpl->segs = (TTplSegment*)alloc_mem (tpl->segs, tpl->nSegs + 1, sizeof (TTplSegment));
+    tpl->segs[tpl->nSegs].off = off;
+    tpl->segs[tpl->nSegs].len = len;
+    tpl->segs[tpl->nSegs].tag = tag;
+    ++tpl->nSegs;
+}
+
+/*
+ * Returns ID of the tag tag_len characters long that starts at 'tag', 
+ * -1 if the tag is unknown.
+ */
+static int
+find_tag (const char* tag, size_t tag_len, char* const tag_names[], int nTags, int flags)
+{
+    int i;
+    size_t open_len  = strlen (TPL_TAG_OPEN);
+    size_t close_len = strlen (TPL_TAG_CLOSE);
+    
+    for (i = 0; i < nTags; ++i)
+    {
+        if ((strlen (tag_names[i]) == tag_len) && !strncmp (tag, tag_names[i], tag_len))
+        {
+            return i;
+        }
+    }
+    
+    if ((flags & TPL_NUMERIC_TAGS) && (tag_len > open_len + close_len))
+    {
+        const char* p = tag + open_len;
+        const char* end = tag + tag_len - close_len;
+        int n = 0;
+        
+        for (; p < end; ++p)
+        {
+            if ((*p < '0') || (*p > '9') || (n > 100000))
+            {
+                return -1;
+            }
+            n = n * 10 + (*p - '0');
+        }
+        return nTags + n;
+    }
+    
+    return -1;
+}
+
+TTemplate* 
+tpl_compile (const char* text, char* const tag_names[], int nTags, int flags)
+{
+    TTemplate* tpl = NULL;
+    const char* pos;
+    const char* lit;
+    size_t open_len  = strlen (TPL_TAG_OPEN);
+    size_t close_len = strlen (TPL_TAG_CLOSE);
+    
+    if (text == NULL)
+    {
+        return NULL;
+    }
+    
+    tpl = (TTemplate*)alloc_mem (tpl, 1, sizeof (TTemplate));
+    tpl->text = strdup (text);
+    tpl->segs = NULL;
+    tpl->nSegs = 0;
+    tpl->nTags = nTags;
+    
+    lit = tpl->text;
+    pos = strstr (lit, TPL_TAG_OPEN);
+    while (pos != NULL)
+    {
+        const char* end = strstr (pos + open_len, TPL_TAG_CLOSE);
+        int tag;
+        
+        if (end == NULL)
+        {
+            break;
+        }
+        
+        end += close_len;
+        tag = find_tag (pos, end - pos, tag_names, nTags, flags);
+        if (tag < 0)
+        {   // not a tag, try from the next character
+            pos = strstr (pos + 1, TPL_TAG_OPEN);
+            continue;
+        }
+        
+        add_segment (tpl, lit - tpl->text, pos - lit, -1);
+        add_segment (tpl, pos - tpl->text, end - pos, tag);
+        
+        lit = end;
+        pos = strstr (lit, TPL_TAG_OPEN);
+    }
+    add_segment (tpl, lit - tpl->text, strlen (lit), -1);
+    
+    return tpl;
+}
+
+void 
+tpl_free (TTemplate* tpl)
+{
+    if (tpl == NULL)
+    {
+        return;
+    }
+    
+    free (tpl->text);
+    free (tpl->segs);
+    free (tpl);
+}
+
+/*
+ * Return the value for the segment or NULL if the segment should be 
+ * copied from the template as is.
+ */
+static const char*
+segment_value (const TTemplate* tpl, const TTplSegment* seg, char* const values[], 
+               char* const params[], int nParams)
+{
+    if (seg->tag >= tpl->nTags)
+    {
+        int n = seg->tag - tpl->nTags;
+        if ((params != NULL) && (n < nParams))
+        {
+            return params[n];
+        }
+    }
+    else if ((seg->tag >= 0) && (values != NULL))
+    {
+        return values[seg->tag];
+    }
+    return NULL;
+}
+
+/*
+ * Append the result of substitution of the values into the template to 'out'.
+ * values[i] is the value for the tag with ID i, params[N] - for <%N%>.
+ * If the value is NULL (or N >= nParams), the tag is left as is.
+ */
+void 
+tpl_render_to (TStrBuf* out, const TTemplate* tpl, char* const values[], 
+               char* const params[], int nParams)
+{
+    int i;
+    
+    for (i = 0; i < tpl->nSegs; ++i)
+    {
+        const TTplSegment* seg = &tpl->segs[i];
+        const char* val = segment_value (tpl, seg, values, params, nParams);
+        
+        if (val != NULL)
+        {
+            strbuf_append_n (out, val, strlen (val));
+        }
+        else
+        {
+            strbuf_append_n (out, tpl->text + seg->off, seg->len);
+        }
+    }
+}
+
+/*
+ * Same as tpl_render_to() but the result is written to the file 'out'.
+ * If streams[i] is not NULL, the contents of that file (from the beginning)
+ * are used as the value for the tag with ID i, so large values need not 
+ * be kept in memory.
+ * Returns 0 if an error occurs, 1 otherwise.
+ */
+int 
+tpl_write (FILE* out, const TTemplate* tpl, char* const values[], 
+           FILE* const streams[], char* const params[], int nParams)
+{
+    char data[8192];
+    size_t nread;
+    int i;
+    
+    for (i = 0; i < tpl->nSegs; ++i)
+    {
+        const TTplSegment* seg = &tpl->segs[i];
+        const char* val = NULL;
+        FILE* stream = NULL;
+        
+        if ((streams != NULL) && (seg->tag >= 0) && (seg->tag < tpl->nTags))
+        {
+            stream = streams[seg->tag];
+        }
+        
+        if (stream != NULL)
+        {
+            rewind (stream);
+            while ((nread = fread (data, 1, sizeof (data), stream)) > 0)
+            {
+                if (fwrite (data, 1, nread, out) != nread)
+                {
+                    return 0;
+                }
+            }
+            if (ferror (stream))
+            {
+                return 0;
+            }
+            continue;
+        }
+        
+        val = segment_value (tpl, seg, values, params, nParams);
+        if (val != NULL)
+        {
+            fputs (val, out);
+        }
+        else
+        {
+            fwrite (tpl->text + seg->off, 1, seg->len, out);
+        }
+    }
+    
+    return !ferror (out);
+}
+
+/*
+ * Returns 1 if the template contains the tag with ID 'tag', 0 otherwise.
+ */
+int
+tpl_has_tag (const TTemplate* tpl, int tag)
+{
+    int i;
+    
+    for (i = 0; i < tpl->nSegs; ++i)
+    {
+        if (tpl->segs[i].tag == tag)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+char* 
+tpl_render (const TTemplate* tpl, char* const values[], 
+            char* const params[], int nParams)
+{
+    TStrBuf out;
+    
+    strbuf_init (&out);
+    tpl_render_to (&out, tpl, values, params, nParams);
+    return strbuf_detach (&out);
+}
+
+/*
+ * Template registry. 
+ *
+ * The same template files (the default test.tpl and purpose.tpl, makefile
+ * templates) are used by many groups and tests, so each of them is read and
+ * compiled only once. The registry is filled before the tests are generated
+ * and is not changed afterwards, so the templates can be shared by all
+ * the worker threads without locking.
+ */
+
+void
+tpl_registry_init (TTplRegistry* reg)
+{
+    reg->entries = NULL;
+    reg->nEntries = 0;
+}
+
+/*
+ * Return the template from the file 'path' compiled with the given tags
+ * (see tpl_compile()). The file is read and compiled the first time the 
+ * template is requested. Returns NULL if the file cannot be read.
+ * The template belongs to the registry.
+ */
+const TTemplate*
+tpl_registry_get (TTplRegistry* reg, const char* path, 
+                  char* const tag_names[], int nTags, int flags)
+{
+    TTplEntry* e;
+    FILE* fl;
+    char* text;
+    int i;
+    
+    for (i = 0; i < reg->nEntries; ++i)
+    {
+        e = &reg->entries[i];
+        if ((e->tag_names == tag_names) && (e->flags == flags) && 
+            !strcmp (e->path, path))
+        {
+            return e->tpl;
+        }
+    }
+    
+    reg->entries = (TTplEntry*)alloc_mem (reg->entries, reg->nEntries + 1, 
+                                          sizeof (TTplEntry));
+    e = &reg->entries[reg->nEntries++];
+    e->path = strdup (path);
+    e->tag_names = tag_names;
+    e->flags = flags;
+    e->tpl = NULL;
+    
+    fl = fopen (path, "r");
+    if (fl != NULL)
+    {
+        text = read_file_to_string (fl);
+        fclose (fl);
+        
+        e->tpl = tpl_compile (text, tag_names, nTags, flags);
+        free (text);
+    }
+    return e->tpl;
+}
+
+void
+tpl_registry_free (TTplRegistry* reg)
+{
+    int i;
+    
+    for (i = 0; i < reg->nEntries; ++i)
+    {
+        free (reg->entries[i].path);
+        tpl_free (reg->entries[i].tpl);
+    }
+    free (reg->entries);
+    reg->entries = NULL;
+    reg->nEntries = 0;
+}
@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////////
+// Copyright (C) <%year%> The Linux Foundation. All rights reserved.
+// 
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+/////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////
+// This file contains a part of the tests for the following library: 
+// <%library%>, 
+// section: "<%libsection%>".
+// The rest of the tests, startup and cleanup functions are in 
+// <%object_name%>.c, the test purposes of this file are called from there.
+// 
+// This C file was generated by the T2C system developed in ISPRAS 
+// for The Linux Foundation. 
+/////////////////////////////////////////////////////////////////////////////
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <t2c_tet_support.h>
+#include <t2c.h>
+<%concurrent_purposes%>
+// The journal output of the test purposes executed concurrently is captured
+// (see <%object_name%>.c).
+#if defined(T2C_CONCURRENT_PURPOSES) && !defined(T2C_DEBUG) && \
+    (defined(T2C_SEPARATE_PROCESSES) || !defined(T2C_SINGLE_PROCESS))
+#define tet_infoline    t2c_infoline
+#define tet_printf      t2c_printf
+#define tet_result      t2c_result
+#endif
+
+// global variables (defined in <%object_name%>.c)
+extern int nPurposesTotal;
+extern int nPurposesPassed;
+extern unsigned test_passed_flag;
+
+extern int bVerbose;
+
+extern const char* test_name_;
+extern const char* suite_subdir_;
+extern const char* rcat_names_[];
+
+extern const char* rel_href_path_;
+extern char* t2c_href_tpl_;
+extern char* t2c_href_full_tpl_;
+
+extern const char* t2c_gen_hlinks_name;
+extern int gen_hlinks;
+
+extern TReqInfoList* head_;
+extern TReqInfoPtr*  reqs_;
+extern int nreq_;
+
+extern char* init_fail_reason_;
+
+// the GLOBAL section of the test: the variables and functions defined 
+// in <%object_name%>.c are declared here
+#include "<%object_name%>_globals.h"
+ 
+///////////////////////////////////////////////////////////////////////////
+// Test purposes
+///////////////////////////////////////////////////////////////////////////
+ 
+<%test_purposes%>
@@ -80,13 +80,35 @@
 
 #include <t2c_tet_support.h>
 #include <t2c.h>
+<%concurrent_purposes%>
+// With T2C_CONCURRENT_PURPOSES, several test purposes are executed at the 
+// same time (see t2c_concurrent_init()) and their journal output is captured.
+// It is not used if the tests are executed in a single process.
+#if defined(T2C_CONCURRENT_PURPOSES) && !defined(T2C_DEBUG) && \
+    (defined(T2C_SEPARATE_PROCESSES) || !defined(T2C_SINGLE_PROCESS))
+#define T2C_USE_CONCURRENT
+#define tet_infoline    t2c_infoline
+#define tet_printf      t2c_printf
+#define tet_result      t2c_result
+#endif
 
+// The time limit passed to t2c_fork_impl is in milliseconds.
 #if defined(T2C_SEPARATE_PROCESSES)
-#define t2c_fork_impl t2c_fork
-#elif defined(T2C_DEBUG) || defined(T2C_SINGLE_PROCESS)
+#define t2c_fork_impl t2c_fork_ms
+#elif defined(T2C_DEBUG)
 #define t2c_fork_impl t2c_fork_dbg
+#elif defined(T2C_SINGLE_PROCESS)
+#define t2c_fork_impl t2c_fork_contained
 #else
-#define t2c_fork_impl t2c_fork
+#define t2c_fork_impl t2c_fork_ms
+#endif
+
+// With T2C_BATCH, the test purposes are executed one after another in 
+// a single child process (see t2c_batch_fork()). It is not used if the 
+// tests are executed in a single process or concurrently.
+#if defined(T2C_BATCH) && !defined(T2C_DEBUG) && !defined(T2C_USE_CONCURRENT) && \
+    (defined(T2C_SEPARATE_PROCESSES) || !defined(T2C_SINGLE_PROCESS))
+#define T2C_USE_BATCH
 #endif
 
 // global variables
@@ -192,16 +214,46 @@ TParentControlFunc pc_func[] = {
 <%pcf_funcs%>    NULL
 };
 
+// Nonzero for the test purposes that may be executed at the same time 
+// as the other ones (see T2C_CONCURRENT_PURPOSES).
+const int tp_concurrent_[] = {
+<%tp_concurrent%>    0
+};
+
+// Nonzero for the test purposes that should be executed in a process 
+// of their own (see T2C_BATCH).
+const int tp_isolated_[] = {
+<%tp_isolated%>    0
+};
+
 // Test purpose launcher.
 static void 
 tp_launcher()
 {
     int tp_ind = tet_thistest - 1;
+#if defined(T2C_USE_CONCURRENT)
+    int result = t2c_concurrent_fork(
+        pc_func[tp_ind]);           // parent control func
+#elif defined(T2C_USE_BATCH)
+    // The test purposes with parent control functions are expected to
+    // terminate their processes in some way, so they are isolated as well.
+    int result = (tp_isolated_[tp_ind] || (pc_func[tp_ind] != NULL)) ?
+        t2c_fork_impl(
+            test_purpose_func[tp_ind],  // a test purpose to launch
+            pc_func[tp_ind],            // parent control func
+            <%wait_time_ms%>,           // wait time (milliseconds)
+            NULL, NULL) :
+        t2c_batch_fork(
+            test_purpose_func[tp_ind],  // a test purpose to launch
+            pc_func[tp_ind],            // parent control func
+            <%wait_time_ms%>);          // wait time (milliseconds)
+#else
     int result = t2c_fork_impl(
         test_purpose_func[tp_ind],  // a test purpose to launch
         pc_func[tp_ind],            // parent control func
-        <%wait_time%>,              // wait time (seconds)
+        <%wait_time_ms%>,           // wait time (milliseconds)
         NULL, NULL);
+#endif
     
     if (result == -1)
     {
@@ -270,6 +322,16 @@ startup_func()
         INIT_FAILED("Unable to create parent-child control pipe.");
     }
     
+#ifdef T2C_KILL_WAIT_MS
+    t2c_killwait_ms = T2C_KILL_WAIT_MS;
+#endif
+    
+#ifdef T2C_USE_CONCURRENT
+    t2c_concurrent_init(test_purpose_func, tp_concurrent_, 
+        sizeof(tet_testlist) / sizeof(tet_testlist[0]) - 1,
+        <%wait_time_ms%>, T2C_CONCURRENT_PURPOSES);
+#endif
+    
     char* glh_tmp = getenv(t2c_gen_hlinks_name);
     if (!glh_tmp)
     {
@@ -304,6 +366,13 @@ startup_func()
 static void 
 cleanup_func()
 {
+#ifdef T2C_USE_CONCURRENT
+    t2c_concurrent_stop();
+#endif
+#ifdef T2C_USE_BATCH
+    t2c_batch_stop();
+#endif
+
     // Perform user-defined cleanup instructions.
     user_cleanup();
     
@@ -0,0 +1,207 @@
+// strdup() is from POSIX.1-2008.
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "../include/watch.h"
+#include "../include/libmem.h"
+
+#define TRUE 1
+#define FALSE 0
+
+/*
+ * Watching the directories for changes ("t2c --watch ..."), Linux inotify.
+ *
+ * Only the directories themselves are watched, not their subdirectories:
+ * the caller adds a watch for each directory it is interested in and
+ * classifies the changes by the tags of the directories and the names of
+ * the files. The changes that happen close together (e.g. an editor writing
+ * a backup file and then renaming it) are reported at once, see
+ * watcher_wait().
+ */
+
+#define WATCH_MASK  (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | \
+                     IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+// Enough for several events with the names of maximum length.
+#define EVENT_BUF_SIZE  (16 * (sizeof (struct inotify_event) + 256))
+
+/*
+ * Returns 1 on success, 0 if inotify is not available.
+ * watcher_close() should be called in any case.
+ */
+int
+watcher_init (TWatcher* w)
+{
+    w->watches = NULL;
+    w->nWatches = 0;
+    w->fd = inotify_init ();
+
+    return (w->fd >= 0) ? TRUE : FALSE;
+}
+
+/*
+ * Start watching the directory 'path'. The changes in it will be reported
+ * with the given tag. If the directory is already watched, only its tag
+ * is changed. Returns 1 on success, 0 otherwise.
+ */
+int
+watcher_add (TWatcher* w, const char* path, int tag)
+{
+    int wd;
+    int i;
+
+    wd = inotify_add_watch (w->fd, path, WATCH_MASK);
+    if (wd < 0)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < w->nWatches; ++i)
+    {
+        if (w->watches[i].wd == wd)
+        {
+            w->watches[i].tag = tag;
+            return TRUE;
+        }
+    }
+
+    w->watches = (TWatch*)alloc_mem (w->watches, w->nWatches + 1, sizeof (TWatch));
+    w->watches[w->nWatches].wd = wd;
+    w->watches[w->nWatches].tag = tag;
+    w->watches[w->nWatches].path = strdup (path);
+    ++w->nWatches;
+
+    return TRUE;
+}
+
+// The watch removed by the system (the directory has been deleted).
+static void
+forget_watch (TWatcher* w, int i)
+{
+    free (w->watches[i].path);
+    w->watches[i] = w->watches[w->nWatches - 1];
+    --w->nWatches;
+}
+
+// Read the available events and report them. Returns 0 on error.
+static int
+read_events (TWatcher* w, TWatchFunc func, void* data)
+{
+    // aligned as the events are
+    union
+    {
+        struct inotify_event    ev;
+        char                    data[EVENT_BUF_SIZE];
+    } buf;
+    const struct inotify_event* ev = NULL;
+    ssize_t len;
+    char* p;
+    int i;
+
+    len = read (w->fd, buf.data, sizeof (buf.data));
+    if (len < 0)
+    {
+        return (errno == EINTR) ? TRUE : FALSE;
+    }
+
+    for (p = buf.data; p < buf.data + len; p += sizeof (struct inotify_event) + ev->len)
+    {
+        ev = (const struct inotify_event*)p;
+
+        if (ev->mask & IN_Q_OVERFLOW)
+        {
+            func (data, WATCH_TAG_ALL, "", 0);
+            continue;
+        }
+
+        for (i = 0; (i < w->nWatches) && (w->watches[i].wd != ev->wd); ++i)
+        {
+        }
+        if (i == w->nWatches)
+        {
+            continue;
+        }
+
+        if (ev->mask & IN_IGNORED)
+        {
+            forget_watch (w, i);
+        }
+        else if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+        {
+            func (data, w->watches[i].tag, "", 1);
+        }
+        else
+        {
+            func (data, w->watches[i].tag, (ev->len > 0) ? ev->name : "",
+                  (ev->mask & IN_ISDIR) ? 1 : 0);
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * Wait for the changes in the watched directories and call 'func' for each
+ * of them. After the first change, the changes are collected until there
+ * have been none for 'quiet_ms' milliseconds. Returns 1 on success, 0 if
+ * the events cannot be read.
+ */
+int
+watcher_wait (TWatcher* w, int quiet_ms, TWatchFunc func, void* data)
+{
+    struct pollfd pfd;
+    int timeout = -1;   // wait for the first change as long as needed
+    int res;
+
+    pfd.fd = w->fd;
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        res = poll (&pfd, 1, timeout);
+        if ((res < 0) && (errno != EINTR))
+        {
+            return FALSE;
+        }
+        if (res == 0)
+        {
+            break;
+        }
+        if (res > 0)
+        {
+            if (!read_events (w, func, data))
+            {
+                return FALSE;
+            }
+            timeout = quiet_ms;
+        }
+    }
+
+    return TRUE;
+}
+
+void
+watcher_close (TWatcher* w)
+{
+    int i;
+
+    if (w->fd >= 0)
+    {
+        close (w->fd);
+        w->fd = -1;
+    }
+    for (i = 0; i < w->nWatches; ++i)
+    {
+        free (w->watches[i].path);
+    }
+    free (w->watches);
+    w->watches = NULL;
+    w->nWatches = 0;
+}